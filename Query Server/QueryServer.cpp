@@ -0,0 +1,283 @@
+#include "../Schedule I Mixer Sim/path_table.h"
+#include "../Schedule I Mixer Sim/path_table_file.h"
+#include "../Schedule I Mixer Sim/mapped_path_table.h"
+#include "../Schedule I Mixer Sim/path_query_index.h"
+#include "../Schedule I Mixer Sim/path_query_protocol.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+#include <deque>
+#include <tuple>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include <cstdlib>
+
+// Local path query server: keeps product tables mapped and answers queries from
+// other processes over a Unix domain socket (see path_query_protocol.h).
+
+// Requests a worker takes from the queue at once
+const size_t MAX_BATCH = 256;
+
+// A table being served, in the bit layout of its own file
+struct ServedTable {
+    std::string filename;
+    PathTableDictionary dictionary;
+    std::vector<char> encodedDictionary;
+    IndexedPathTable table;
+};
+
+std::map<std::string, std::unique_ptr<ServedTable>> servedTables;
+
+// One client connection. The socket is closed once the reader thread and every
+// queued request are done with it.
+struct Connection {
+    PathSocket socket;
+    std::mutex writeMutex;
+
+    explicit Connection(PathSocket socket) : socket(socket) {}
+    ~Connection() { closePathSocket(socket); }
+
+    void reply(const std::vector<char>& payload) {
+        std::lock_guard<std::mutex> lock(writeMutex);
+        sendPathMessage(socket, payload);
+    }
+};
+
+struct PendingRequest {
+    std::shared_ptr<Connection> connection;
+    std::vector<char> message;
+};
+
+// Requests from every connection, drained in batches by the worker threads
+class RequestQueue {
+public:
+    void push(PendingRequest&& request) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending.push_back(std::move(request));
+        }
+        ready.notify_one();
+    }
+
+    // Wait for work, then take everything queued up to maxCount requests
+    std::vector<PendingRequest> take(size_t maxCount) {
+        std::unique_lock<std::mutex> lock(mutex);
+        ready.wait(lock, [this]() { return !pending.empty(); });
+
+        std::vector<PendingRequest> batch;
+        while (!pending.empty() && batch.size() < maxCount) {
+            batch.push_back(std::move(pending.front()));
+            pending.pop_front();
+        }
+        return batch;
+    }
+
+private:
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::deque<PendingRequest> pending;
+};
+
+// Product name for a table: the one stored in the file, else taken from "paths_<product>.dat"
+std::string productNameFor(const std::string& filename, const PathTableDictionary& dictionary) {
+    if (!dictionary.productName.empty()) {
+        return dictionary.productName;
+    }
+
+    std::string name = filename.substr(filename.find_last_of("/\\") + 1);
+    if (name.compare(0, 6, "paths_") == 0) {
+        name = name.substr(6);
+    }
+    size_t dot = name.rfind('.');
+    return dot == std::string::npos ? name : name.substr(0, dot);
+}
+
+bool loadServedTable(const std::string& filename) {
+    auto served = std::make_unique<ServedTable>();
+    PathTableFileInfo info;
+    if (!readPathTableFileInfo(filename, info)) {
+        std::cerr << "Error: " << filename << " is not a v2 path table (re-save it with Table Generation)" << std::endl;
+        return false;
+    }
+
+    // Expecting the file's own dictionary means v2 tables are always mapped as-is
+    if (!served->table.table.open(filename, info.dictionary, &info)) {
+        std::cerr << "Error: Could not load " << filename << std::endl;
+        return false;
+    }
+    served->table.rebuildIndex();
+    std::string answersFile = filename.substr(0, filename.rfind(".dat")) + ".answers";
+    bool cached = served->table.attachAnswers(answersFile, info.dataChecksum);
+    served->filename = filename;
+    served->dictionary = info.dictionary;
+    served->encodedDictionary = encodePathTableDictionary(info.dictionary);
+
+    std::string product = productNameFor(filename, info.dictionary);
+    if (servedTables.count(product)) {
+        std::cerr << "Warning: " << product << " is already served, skipping " << filename << std::endl;
+        return false;
+    }
+    std::cout << "Serving " << product << " from " << filename << ": " << served->table.table.size()
+        << " property combinations" << (served->table.table.isMapped() ? " (mapped)" : "")
+        << (cached ? ", answer cache" : "") << std::endl;
+    servedTables[product] = std::move(served);
+    return true;
+}
+
+// Status and body of a QUERY reply
+std::vector<char> answerQuery(const PathQueryRequest& request) {
+    PathMessageWriter body;
+    auto it = servedTables.find(request.product);
+    if (it == servedTables.end()) {
+        body.put(static_cast<uint8_t>(PATH_QUERY_UNKNOWN_TABLE));
+        return body.bytes();
+    }
+
+    PathScanFilter filter;
+    filter.include = request.include;
+    filter.exclude = request.exclude;
+    PathQueryResult result = it->second->table.query(filter, std::min(request.limit, PATH_QUERY_MAX_LIMIT));
+
+    body.put(static_cast<uint8_t>(PATH_QUERY_OK));
+    encodePathQueryResult(body, result);
+    return body.bytes();
+}
+
+// Answer a batch of requests. Identical queries within the batch, common when many
+// dashboards poll the same views, are executed once.
+void answerBatch(std::vector<PendingRequest>& batch) {
+    std::map<std::tuple<std::string, PropertySet, PropertySet, uint16_t>, std::vector<char>> answered;
+
+    for (auto& request : batch) {
+        PathMessageReader reader(request.message);
+        uint32_t id = 0;
+        uint8_t op = 0;
+        reader.get(id);
+        reader.get(op);
+
+        PathMessageWriter reply;
+        reply.put(id);
+
+        if (op == PATH_QUERY_OP_QUERY) {
+            PathQueryRequest query;
+            if (!decodePathQueryRequest(reader, query)) {
+                reply.put(static_cast<uint8_t>(PATH_QUERY_BAD_REQUEST));
+            }
+            else {
+                auto key = std::make_tuple(query.product, query.include, query.exclude, query.limit);
+                auto found = answered.find(key);
+                if (found == answered.end()) {
+                    found = answered.emplace(key, answerQuery(query)).first;
+                }
+                reply.putBytes(found->second);
+            }
+        }
+        else if (op == PATH_QUERY_OP_DICTIONARY) {
+            std::string product;
+            auto it = reader.getString(product) ? servedTables.find(product) : servedTables.end();
+            if (it == servedTables.end()) {
+                reply.put(static_cast<uint8_t>(PATH_QUERY_UNKNOWN_TABLE));
+            }
+            else {
+                reply.put(static_cast<uint8_t>(PATH_QUERY_OK));
+                reply.put(static_cast<uint32_t>(it->second->encodedDictionary.size()));
+                reply.putBytes(it->second->encodedDictionary);
+            }
+        }
+        else if (op == PATH_QUERY_OP_LIST) {
+            reply.put(static_cast<uint8_t>(PATH_QUERY_OK));
+            reply.put(static_cast<uint16_t>(servedTables.size()));
+            for (const auto& pair : servedTables) {
+                reply.putString(pair.first);
+            }
+        }
+        else {
+            reply.put(static_cast<uint8_t>(PATH_QUERY_BAD_REQUEST));
+        }
+
+        request.connection->reply(reply.bytes());
+    }
+}
+
+void serveConnection(std::shared_ptr<Connection> connection, RequestQueue& queue) {
+    std::vector<char> message;
+    while (receivePathMessage(connection->socket, message)) {
+        // Too short to carry an id there is nothing to reply to
+        if (message.size() < sizeof(uint32_t) + sizeof(uint8_t)) {
+            break;
+        }
+        queue.push({ connection, std::move(message) });
+        message.clear();
+    }
+}
+
+int main(int argc, char* argv[]) {
+    std::string socketPath = PATH_QUERY_DEFAULT_SOCKET;
+    int threads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    std::vector<std::string> files;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--socket" && i + 1 < argc) {
+            socketPath = argv[++i];
+        }
+        else if (arg == "--threads" && i + 1 < argc) {
+            threads = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (arg.compare(0, 2, "--") == 0) {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            return 1;
+        }
+        else {
+            files.push_back(arg);
+        }
+    }
+
+    if (files.empty()) {
+        std::cerr << "Usage: QueryServer [--socket <path>] [--threads <n>] <table file>..." << std::endl;
+        return 1;
+    }
+
+    for (const auto& filename : files) {
+        loadServedTable(filename);
+    }
+    if (servedTables.empty()) {
+        std::cerr << "Error: No tables to serve" << std::endl;
+        return 1;
+    }
+
+    if (!initPathSockets()) {
+        std::cerr << "Error: Could not initialise sockets" << std::endl;
+        return 1;
+    }
+    std::string reason;
+    PathSocket listener = listenPathSocket(socketPath, reason);
+    if (listener == INVALID_PATH_SOCKET) {
+        std::cerr << "Error: Could not listen on " << socketPath << ": " << reason << std::endl;
+        return 1;
+    }
+
+    RequestQueue queue;
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&queue]() {
+            while (true) {
+                std::vector<PendingRequest> batch = queue.take(MAX_BATCH);
+                answerBatch(batch);
+            }
+        });
+    }
+
+    std::cout << "Listening on " << socketPath << " with " << threads << " worker threads" << std::endl;
+    while (true) {
+        PathSocket client = accept(listener, nullptr, nullptr);
+        if (client == INVALID_PATH_SOCKET) {
+            continue;
+        }
+        std::thread(serveConnection, std::make_shared<Connection>(client), std::ref(queue)).detach();
+    }
+}
@@ -0,0 +1,237 @@
+#pragma once
+
+#include "path_table.h"
+#include "path_table_file.h"
+#include <iostream>
+#include <string>
+#include <cstring>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Read-only memory mapping of a whole file. Pages are shared with every other
+// process mapping the same file.
+class MappedFile {
+public:
+    MappedFile() : mappedData(nullptr), mappedSize(0) {}
+    ~MappedFile() { close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& filename) {
+        close();
+
+#ifdef _WIN32
+        HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+            CloseHandle(file);
+            return false;
+        }
+
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        CloseHandle(file);
+        if (!mapping) {
+            return false;
+        }
+
+        void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        CloseHandle(mapping);  // The view keeps the mapping alive
+        if (!view) {
+            return false;
+        }
+
+        mappedData = static_cast<const char*>(view);
+        mappedSize = static_cast<size_t>(fileSize.QuadPart);
+#else
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+
+        struct stat info;
+        if (fstat(fd, &info) != 0 || info.st_size == 0) {
+            ::close(fd);
+            return false;
+        }
+
+        void* view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);  // The mapping stays valid after the descriptor is closed
+        if (view == MAP_FAILED) {
+            return false;
+        }
+
+        mappedData = static_cast<const char*>(view);
+        mappedSize = static_cast<size_t>(info.st_size);
+#endif
+        return true;
+    }
+
+    void close() {
+        if (!mappedData) {
+            return;
+        }
+
+#ifdef _WIN32
+        UnmapViewOfFile(mappedData);
+#else
+        munmap(const_cast<char*>(mappedData), mappedSize);
+#endif
+        mappedData = nullptr;
+        mappedSize = 0;
+    }
+
+    const char* data() const { return mappedData; }
+    size_t size() const { return mappedSize; }
+    bool isOpen() const { return mappedData != nullptr; }
+
+private:
+    const char* mappedData;
+    size_t mappedSize;
+};
+
+// A path table that queries run against in place. v2 files whose dictionary matches
+// are mapped and used without deserialising anything; legacy v1 files and files that
+// need remapping fall back to a full read into an owned table. Generated tables can
+// be adopted directly. Either way queries go through view().
+class MappedPathTable {
+public:
+    MappedPathTable() {}
+
+    MappedPathTable(const MappedPathTable&) = delete;
+    MappedPathTable& operator=(const MappedPathTable&) = delete;
+
+    bool open(const std::string& filename, const PathTableDictionary& expected, PathTableFileInfo* infoOut = nullptr,
+        PathTableLoadProgress* progress = nullptr) {
+        reset();
+
+        PathTableFileInfo info;
+        MapResult mapped = mapFile(filename, expected, info);
+        if (mapped == MapResult::Mapped) {
+            if (infoOut) {
+                *infoOut = info;
+            }
+            if (progress) {
+                progress->bytesTotal = file.size();
+                progress->bytesRead = file.size();
+            }
+            return true;
+        }
+        if (mapped == MapResult::Invalid) {
+            std::cerr << "Error: Invalid path table: " << filename << std::endl;
+            if (infoOut) {
+                *infoOut = PathTableFileInfo();
+            }
+            return false;
+        }
+
+        // Not mappable as-is: parse it the slow way
+        owned = readPathTableFile(filename, expected, &info, progress);
+        tableView = PathTableView(owned);
+        if (infoOut) {
+            *infoOut = info;
+        }
+        return info.version != 0;
+    }
+
+    void adopt(PropertyPathTable&& table) {
+        reset();
+        owned.swap(table);
+        tableView = PathTableView(owned);
+    }
+
+    void reset() {
+        tableView = PathTableView();
+        file.close();
+        owned.clear();
+    }
+
+    const PathTableView& view() const { return tableView; }
+    size_t size() const { return tableView.size(); }
+    bool empty() const { return tableView.empty(); }
+    bool isMapped() const { return file.isOpen(); }
+
+    // Bytes of an owned table; a mapped one lives in the page cache
+    size_t memoryUsage() const {
+        if (isMapped() || tableView.empty()) {
+            return 0;
+        }
+        return tableView.size() * sizeof(PropertySet) + (tableView.size() + 1) * sizeof(uint32_t) +
+            tableView.entryCount() * sizeof(CompactPathEntry);
+    }
+
+private:
+    MappedFile file;
+    PropertyPathTable owned;
+    PathTableView tableView;
+
+    enum class MapResult { Mapped, NotMappable, Invalid };
+
+    // Map a v2 file and point the view at its sections. The header is bounds-checked
+    // and the key and offset columns validated before a view is handed out. Entries
+    // are not read here, as that would touch nearly the whole file: their lengths are
+    // capped by IngredientSequence and ingredient indices checked where paths are
+    // decoded. Entry checks and the data checksum are left to full reads. v1 files,
+    // trie tables and tables that need remapping are NotMappable and get read in full.
+    MapResult mapFile(const std::string& filename, const PathTableDictionary& expected, PathTableFileInfo& info) {
+        if (!file.open(filename)) {
+            return MapResult::NotMappable;
+        }
+
+        const char* data = file.data();
+        if (!isPathTableV2(data, file.size())) {
+            file.close();
+            return MapResult::NotMappable;
+        }
+
+        PathTableFileHeader header;
+        std::memcpy(&header, data, sizeof(header));
+        if (!validatePathTableHeader(header, file.size()) ||
+            !decodePathTableDictionary(data + header.dictionaryOffset, header.dictionarySize, info.dictionary)) {
+            file.close();
+            return MapResult::Invalid;
+        }
+        if ((header.flags & PATH_TABLE_FLAG_TRIE) ||
+            info.dictionary.propertyIds != expected.propertyIds ||
+            info.dictionary.ingredientNames != expected.ingredientNames) {
+            file.close();
+            return MapResult::NotMappable;
+        }
+
+        const PropertySet* keys = reinterpret_cast<const PropertySet*>(data + header.keysOffset);
+        const uint32_t* offsets = reinterpret_cast<const uint32_t*>(data + header.offsetsOffset);
+        const CompactPathEntry* entries = reinterpret_cast<const CompactPathEntry*>(data + header.entriesOffset);
+        if (!validatePathTableColumns(keys, offsets, header.keyCount, header.entryCount)) {
+            file.close();
+            return MapResult::Invalid;
+        }
+
+        info.version = header.version;
+        info.dataChecksum = header.dataChecksum;
+        info.keyCount = header.keyCount;
+        info.entryCount = header.entryCount;
+        info.dictionary.maxDepth = header.maxDepth;
+        info.dictionary.datasetHash = header.datasetHash;
+        info.dictionary.completedMask = header.completedMask;
+        tableView = PathTableView(keys, offsets, entries, static_cast<size_t>(header.keyCount));
+        return MapResult::Mapped;
+    }
+};
@@ -0,0 +1,378 @@
+#pragma once
+
+#include "property_mixer_core.h"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// A mixing session without any UI: the product, its properties and where each one
+// came from, the ingredients mixed so far, the ingredient being previewed, and undo.
+// The visualizer draws one; Session Replay drives one from a recorded script.
+
+// Structure for a property on the product
+struct ProductProperty {
+    Property* property;
+    std::vector<std::string> ingredients;   // Where it came from: the product or ingredients
+};
+
+// Ingredients and the property each one adds
+inline const std::map<std::string, std::string>& mixIngredientProperties() {
+    static const std::map<std::string, std::string> mapping = {
+        {"Cuke", "energizing"},
+        {"Donut", "caloriedense"},
+        {"Flu Medicine", "sedating"},
+        {"Gasoline", "toxic"},
+        {"Energy Drink", "athletic"},
+        {"Mouth Wash", "balding"},
+        {"Banana", "gingeritis"},
+        {"Chili", "spicy"},
+        {"Motor Oil", "slippery"},
+        {"Iodine", "jennerising"},
+        {"Paracetamol", "sneaky"},
+        {"Viagra", "tropicthunder"},
+        {"Horse Semen", "giraffying"},
+        {"Mega Bean", "foggy"},
+        {"Addy", "thoughtprovoking"},
+        {"Battery", "brighteyed"}
+    };
+    return mapping;
+}
+
+// What one mix did, for animating it
+struct MixStep {
+    std::vector<Property*> before;
+    std::vector<Property*> after;
+    Property* added = nullptr;      // The mixed ingredient's property
+};
+
+// One user action as recorded and replayed, a line "<verb> <argument>" in a script.
+// Verbs: product <name>, preview <ingredient>, cancel, confirm, mix <ingredient>,
+// path <ingredient>,<ingredient>,..., reset, undo
+struct MixAction {
+    std::string verb;
+    std::string argument;
+};
+
+class MixSession {
+public:
+    // Undo steps kept; older ones are forgotten
+    static constexpr size_t MAX_UNDO = 100;
+
+    explicit MixSession(DrugType drugType = DrugType::Marijuana) : drugType(drugType) {}
+
+    const std::string& product() const { return state.product; }
+    const std::vector<ProductProperty>& properties() const { return state.properties; }
+    const std::vector<std::string>& history() const { return state.history; }
+
+    // Just the properties, in product order
+    std::vector<Property*> propertyList() const {
+        std::vector<Property*> props;
+        for (const auto& propWithOrigin : state.properties) {
+            props.push_back(propWithOrigin.property);
+        }
+        return props;
+    }
+
+    bool isPreviewing() const { return previewed != nullptr; }
+    const std::string& previewIngredient() const { return previewedName; }
+    Property* previewProperty() const { return previewed; }
+
+    bool canUndo() const { return !undoStack.empty(); }
+
+    // Everything done so far, replayable with perform
+    const std::vector<MixAction>& actions() const { return recorded; }
+
+    // Property an ingredient adds, nullptr if there is no such ingredient
+    static Property* ingredientProperty(const std::string& ingredient) {
+        auto it = mixIngredientProperties().find(ingredient);
+        return it != mixIngredientProperties().end() ? getPropertyByNameOrId(it->second) : nullptr;
+    }
+
+    // Start over from a product's own properties (none for an unknown product)
+    void selectProduct(const std::string& productName) {
+        record("product", productName);
+        pushUndo();
+        previewed = nullptr;
+        previewedName.clear();
+
+        state.product = productName;
+        state.history.clear();
+        state.properties = productProperties(productName);
+    }
+
+    // Clear the properties and history; the product stays selected
+    void reset() {
+        record("reset", "");
+        pushUndo();
+        state.properties.clear();
+        state.history.clear();
+    }
+
+    bool preview(const std::string& ingredient) {
+        Property* property = ingredientProperty(ingredient);
+        if (!property) {
+            std::cerr << "Error: Unknown ingredient " << ingredient << std::endl;
+            return false;
+        }
+        record("preview", ingredient);
+        previewed = property;
+        previewedName = ingredient;
+        return true;
+    }
+
+    void cancelPreview() {
+        if (!previewed) {
+            return;
+        }
+        record("cancel", "");
+        previewed = nullptr;
+        previewedName.clear();
+    }
+
+    // Mix the previewed ingredient
+    bool confirmPreview(MixStep* step = nullptr) {
+        if (!previewed) {
+            return false;
+        }
+        record("confirm", "");
+        pushUndo();
+        std::string ingredient = previewedName;
+        Property* property = previewed;
+        previewed = nullptr;
+        previewedName.clear();
+
+        MixStep done = mixInto(state, ingredient, property);
+        if (step) {
+            *step = std::move(done);
+        }
+        return true;
+    }
+
+    // Mix an ingredient without previewing it first
+    bool mix(const std::string& ingredient, MixStep* step = nullptr) {
+        Property* property = ingredientProperty(ingredient);
+        if (!property) {
+            std::cerr << "Error: Unknown ingredient " << ingredient << std::endl;
+            return false;
+        }
+        record("mix", ingredient);
+        pushUndo();
+
+        MixStep done = mixInto(state, ingredient, property);
+        if (step) {
+            *step = std::move(done);
+        }
+        return true;
+    }
+
+    // Start over from the product and mix each ingredient in turn, as one undo step
+    bool applyPath(const std::vector<std::string>& ingredients, std::vector<MixStep>* steps = nullptr) {
+        std::vector<Property*> added;
+        for (const auto& ingredient : ingredients) {
+            added.push_back(ingredientProperty(ingredient));
+            if (!added.back()) {
+                std::cerr << "Error: Unknown ingredient " << ingredient << std::endl;
+                return false;
+            }
+        }
+
+        std::string joined;
+        for (const auto& ingredient : ingredients) {
+            joined += (joined.empty() ? "" : ",") + ingredient;
+        }
+        record("path", joined);
+        pushUndo();
+
+        state.history.clear();
+        state.properties = productProperties(state.product);
+        for (size_t i = 0; i < ingredients.size(); i++) {
+            MixStep done = mixInto(state, ingredients[i], added[i]);
+            if (steps) {
+                steps->push_back(std::move(done));
+            }
+        }
+        return true;
+    }
+
+    // Back to before the last product change, reset or mix
+    bool undo() {
+        if (undoStack.empty()) {
+            return false;
+        }
+        record("undo", "");
+        state = std::move(undoStack.back());
+        undoStack.pop_back();
+        previewed = nullptr;
+        previewedName.clear();
+        return true;
+    }
+
+    // Replay a recorded action
+    bool perform(const MixAction& action) {
+        if (action.verb == "product") {
+            selectProduct(action.argument);
+            return true;
+        }
+        if (action.verb == "reset") {
+            reset();
+            return true;
+        }
+        if (action.verb == "preview") {
+            return preview(action.argument);
+        }
+        if (action.verb == "cancel") {
+            cancelPreview();
+            return true;
+        }
+        if (action.verb == "confirm") {
+            return confirmPreview();
+        }
+        if (action.verb == "mix") {
+            return mix(action.argument);
+        }
+        if (action.verb == "path") {
+            std::vector<std::string> ingredients;
+            std::stringstream list(action.argument);
+            std::string ingredient;
+            while (std::getline(list, ingredient, ',')) {
+                ingredients.push_back(ingredient);
+            }
+            return applyPath(ingredients);
+        }
+        if (action.verb == "undo") {
+            return undo();
+        }
+        std::cerr << "Error: Unknown session action " << action.verb << std::endl;
+        return false;
+    }
+
+    bool saveScript(const std::string& filename) const {
+        std::ofstream file(filename);
+        if (!file) {
+            std::cerr << "Error: Could not write " << filename << std::endl;
+            return false;
+        }
+        for (const auto& action : recorded) {
+            file << action.verb;
+            if (!action.argument.empty()) {
+                file << " " << action.argument;
+            }
+            file << "\n";
+        }
+        return static_cast<bool>(file);
+    }
+
+    // Actions from a script; blank lines and lines starting with # are skipped
+    static bool loadScript(const std::string& filename, std::vector<MixAction>& actions) {
+        std::ifstream file(filename);
+        if (!file) {
+            std::cerr << "Error: Could not open " << filename << std::endl;
+            return false;
+        }
+        std::string line;
+        while (std::getline(file, line)) {
+            if (!line.empty() && line.back() == '\r') {
+                line.pop_back();
+            }
+            if (line.empty() || line[0] == '#') {
+                continue;
+            }
+            size_t space = line.find(' ');
+            MixAction action;
+            action.verb = line.substr(0, space);
+            action.argument = space == std::string::npos ? "" : line.substr(space + 1);
+            actions.push_back(action);
+        }
+        return true;
+    }
+
+private:
+    // What undo restores
+    struct State {
+        std::string product;
+        std::vector<ProductProperty> properties;
+        std::vector<std::string> history;
+    };
+
+    DrugType drugType;
+    State state;
+    std::vector<State> undoStack;
+    Property* previewed = nullptr;
+    std::string previewedName;
+    std::vector<MixAction> recorded;
+
+    void record(const std::string& verb, const std::string& argument) {
+        recorded.push_back({ verb, argument });
+    }
+
+    void pushUndo() {
+        undoStack.push_back(state);
+        if (undoStack.size() > MAX_UNDO) {
+            undoStack.erase(undoStack.begin());
+        }
+    }
+
+    static std::vector<ProductProperty> productProperties(const std::string& productName) {
+        std::vector<ProductProperty> result;
+        auto productIt = products.find(productName);
+        if (productIt != products.end()) {
+            for (Property* prop : productIt->second->properties) {
+                ProductProperty propWithOrigin;
+                propWithOrigin.property = prop;
+                propWithOrigin.ingredients.push_back(productName); // The product is the source
+                result.push_back(propWithOrigin);
+            }
+        }
+        return result;
+    }
+
+    // Mix one ingredient into a state, working out where each resulting property came from
+    MixStep mixInto(State& into, const std::string& ingredient, Property* newProperty) const {
+        into.history.push_back(ingredient);
+
+        MixStep step;
+        step.added = newProperty;
+        for (const auto& propWithOrigin : into.properties) {
+            step.before.push_back(propWithOrigin.property);
+        }
+        step.after = PropertyMixCalculator::mixProperties(step.before, newProperty, drugType);
+
+        std::vector<ProductProperty> newProperties;
+        for (Property* resultProp : step.after) {
+            ProductProperty newProp;
+            newProp.property = resultProp;
+
+            // Kept from before: same origins
+            bool wasInPrevious = false;
+            for (const auto& prevProp : into.properties) {
+                if (prevProp.property == resultProp) {
+                    newProp.ingredients = prevProp.ingredients;
+                    wasInPrevious = true;
+                    break;
+                }
+            }
+
+            // Added by this ingredient
+            if (!wasInPrevious && resultProp == newProperty) {
+                newProp.ingredients.push_back(ingredient);
+            }
+            // Created by mixing: every ingredient so far
+            else if (!wasInPrevious) {
+                for (const auto& prevIngredient : into.history) {
+                    if (std::find(newProp.ingredients.begin(), newProp.ingredients.end(), prevIngredient) ==
+                        newProp.ingredients.end()) {
+                        newProp.ingredients.push_back(prevIngredient);
+                    }
+                }
+            }
+
+            newProperties.push_back(newProp);
+        }
+        into.properties = newProperties;
+        return step;
+    }
+};
@@ -0,0 +1,347 @@
+#pragma once
+
+#include "path_table.h"
+#include "mapped_path_table.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Precomputed answers for every "contains all of these" query over at most
+// maxTerms properties. Each property subset has a fixed-size slot found by its
+// combinatorial rank, so answering is one array lookup instead of a superset scan.
+//
+// File layout: PathAnswerHeader, then one PathAnswerSummary per subset, then
+// answersPerQuery PathAnswerHits per subset. Hits point at rows of the table the
+// answers were built from; tableChecksum and tableKeys tie the file to that table.
+struct PathAnswerHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t propertyCount;
+    uint32_t maxTerms;
+    uint32_t answersPerQuery;
+    uint64_t tableChecksum;     // dataChecksum of the table file
+    uint64_t tableKeys;
+    uint64_t answerCount;
+};
+
+struct PathAnswerSummary {
+    uint32_t matchingKeys;
+    uint32_t hitCount;
+    uint64_t totalPaths;
+};
+
+struct PathAnswerHit {
+    uint32_t row;
+    uint32_t entry;             // Index within the row's entries
+};
+
+static const char PATH_ANSWER_MAGIC[8] = { 'S', '1', 'A', 'N', 'S', 'W', 'E', 'R' };
+const uint32_t PATH_ANSWER_VERSION = 1;
+
+class PathAnswerCache {
+public:
+    // 35 choose 5 slots is about 18 MB per build thread at 5 answers; more gets silly
+    static constexpr uint32_t MAX_TERMS = 5;
+
+    PathAnswerCache() : header(), summaries(nullptr), hits(nullptr) {}
+
+    PathAnswerCache(const PathAnswerCache&) = delete;
+    PathAnswerCache& operator=(const PathAnswerCache&) = delete;
+
+    // Map an answer file, keeping it only if it was built from this table
+    bool open(const std::string& filename, const PathTableView& view, uint64_t tableChecksum) {
+        close();
+        if (tableChecksum == 0 || !file.open(filename) || file.size() < sizeof(PathAnswerHeader)) {
+            file.close();
+            return false;
+        }
+
+        std::memcpy(&header, file.data(), sizeof(header));
+        uint64_t expectedSize = sizeof(header) +
+            header.answerCount * (sizeof(PathAnswerSummary) + header.answersPerQuery * sizeof(PathAnswerHit));
+        if (std::memcmp(header.magic, PATH_ANSWER_MAGIC, sizeof(header.magic)) != 0 ||
+            header.version != PATH_ANSWER_VERSION || header.propertyCount > 64 || header.maxTerms > MAX_TERMS ||
+            header.answerCount != slotCount(header.propertyCount, header.maxTerms) || file.size() != expectedSize ||
+            header.tableChecksum != tableChecksum || header.tableKeys != view.size()) {
+            close();
+            return false;
+        }
+
+        summaries = reinterpret_cast<const PathAnswerSummary*>(file.data() + sizeof(header));
+        hits = reinterpret_cast<const PathAnswerHit*>(summaries + header.answerCount);
+
+        // Every hit must be a row holding the subset, which also catches a table
+        // loaded with a different bit layout than the one the answers were built on
+        bool valid = true;
+        PropertySet allBits = header.propertyCount >= 64 ? ~0ULL : (1ULL << header.propertyCount) - 1;
+        forEachSubset(allBits, header.propertyCount, header.maxTerms, [&](PropertySet subset, uint64_t rank) {
+            const PathAnswerSummary& summary = summaries[rank];
+            for (uint32_t i = 0; i < summary.hitCount && valid; i++) {
+                const PathAnswerHit& hit = hits[rank * header.answersPerQuery + i];
+                valid = summary.hitCount <= header.answersPerQuery && hit.row < view.size() &&
+                    (view.keyAt(hit.row) & subset) == subset && hit.entry < view.entriesAt(hit.row).size();
+            }
+            return valid;
+        });
+        if (!valid) {
+            close();
+        }
+        return valid;
+    }
+
+    void close() {
+        file.close();
+        header = PathAnswerHeader();
+        summaries = nullptr;
+        hits = nullptr;
+    }
+
+    bool isOpen() const { return summaries != nullptr; }
+    uint32_t maxTerms() const { return header.maxTerms; }
+    uint32_t answersPerQuery() const { return header.answersPerQuery; }
+
+    // Answer a query from the cache: false when it is not covered (too many
+    // properties or more paths wanted than were stored)
+    bool lookup(PropertySet required, size_t limit, const PathTableView& view, PathQueryResult& result) const {
+        if (!isOpen() || limit > header.answersPerQuery ||
+            (header.propertyCount < 64 && (required >> header.propertyCount) != 0)) {
+            return false;
+        }
+
+        uint64_t rank = subsetRank(required, header.propertyCount, header.maxTerms);
+        if (rank == UINT64_MAX) {
+            return false;
+        }
+
+        const PathAnswerSummary& summary = summaries[rank];
+        result.matchingKeys = summary.matchingKeys;
+        result.totalPaths = static_cast<size_t>(summary.totalPaths);
+        result.paths.clear();
+        for (uint32_t i = 0; i < summary.hitCount && i < limit; i++) {
+            const PathAnswerHit& hit = hits[rank * header.answersPerQuery + i];
+            result.paths.push_back({ view.keyAt(hit.row), &view.entriesAt(hit.row)[hit.entry] });
+        }
+        return true;
+    }
+
+    // Number of subsets of at most maxTerms out of propertyCount bits
+    static uint64_t slotCount(uint32_t propertyCount, uint32_t maxTerms) {
+        uint64_t count = 0;
+        for (uint32_t size = 0; size <= maxTerms; size++) {
+            count += binomial(propertyCount, size);
+        }
+        return count;
+    }
+
+    // Slot of a subset: all smaller subsets come first, then same-size subsets in
+    // colex order (sum of C(bit_i, i + 1) over its bits in ascending order).
+    // UINT64_MAX when the subset has more than maxTerms bits.
+    static uint64_t subsetRank(PropertySet subset, uint32_t propertyCount, uint32_t maxTerms) {
+        uint64_t rank = 0;
+        uint32_t size = 0;
+        for (int bit = 0; bit < 64 && subset; bit++) {
+            if (subset & (1ULL << bit)) {
+                size++;
+                if (size > maxTerms) {
+                    return UINT64_MAX;
+                }
+                rank += binomial(bit, size);
+                subset &= ~(1ULL << bit);
+            }
+        }
+        for (uint32_t smaller = 0; smaller < size; smaller++) {
+            rank += binomial(propertyCount, smaller);
+        }
+        return rank;
+    }
+
+    // Call fn(subset, rank) for every subset of `bits` with at most maxTerms members,
+    // the empty set included, until fn returns false
+    template <typename Fn>
+    static void forEachSubset(PropertySet bits, uint32_t propertyCount, uint32_t maxTerms, Fn fn) {
+        uint64_t sizeOffsets[MAX_TERMS + 1] = {};
+        for (uint32_t size = 1; size <= maxTerms; size++) {
+            sizeOffsets[size] = sizeOffsets[size - 1] + binomial(propertyCount, size - 1);
+        }
+
+        int members[64];
+        int memberCount = 0;
+        for (int bit = 0; bit < 64; bit++) {
+            if (bits & (1ULL << bit)) {
+                members[memberCount++] = bit;
+            }
+        }
+
+        bool running = true;
+        // Subsets are extended in ascending bit order, so each new bit adds C(bit, size)
+        std::function<void(int, uint32_t, PropertySet, uint64_t)> extend =
+            [&](int next, uint32_t size, PropertySet subset, uint64_t colex) {
+            running = fn(subset, sizeOffsets[size] + colex);
+            for (int i = next; i < memberCount && running && size < maxTerms; i++) {
+                extend(i + 1, size + 1, subset | (1ULL << members[i]), colex + binomial(members[i], size + 1));
+            }
+        };
+        extend(0, 0, 0, 0);
+    }
+
+    static uint64_t binomial(uint32_t n, uint32_t k) {
+        if (k > n) {
+            return 0;
+        }
+        uint64_t result = 1;
+        for (uint32_t i = 1; i <= k; i++) {
+            result = result * (n - k + i) / i;
+        }
+        return result;
+    }
+
+private:
+    MappedFile file;
+    PathAnswerHeader header;
+    const PathAnswerSummary* summaries;
+    const PathAnswerHit* hits;
+};
+
+// Build an answer file for a table. rowOrder is the order rows are visited in
+// (PathQueryIndex rank order), which decides ties exactly as findSupersets does.
+// Rows are split across threads, each filling its own slots, and the partial
+// answers are merged slot by slot in row order.
+inline bool writePathAnswerCache(const PathTableView& view, const std::vector<uint32_t>& rowOrder,
+    uint32_t propertyCount, uint32_t maxTerms, uint32_t answersPerQuery, uint64_t tableChecksum,
+    size_t threads, const std::string& filename) {
+    if (maxTerms > PathAnswerCache::MAX_TERMS || propertyCount > 64 || answersPerQuery == 0) {
+        std::cerr << "Error: Unsupported answer cache size" << std::endl;
+        return false;
+    }
+
+    const size_t slots = static_cast<size_t>(PathAnswerCache::slotCount(propertyCount, maxTerms));
+    const size_t width = answersPerQuery;
+
+    struct Partial {
+        std::vector<PathAnswerSummary> summaries;
+        std::vector<PathAnswerHit> hits;
+    };
+
+    // Path a is better than b: fewer ingredients, then higher bonus
+    auto entryOf = [&view](const PathAnswerHit& hit) -> const CompactPathEntry& {
+        return view.entriesAt(hit.row)[hit.entry];
+    };
+    auto better = [&](const PathAnswerHit& a, const PathAnswerHit& b) {
+        const CompactPathEntry& left = entryOf(a);
+        const CompactPathEntry& right = entryOf(b);
+        if (left.ingredientSequence.size() != right.ingredientSequence.size()) {
+            return left.ingredientSequence.size() < right.ingredientSequence.size();
+        }
+        return left.baseValueBonus > right.baseValueBonus;
+    };
+
+    threads = std::max<size_t>(1, std::min(threads, rowOrder.size() / 1024 + 1));
+    std::vector<Partial> partials(threads);
+    parallelFor(threads, threads, [&](size_t t) {
+        Partial& partial = partials[t];
+        partial.summaries.assign(slots, PathAnswerSummary());
+        partial.hits.resize(slots * width);
+
+        size_t begin = rowOrder.size() * t / threads;
+        size_t end = rowOrder.size() * (t + 1) / threads;
+        for (size_t i = begin; i < end; i++) {
+            uint32_t row = rowOrder[i];
+            auto entries = view.entriesAt(row);
+            if (entries.empty()) {
+                continue;
+            }
+
+            PathAnswerCache::forEachSubset(view.keyAt(row), propertyCount, maxTerms, [&](PropertySet, uint64_t rank) {
+                PathAnswerSummary& summary = partial.summaries[rank];
+                PathAnswerHit* slot = partial.hits.data() + rank * width;
+                summary.matchingKeys++;
+                summary.totalPaths += entries.size();
+
+                // Insert after every hit that is at least as good, keeping visit order on ties
+                for (uint32_t e = 0; e < entries.size(); e++) {
+                    PathAnswerHit candidate = { row, e };
+                    if (summary.hitCount == width && !better(candidate, slot[width - 1])) {
+                        continue;
+                    }
+                    uint32_t position = std::min<uint32_t>(summary.hitCount, static_cast<uint32_t>(width - 1));
+                    while (position > 0 && better(candidate, slot[position - 1])) {
+                        position--;
+                    }
+                    uint32_t last = std::min<uint32_t>(summary.hitCount, static_cast<uint32_t>(width - 1));
+                    std::memmove(slot + position + 1, slot + position, (last - position) * sizeof(PathAnswerHit));
+                    slot[position] = candidate;
+                    summary.hitCount = std::min<uint32_t>(summary.hitCount + 1, static_cast<uint32_t>(width));
+                }
+                return true;
+            });
+        }
+    });
+
+    // Fold later row ranges into the first, earlier hits winning ties
+    Partial& merged = partials[0];
+    parallelFor((slots + 4095) / 4096, threads, [&](size_t block) {
+        std::vector<PathAnswerHit> combined;
+        for (size_t rank = block * 4096; rank < std::min(slots, (block + 1) * 4096); rank++) {
+            PathAnswerSummary& summary = merged.summaries[rank];
+            for (size_t t = 1; t < partials.size(); t++) {
+                const PathAnswerSummary& other = partials[t].summaries[rank];
+                const PathAnswerHit* left = merged.hits.data() + rank * width;
+                const PathAnswerHit* right = partials[t].hits.data() + rank * width;
+
+                combined.clear();
+                uint32_t a = 0, b = 0;
+                while (combined.size() < width && (a < summary.hitCount || b < other.hitCount)) {
+                    if (b == other.hitCount || (a < summary.hitCount && !better(right[b], left[a]))) {
+                        combined.push_back(left[a++]);
+                    }
+                    else {
+                        combined.push_back(right[b++]);
+                    }
+                }
+
+                std::copy(combined.begin(), combined.end(), merged.hits.begin() + rank * width);
+                summary.matchingKeys += other.matchingKeys;
+                summary.totalPaths += other.totalPaths;
+                summary.hitCount = static_cast<uint32_t>(combined.size());
+            }
+        }
+    });
+
+    PathAnswerHeader header;
+    std::memcpy(header.magic, PATH_ANSWER_MAGIC, sizeof(header.magic));
+    header.version = PATH_ANSWER_VERSION;
+    header.propertyCount = propertyCount;
+    header.maxTerms = maxTerms;
+    header.answersPerQuery = answersPerQuery;
+    header.tableChecksum = tableChecksum;
+    header.tableKeys = view.size();
+    header.answerCount = slots;
+
+    // Written beside the target and swapped in, so a reader mapping the old answers
+    // never sees a half-written file
+    std::string tempFile = filename + ".tmp";
+    std::ofstream file(tempFile, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(merged.summaries.data()), slots * sizeof(PathAnswerSummary));
+    file.write(reinterpret_cast<const char*>(merged.hits.data()), slots * width * sizeof(PathAnswerHit));
+    file.close();
+    if (!file) {
+        std::cerr << "Error: Failed writing answer cache " << tempFile << std::endl;
+        std::remove(tempFile.c_str());
+        return false;
+    }
+
+    std::string reason;
+    if (!replacePathTableFile(tempFile, filename, reason)) {
+        std::cerr << "Error: Could not replace answer cache " << filename << " (" << reason << ")" << std::endl;
+        std::remove(tempFile.c_str());
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,202 @@
+#pragma once
+
+#include "path_query_protocol.h"
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+// Client for the path query server. One connection, used from one thread at a time.
+// Dictionaries are fetched once per product and cached, so property names can be
+// turned into query bits locally.
+class PathQueryClient {
+public:
+    // Requests kept in flight by queryBatch before reading replies
+    static constexpr size_t BATCH_WINDOW = 256;
+
+    PathQueryClient() : socket(INVALID_PATH_SOCKET), nextId(1) {}
+    ~PathQueryClient() { close(); }
+
+    PathQueryClient(const PathQueryClient&) = delete;
+    PathQueryClient& operator=(const PathQueryClient&) = delete;
+
+    bool connect(const std::string& socketPath = PATH_QUERY_DEFAULT_SOCKET) {
+        close();
+        if (!initPathSockets()) {
+            return false;
+        }
+        socket = connectPathSocket(socketPath);
+        return socket != INVALID_PATH_SOCKET;
+    }
+
+    void close() {
+        if (socket != INVALID_PATH_SOCKET) {
+            closePathSocket(socket);
+            socket = INVALID_PATH_SOCKET;
+        }
+        dictionaries.clear();
+    }
+
+    bool isConnected() const { return socket != INVALID_PATH_SOCKET; }
+
+    // Products the server has tables for
+    bool listTables(std::vector<std::string>& products) {
+        std::vector<char> reply;
+        if (!call(PATH_QUERY_OP_LIST, PathMessageWriter(), reply)) {
+            return false;
+        }
+
+        PathMessageReader reader(reply);
+        uint16_t count = 0;
+        if (!reader.get(count)) {
+            return false;
+        }
+        products.resize(count);
+        for (auto& product : products) {
+            if (!reader.getString(product)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Property ids and ingredient names of a product's table
+    const PathTableDictionary* dictionary(const std::string& product) {
+        auto it = dictionaries.find(product);
+        if (it != dictionaries.end()) {
+            return &it->second;
+        }
+
+        PathMessageWriter request;
+        request.putString(product);
+        std::vector<char> reply;
+        if (!call(PATH_QUERY_OP_DICTIONARY, request, reply)) {
+            return nullptr;
+        }
+
+        PathMessageReader reader(reply);
+        uint32_t size = 0;
+        PathTableDictionary decoded;
+        if (!reader.get(size) || reader.remaining() < size ||
+            !decodePathTableDictionary(reader.current(), size, decoded)) {
+            return nullptr;
+        }
+        return &dictionaries.emplace(product, std::move(decoded)).first->second;
+    }
+
+    // Bits for property ids in a product's table; false if any id is unknown
+    bool propertyBits(const std::string& product, const std::vector<std::string>& propertyIds, PropertySet& bits) {
+        const PathTableDictionary* names = dictionary(product);
+        if (!names) {
+            return false;
+        }
+
+        bits = 0;
+        for (const auto& id : propertyIds) {
+            auto it = std::find(names->propertyIds.begin(), names->propertyIds.end(), id);
+            if (it == names->propertyIds.end()) {
+                return false;
+            }
+            bits |= 1ULL << (it - names->propertyIds.begin());
+        }
+        return true;
+    }
+
+    bool query(const PathQueryRequest& request, PathQueryResponse& response) {
+        std::vector<PathQueryResponse> responses;
+        if (!queryBatch(std::vector<PathQueryRequest>(1, request), responses)) {
+            return false;
+        }
+        response = std::move(responses[0]);
+        return true;
+    }
+
+    // Pipelined queries: up to BATCH_WINDOW requests are written before any reply is
+    // read, which lets the server answer them together. Responses line up with requests.
+    bool queryBatch(const std::vector<PathQueryRequest>& requests, std::vector<PathQueryResponse>& responses) {
+        responses.assign(requests.size(), PathQueryResponse());
+        if (!isConnected()) {
+            return false;
+        }
+        uint32_t firstId = nextId;
+        nextId += static_cast<uint32_t>(requests.size());
+
+        for (size_t begin = 0; begin < requests.size(); begin += BATCH_WINDOW) {
+            size_t end = std::min(begin + BATCH_WINDOW, requests.size());
+            for (size_t i = begin; i < end; i++) {
+                PathMessageWriter writer;
+                writer.put(static_cast<uint32_t>(firstId + i));
+                writer.put(static_cast<uint8_t>(PATH_QUERY_OP_QUERY));
+                encodePathQueryRequest(writer, requests[i]);
+                if (!sendPathMessage(socket, writer.bytes())) {
+                    return fail();
+                }
+            }
+
+            for (size_t received = begin; received < end; received++) {
+                std::vector<char> reply;
+                uint32_t id = 0;
+                uint8_t status = 0;
+                if (!receivePathMessage(socket, reply)) {
+                    return fail();
+                }
+
+                PathMessageReader reader(reply);
+                if (!reader.get(id) || !reader.get(status) || id < firstId + begin || id >= firstId + end) {
+                    return fail();
+                }
+
+                PathQueryResponse& response = responses[id - firstId];
+                response.status = status;
+                if (status == PATH_QUERY_OK && !decodePathQueryResponse(reader, response)) {
+                    return fail();
+                }
+            }
+        }
+        return true;
+    }
+
+private:
+    PathSocket socket;
+    uint32_t nextId;
+    std::map<std::string, PathTableDictionary> dictionaries;
+
+    // A broken stream cannot be resynchronised, so drop the connection
+    bool fail() {
+        close();
+        return false;
+    }
+
+    // Single request/reply; the reply body is returned without id and status
+    bool call(PathQueryOp op, const PathMessageWriter& body, std::vector<char>& reply) {
+        if (!isConnected()) {
+            return false;
+        }
+
+        uint32_t id = nextId++;
+        PathMessageWriter writer;
+        writer.put(id);
+        writer.put(static_cast<uint8_t>(op));
+        writer.putBytes(body.bytes());
+        if (!sendPathMessage(socket, writer.bytes())) {
+            return fail();
+        }
+
+        std::vector<char> message;
+        if (!receivePathMessage(socket, message)) {
+            return fail();
+        }
+
+        PathMessageReader reader(message);
+        uint32_t replyId = 0;
+        uint8_t status = 0;
+        if (!reader.get(replyId) || !reader.get(status) || replyId != id) {
+            return fail();
+        }
+        if (status != PATH_QUERY_OK) {
+            return false;
+        }
+        reply.assign(reader.current(), reader.current() + reader.remaining());
+        return true;
+    }
+};
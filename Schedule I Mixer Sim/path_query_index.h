@@ -0,0 +1,568 @@
+#pragma once
+
+#include "path_table.h"
+#include "mapped_path_table.h"
+#include "path_table_scan.h"
+#include "path_answer_cache.h"
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+#include <numeric>
+#include <functional>
+#include <memory>
+#include <queue>
+
+// Set of row positions split into 65536-wide chunks. Sparse chunks are stored as
+// sorted arrays, dense ones as plain bitmaps.
+class ChunkedBitmap {
+public:
+    static constexpr uint32_t CHUNK_BITS = 1 << 16;
+    static constexpr size_t ARRAY_LIMIT = 4096;     // Above this a bitmap is smaller
+
+    struct Chunk {
+        std::vector<uint16_t> values;   // Sorted, when used as an array
+        std::vector<uint64_t> words;    // CHUNK_BITS / 64 words, when used as a bitmap
+        uint32_t cardinality = 0;
+
+        bool isBitmap() const { return !words.empty(); }
+
+        bool contains(uint16_t low) const {
+            if (isBitmap()) {
+                return (words[low >> 6] >> (low & 63)) & 1;
+            }
+            return std::binary_search(values.begin(), values.end(), low);
+        }
+    };
+
+    ChunkedBitmap() : count(0) {}
+
+    explicit ChunkedBitmap(size_t universe) : chunkList((universe + CHUNK_BITS - 1) / CHUNK_BITS), count(0) {}
+
+    // Positions must be added in ascending order
+    void add(uint32_t position) {
+        Chunk& chunk = chunkList[position / CHUNK_BITS];
+        uint16_t low = static_cast<uint16_t>(position % CHUNK_BITS);
+
+        if (chunk.isBitmap()) {
+            chunk.words[low >> 6] |= 1ULL << (low & 63);
+        }
+        else {
+            chunk.values.push_back(low);
+            if (chunk.values.size() > ARRAY_LIMIT) {
+                chunk.words.assign(CHUNK_BITS / 64, 0);
+                for (uint16_t value : chunk.values) {
+                    chunk.words[value >> 6] |= 1ULL << (value & 63);
+                }
+                std::vector<uint16_t>().swap(chunk.values);
+            }
+        }
+
+        chunk.cardinality++;
+        count++;
+    }
+
+    size_t cardinality() const { return count; }
+    size_t chunkCount() const { return chunkList.size(); }
+
+    size_t memoryUsage() const {
+        size_t bytes = chunkList.capacity() * sizeof(Chunk);
+        for (const auto& chunk : chunkList) {
+            bytes += chunk.values.capacity() * sizeof(uint16_t) + chunk.words.capacity() * sizeof(uint64_t);
+        }
+        return bytes;
+    }
+
+    // Call fn(position) for every member in ascending order
+    template <typename Fn>
+    void forEach(Fn fn) const {
+        for (size_t c = 0; c < chunkList.size(); c++) {
+            uint32_t base = static_cast<uint32_t>(c * CHUNK_BITS);
+            const Chunk& chunk = chunkList[c];
+            if (!chunk.isBitmap()) {
+                for (uint16_t low : chunk.values) {
+                    fn(base + low);
+                }
+                continue;
+            }
+            for (size_t w = 0; w < chunk.words.size(); w++) {
+                for (uint64_t word = chunk.words[w]; word; word &= word - 1) {
+                    int bit = 0;
+                    while (!((word >> bit) & 1)) {
+                        bit++;
+                    }
+                    fn(base + static_cast<uint32_t>(w * 64 + bit));
+                }
+            }
+        }
+    }
+    const Chunk& chunk(size_t index) const { return chunkList[index]; }
+
+private:
+    std::vector<Chunk> chunkList;
+    size_t count;
+};
+
+// A path that has some, but not necessarily all, of the desired properties
+struct PathNearMatch {
+    PathQueryMatch match;
+    uint32_t covered;       // Desired properties it has
+    uint32_t extra;         // Properties nobody asked for
+};
+
+// Index for "every path whose properties include these" queries. Rows are ranked by
+// their best path (fewest ingredients, then highest base value bonus), and each
+// property bit keeps a bitmap of the ranks containing it. Intersecting the bitmaps
+// yields matches already in rank order, so the best paths come out first.
+class PathQueryIndex {
+public:
+    PathQueryIndex() {}
+
+    explicit PathQueryIndex(const PathTableView& view) : PathQueryIndex(view, SIZE_MAX) {}
+
+    // Index only the rows whose best path has at most maxLength ingredients. Ranking is
+    // by length first, so these are exactly the first ranks of the full index.
+    PathQueryIndex(const PathTableView& view, size_t maxLength) : view(view) {
+        // Rows without entries sort last
+        auto bestLength = [&view](uint32_t row) {
+            auto entries = view.entriesAt(row);
+            return entries.empty() ? SIZE_MAX : entries.front().ingredientSequence.size();
+        };
+        if (maxLength == SIZE_MAX) {
+            rankToRow.resize(view.size());
+            std::iota(rankToRow.begin(), rankToRow.end(), 0u);
+        }
+        else {
+            for (uint32_t row = 0; row < view.size(); row++) {
+                if (bestLength(row) <= maxLength) {
+                    rankToRow.push_back(row);
+                }
+            }
+        }
+
+        auto bestBonus = [&view](uint32_t row) {
+            auto entries = view.entriesAt(row);
+            return entries.empty() ? 0.0f : entries.front().baseValueBonus;
+        };
+        std::sort(rankToRow.begin(), rankToRow.end(), [&](uint32_t a, uint32_t b) {
+            size_t lengthA = bestLength(a), lengthB = bestLength(b);
+            if (lengthA != lengthB) return lengthA < lengthB;
+            float bonusA = bestBonus(a), bonusB = bestBonus(b);
+            if (bonusA != bonusB) return bonusA > bonusB;
+            return a < b;
+        });
+
+        for (auto& bitmap : propertyBitmaps) {
+            bitmap = ChunkedBitmap(rankToRow.size());
+        }
+        for (uint32_t rank = 0; rank < rankToRow.size(); rank++) {
+            PropertySet key = view.keyAt(rankToRow[rank]);
+            while (key) {
+                int bit = lowestBit(key);
+                propertyBitmaps[bit].add(rank);
+                key &= key - 1;
+            }
+        }
+    }
+
+    size_t size() const { return rankToRow.size(); }
+    uint32_t rowAt(uint32_t rank) const { return rankToRow[rank]; }
+    const std::vector<uint32_t>& rowOrder() const { return rankToRow; }
+    const PathTableView& tableView() const { return view; }
+
+    size_t memoryUsage() const {
+        size_t bytes = rankToRow.capacity() * sizeof(uint32_t);
+        for (const auto& bitmap : propertyBitmaps) {
+            bytes += bitmap.memoryUsage();
+        }
+        return bytes;
+    }
+
+    // Call fn(rank) for every row whose key contains all required bits, in rank
+    // order, until fn returns false
+    template <typename Fn>
+    void forEachSuperset(PropertySet required, Fn fn) const {
+        if (required == 0) {
+            for (uint32_t rank = 0; rank < rankToRow.size(); rank++) {
+                if (!fn(rank)) return;
+            }
+            return;
+        }
+
+        std::vector<const ChunkedBitmap*> selected;
+        for (PropertySet bits = required; bits; bits &= bits - 1) {
+            selected.push_back(&propertyBitmaps[lowestBit(bits)]);
+        }
+
+        size_t chunkCount = selected[0]->chunkCount();
+        std::vector<const ChunkedBitmap::Chunk*> chunks(selected.size());
+
+        for (size_t c = 0; c < chunkCount; c++) {
+            // Drive the intersection from the smallest container in this chunk
+            size_t driver = 0;
+            bool empty = false;
+            for (size_t i = 0; i < selected.size(); i++) {
+                chunks[i] = &selected[i]->chunk(c);
+                if (chunks[i]->cardinality == 0) {
+                    empty = true;
+                    break;
+                }
+                if (chunks[i]->cardinality < chunks[driver]->cardinality) {
+                    driver = i;
+                }
+            }
+            if (empty) continue;
+
+            uint32_t base = static_cast<uint32_t>(c * ChunkedBitmap::CHUNK_BITS);
+            const ChunkedBitmap::Chunk& lead = *chunks[driver];
+
+            if (!lead.isBitmap()) {
+                for (uint16_t low : lead.values) {
+                    bool all = true;
+                    for (size_t i = 0; i < chunks.size() && all; i++) {
+                        all = i == driver || chunks[i]->contains(low);
+                    }
+                    if (all && !fn(base + low)) return;
+                }
+                continue;
+            }
+
+            // The smallest container is a bitmap, so all of them are
+            for (size_t w = 0; w < lead.words.size(); w++) {
+                uint64_t word = lead.words[w];
+                for (size_t i = 0; i < chunks.size() && word; i++) {
+                    word &= chunks[i]->words[w];
+                }
+                while (word) {
+                    if (!fn(base + static_cast<uint32_t>(w * 64 + lowestBit(word)))) return;
+                    word &= word - 1;
+                }
+            }
+        }
+    }
+
+    // Best `limit` paths among keys containing all required bits. With countAll the
+    // whole match set is walked so matchingKeys/totalPaths are exact; without it the
+    // walk stops as soon as no later key can beat the paths already found, which for
+    // limit 1 is usually the first accepted row.
+    PathQueryResult findSupersets(PropertySet required, size_t limit, bool countAll = false) const {
+        PathScanFilter filter;
+        filter.include = required;
+        return findMatches(filter, limit, countAll);
+    }
+
+    // findSupersets with the rest of the filter checked on the rows the bitmaps
+    // produce, so exclusions and ranges never need a full table scan. Rows whose
+    // paths all fail the path conditions do not count as matches.
+    PathQueryResult findMatches(const PathScanFilter& filter, size_t limit, bool countAll = false) const {
+        PathQueryResult result;
+        size_t cutoffLength = SIZE_MAX;
+        bool checkRows = !filter.isPlain();
+        bool checkPaths = filter.hasPathConditions();
+        std::vector<const CompactPathEntry*> accepted;
+
+        // (length, -bonus) of the best `limit` paths so far, worst on top
+        std::priority_queue<std::pair<size_t, float>> kept;
+
+        forEachSuperset(filter.include, [&](uint32_t rank) {
+            uint32_t row = rankToRow[rank];
+            PropertySet key = view.keyAt(row);
+            auto entries = view.entriesAt(row);
+            if (entries.empty() || (checkRows && !filter.acceptsRow(key, entries.front().addictiveness))) {
+                return true;
+            }
+
+            // Ranks are ordered by shortest path, so nothing after this can qualify
+            bool beyondCutoff = entries.front().ingredientSequence.size() > cutoffLength;
+            if (beyondCutoff && !countAll) {
+                return false;
+            }
+
+            accepted.clear();
+            for (const auto& entry : entries) {
+                if (!checkPaths || filter.acceptsPath(entry)) {
+                    accepted.push_back(&entry);
+                }
+            }
+            if (accepted.empty()) {
+                return true;
+            }
+
+            result.matchingKeys++;
+            result.totalPaths += accepted.size();
+            if (beyondCutoff) {
+                return true;
+            }
+
+            for (const CompactPathEntry* entry : accepted) {
+                if (entry->ingredientSequence.size() <= cutoffLength) {
+                    result.paths.push_back({ key, entry });
+                    kept.push({ entry->ingredientSequence.size(), -entry->baseValueBonus });
+                    if (kept.size() > limit) {
+                        kept.pop();
+                    }
+                }
+            }
+
+            if (limit > 0 && kept.size() >= limit) {
+                cutoffLength = kept.top().first;
+
+                // Later rows rank after this row's best path and none of their paths beats
+                // it; ties keep the earlier path, so once every kept path is at least as
+                // good as this row's best the answer is final
+                std::pair<size_t, float> rowBest(entries.front().ingredientSequence.size(), -entries.front().baseValueBonus);
+                if (!countAll && !(rowBest < kept.top())) {
+                    return false;
+                }
+            }
+            return true;
+        });
+
+        std::stable_sort(result.paths.begin(), result.paths.end(),
+            [](const PathQueryMatch& a, const PathQueryMatch& b) {
+                if (a.entry->ingredientSequence.size() == b.entry->ingredientSequence.size()) {
+                    return a.entry->baseValueBonus > b.entry->baseValueBonus;
+                }
+                return a.entry->ingredientSequence.size() < b.entry->ingredientSequence.size();
+            });
+        if (result.paths.size() > limit) {
+            result.paths.resize(limit);
+        }
+
+        return result;
+    }
+
+    // Closest achievable property sets, for when no key has every required bit. Rows
+    // are bucketed by how many required bits they share, counted straight from the
+    // property bitmaps so rows without any of them are never touched. Each property
+    // set appears once, with its best accepted path. Ranked by bits covered, then
+    // fewest extra properties, then fewest ingredients and highest bonus, then index
+    // rank. Every condition of the filter other than include still applies.
+    std::vector<PathNearMatch> findNearest(const PathScanFilter& filter, size_t limit) const {
+        std::vector<PathNearMatch> result;
+        uint32_t requiredCount = bitCount(filter.include);
+        if (requiredCount == 0 || limit == 0) {
+            return result;
+        }
+
+        std::vector<uint8_t> coverage(rankToRow.size(), 0);
+        std::vector<uint32_t> touched;
+        for (PropertySet bits = filter.include; bits; bits &= bits - 1) {
+            propertyBitmaps[lowestBit(bits)].forEach([&](uint32_t rank) {
+                if (coverage[rank]++ == 0) {
+                    touched.push_back(rank);
+                }
+            });
+        }
+
+        std::vector<std::vector<uint32_t>> buckets(requiredCount + 1);
+        for (uint32_t rank : touched) {
+            uint32_t row = rankToRow[rank];
+            auto entries = view.entriesAt(row);
+            if (!entries.empty() && filter.passesRowLimits(view.keyAt(row), entries.front().addictiveness)) {
+                buckets[coverage[rank]].push_back(rank);
+            }
+        }
+
+        // Best buckets first; only as many candidates as the limit still needs are ranked
+        struct Candidate {
+            PathNearMatch near;
+            uint32_t rank;
+        };
+        auto betterPath = [](const CompactPathEntry& a, const CompactPathEntry& b) {
+            if (a.ingredientSequence.size() != b.ingredientSequence.size()) {
+                return a.ingredientSequence.size() < b.ingredientSequence.size();
+            }
+            return a.baseValueBonus > b.baseValueBonus;
+        };
+        std::vector<Candidate> candidates;
+        for (uint32_t covered = requiredCount; covered > 0 && result.size() < limit; covered--) {
+            candidates.clear();
+            for (uint32_t rank : buckets[covered]) {
+                uint32_t row = rankToRow[rank];
+                const CompactPathEntry* best = nullptr;
+                for (const auto& entry : view.entriesAt(row)) {
+                    if (filter.acceptsPath(entry) && (!best || betterPath(entry, *best))) {
+                        best = &entry;
+                    }
+                }
+                if (best) {
+                    PropertySet key = view.keyAt(row);
+                    candidates.push_back({ { { key, best }, covered, bitCount(key) - covered }, rank });
+                }
+            }
+
+            size_t take = std::min(limit - result.size(), candidates.size());
+            std::partial_sort(candidates.begin(), candidates.begin() + take, candidates.end(),
+                [&](const Candidate& a, const Candidate& b) {
+                    if (a.near.extra != b.near.extra) return a.near.extra < b.near.extra;
+                    if (betterPath(*a.near.match.entry, *b.near.match.entry)) return true;
+                    if (betterPath(*b.near.match.entry, *a.near.match.entry)) return false;
+                    return a.rank < b.rank;
+                });
+            for (size_t i = 0; i < take; i++) {
+                result.push_back(candidates[i].near);
+            }
+        }
+
+        return result;
+    }
+
+private:
+    PathTableView view;
+    std::vector<uint32_t> rankToRow;
+    ChunkedBitmap propertyBitmaps[64];
+
+    static uint32_t bitCount(uint64_t value) {
+        uint32_t count = 0;
+        for (; value; value &= value - 1) {
+            count++;
+        }
+        return count;
+    }
+
+    static int lowestBit(uint64_t value) {
+        int bit = 0;
+        while (!(value & 1)) {
+            value >>= 1;
+            bit++;
+        }
+        return bit;
+    }
+};
+
+// A loaded table together with its query index, column scanner and, optionally,
+// precomputed answers for small queries
+struct IndexedPathTable {
+    MappedPathTable table;
+    PathQueryIndex index;
+    PathTableScanner scanner;
+    PathAnswerCache answers;
+
+    // Set on the partial tables of a progressive load: they index rows of this
+    // table's data and keep it alive
+    std::shared_ptr<const IndexedPathTable> dataSource;
+    size_t completedLength = SIZE_MAX;  // Partial tables: every row whose best path is this short is indexed
+
+    void rebuildIndex() {
+        answers.close();
+        index = PathQueryIndex(table.view());
+        scanner = PathTableScanner(table.view());
+    }
+
+    // Use an answer file if it was built from this table (tableChecksum is the
+    // dataChecksum of the loaded file)
+    bool attachAnswers(const std::string& filename, uint64_t tableChecksum) {
+        return answers.open(filename, table.view(), tableChecksum);
+    }
+
+    bool writeAnswers(const std::string& filename, uint32_t propertyCount, uint32_t maxTerms,
+        uint32_t answersPerQuery, uint64_t tableChecksum, size_t threads) const {
+        return writePathAnswerCache(table.view(), index.rowOrder(), propertyCount, maxTerms, answersPerQuery,
+            tableChecksum, threads, filename);
+    }
+
+
+    // Plain "contains all" filters are answered from the answer cache when it covers
+    // them. Anything with required properties walks the bitmap index and checks the
+    // other conditions on the way; only filters without any go to a column scan.
+    // Match counts are always exact.
+    PathQueryResult query(const PathScanFilter& filter, size_t limit) const {
+        return run(filter, limit, true);
+    }
+
+    // Like query(), but counts are only exact when the answer came from the cache
+    PathQueryResult best(const PathScanFilter& filter, size_t limit) const {
+        return run(filter, limit, false);
+    }
+
+    // Whether the best limit paths found with this filter are those the full table
+    // would give. Always so for a full table. A partial one only holds rows whose best
+    // path is at most completedLength long, so with path conditions (a bonus range, or
+    // neverThrough checked at every step) a row may only have an accepted path that is
+    // longer, and anything found beyond that length could still be beaten.
+    bool isFinal(const PathScanFilter& filter, size_t limit, const PathQueryResult& result) const {
+        if (!dataSource) {
+            return true;
+        }
+        if (result.paths.size() < limit) {
+            return false;
+        }
+        return !filter.hasPathConditions() || result.paths.back().entry->ingredientSequence.size() <= completedLength;
+    }
+
+    std::vector<PathNearMatch> findNearest(const PathScanFilter& filter, size_t limit) const {
+        return index.findNearest(filter, limit);
+    }
+
+    // Heap bytes held by the table and its indexes; mapped file pages are not counted
+    size_t memoryUsage() const {
+        return table.memoryUsage() + index.memoryUsage() + scanner.memoryUsage();
+    }
+
+private:
+    PathQueryResult run(const PathScanFilter& filter, size_t limit, bool countAll) const {
+        PathQueryResult result;
+        if (filter.isPlain() && answers.lookup(filter.include, limit, table.view(), result)) {
+            return result;
+        }
+        if (filter.include == 0 && !filter.isPlain()) {
+            return scanner.query(filter, limit);
+        }
+        return index.findMatches(filter, limit, countAll);
+    }
+};
+
+// Rows a table needs before indexing it progressively is worth the extra work
+const size_t PROGRESSIVE_INDEX_MIN_ROWS = 100000;
+
+// Index a freshly opened table, handing out usable partial tables on the way. Each
+// partial indexes only the rows whose best path has at most 1, 2, ... ingredients,
+// the first ranks of the full index. Matches found in a partial are only final when
+// IndexedPathTable::isFinal says so. Stages are skipped unless they at least double the rows indexed and
+// stay under half the table, which bounds the extra work to about one more index build.
+inline void indexPathTableProgressively(const std::shared_ptr<IndexedPathTable>& table,
+    const std::function<void(std::shared_ptr<IndexedPathTable>)>& publish, PathTableLoadProgress* progress = nullptr) {
+    const PathTableView& view = table->table.view();
+    if (progress) {
+        progress->rowsTotal = view.size();
+        progress->rowsIndexed = 0;
+    }
+
+    if (publish && view.size() >= PROGRESSIVE_INDEX_MIN_ROWS) {
+        std::vector<size_t> rowsOfLength;
+        for (size_t row = 0; row < view.size(); row++) {
+            auto entries = view.entriesAt(row);
+            if (!entries.empty()) {
+                size_t length = entries.front().ingredientSequence.size();
+                if (length >= rowsOfLength.size()) {
+                    rowsOfLength.resize(length + 1, 0);
+                }
+                rowsOfLength[length]++;
+            }
+        }
+
+        size_t rows = 0;
+        size_t published = 0;
+        for (size_t length = 0; length < rowsOfLength.size(); length++) {
+            rows += rowsOfLength[length];
+            if (rows == 0 || rows < published * 2 || rows > view.size() / 2) {
+                continue;
+            }
+
+            auto partial = std::make_shared<IndexedPathTable>();
+            partial->index = PathQueryIndex(view, length);
+            partial->dataSource = table;
+            partial->completedLength = length;
+            published = rows;
+            if (progress) {
+                progress->rowsIndexed = rows;
+            }
+            publish(partial);
+        }
+    }
+
+    table->rebuildIndex();
+    if (progress) {
+        progress->rowsIndexed = view.size();
+    }
+}
@@ -0,0 +1,335 @@
+#pragma once
+
+#include "path_table.h"
+#include "path_table_file.h"
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <winsock2.h>
+#include <afunix.h>
+#ifdef _MSC_VER
+#pragma comment(lib, "Ws2_32.lib")
+#endif
+#else
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+// Wire protocol of the path query server. Every message is a little-endian u32
+// payload length followed by the payload. Requests start with [u32 id][u8 op],
+// responses with [u32 id][u8 status]; the id is echoed back so clients can keep
+// many requests in flight and match replies that arrive out of order.
+//
+//   LIST       -> [u16 count][string product]...
+//   DICTIONARY [string product] -> [u32 size][encoded PathTableDictionary]
+//   QUERY      [string product][u64 include][u64 exclude][u16 limit]
+//              -> [u32 matchingKeys][u64 totalPaths][u16 count]([u64 properties][CompactPathEntry])...
+//
+// Strings are [u16 length][bytes]. Property bits and ingredient indices follow the
+// table's own dictionary, which clients fetch once per product.
+
+const char* const PATH_QUERY_DEFAULT_SOCKET = "schedule1_paths.sock";
+const uint32_t PATH_QUERY_MAX_MESSAGE = 16 * 1024 * 1024;
+const uint16_t PATH_QUERY_MAX_LIMIT = 1000;
+
+enum PathQueryOp : uint8_t {
+    PATH_QUERY_OP_LIST = 1,
+    PATH_QUERY_OP_DICTIONARY = 2,
+    PATH_QUERY_OP_QUERY = 3
+};
+
+enum PathQueryStatus : uint8_t {
+    PATH_QUERY_OK = 0,
+    PATH_QUERY_UNKNOWN_TABLE = 1,
+    PATH_QUERY_BAD_REQUEST = 2
+};
+
+// =================== SOCKETS ===================
+
+#ifdef _WIN32
+using PathSocket = SOCKET;
+const PathSocket INVALID_PATH_SOCKET = INVALID_SOCKET;
+#else
+using PathSocket = int;
+const PathSocket INVALID_PATH_SOCKET = -1;
+#endif
+
+// Winsock has to be started once per process; a no-op elsewhere
+inline bool initPathSockets() {
+#ifdef _WIN32
+    WSADATA data;
+    return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+#else
+    return true;
+#endif
+}
+
+inline void closePathSocket(PathSocket socket) {
+#ifdef _WIN32
+    closesocket(socket);
+#else
+    ::close(socket);
+#endif
+}
+
+inline bool makePathSocketAddress(const std::string& path, sockaddr_un& address) {
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+        return false;
+    }
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    return true;
+}
+
+inline PathSocket connectPathSocket(const std::string& path) {
+    sockaddr_un address;
+    if (!makePathSocketAddress(path, address)) {
+        return INVALID_PATH_SOCKET;
+    }
+
+    PathSocket result = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (result == INVALID_PATH_SOCKET) {
+        return result;
+    }
+    if (connect(result, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        closePathSocket(result);
+        return INVALID_PATH_SOCKET;
+    }
+    return result;
+}
+
+// Whether path exists and is a socket file (on Windows, the reparse point an
+// AF_UNIX socket leaves behind)
+inline bool isPathSocketFile(const std::string& path) {
+#ifdef _WIN32
+    DWORD attributes = GetFileAttributesA(path.c_str());
+    return attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_REPARSE_POINT) != 0;
+#else
+    struct stat status;
+    return lstat(path.c_str(), &status) == 0 && S_ISSOCK(status.st_mode);
+#endif
+}
+
+// Bind and listen, replacing a socket file left behind by an earlier server. Fails
+// with a reason if a server still answers on path or path is some other file.
+inline PathSocket listenPathSocket(const std::string& path, std::string& reason) {
+    sockaddr_un address;
+    if (!makePathSocketAddress(path, address)) {
+        reason = "socket path is empty or too long";
+        return INVALID_PATH_SOCKET;
+    }
+
+    PathSocket running = connectPathSocket(path);
+    if (running != INVALID_PATH_SOCKET) {
+        closePathSocket(running);
+        reason = "server already running";
+        return INVALID_PATH_SOCKET;
+    }
+    if (isPathSocketFile(path)) {
+        std::remove(path.c_str());
+    }
+
+    PathSocket result = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (result == INVALID_PATH_SOCKET) {
+        reason = "could not create a socket";
+        return result;
+    }
+    if (bind(result, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(result, SOMAXCONN) != 0) {
+#ifdef _WIN32
+        reason = "error " + std::to_string(WSAGetLastError());
+#else
+        reason = std::strerror(errno);
+#endif
+        closePathSocket(result);
+        return INVALID_PATH_SOCKET;
+    }
+    return result;
+}
+
+inline bool sendPathBytes(PathSocket socket, const char* data, size_t size) {
+#ifdef MSG_NOSIGNAL
+    const int flags = MSG_NOSIGNAL;     // A vanished peer is an error, not a signal
+#else
+    const int flags = 0;
+#endif
+    while (size > 0) {
+        int chunk = static_cast<int>(std::min<size_t>(size, 1 << 20));
+        int sent = static_cast<int>(send(socket, data, chunk, flags));
+        if (sent <= 0) {
+            return false;
+        }
+        data += sent;
+        size -= static_cast<size_t>(sent);
+    }
+    return true;
+}
+
+inline bool receivePathBytes(PathSocket socket, char* data, size_t size) {
+    while (size > 0) {
+        int chunk = static_cast<int>(std::min<size_t>(size, 1 << 20));
+        int received = static_cast<int>(recv(socket, data, chunk, 0));
+        if (received <= 0) {
+            return false;
+        }
+        data += received;
+        size -= static_cast<size_t>(received);
+    }
+    return true;
+}
+
+inline bool sendPathMessage(PathSocket socket, const std::vector<char>& payload) {
+    uint32_t size = static_cast<uint32_t>(payload.size());
+    std::vector<char> frame(reinterpret_cast<const char*>(&size), reinterpret_cast<const char*>(&size) + sizeof(size));
+    frame.insert(frame.end(), payload.begin(), payload.end());
+    return sendPathBytes(socket, frame.data(), frame.size());
+}
+
+inline bool receivePathMessage(PathSocket socket, std::vector<char>& payload) {
+    uint32_t size = 0;
+    if (!receivePathBytes(socket, reinterpret_cast<char*>(&size), sizeof(size)) || size > PATH_QUERY_MAX_MESSAGE) {
+        return false;
+    }
+    payload.resize(size);
+    return size == 0 || receivePathBytes(socket, payload.data(), size);
+}
+
+// =================== MESSAGES ===================
+
+class PathMessageWriter {
+public:
+    template <typename T>
+    void put(const T& value) {
+        const char* bytes = reinterpret_cast<const char*>(&value);
+        data.insert(data.end(), bytes, bytes + sizeof(T));
+    }
+
+    void putString(const std::string& value) {
+        uint16_t length = static_cast<uint16_t>(std::min<size_t>(value.size(), UINT16_MAX));
+        put(length);
+        data.insert(data.end(), value.begin(), value.begin() + length);
+    }
+
+    void putBytes(const std::vector<char>& bytes) {
+        data.insert(data.end(), bytes.begin(), bytes.end());
+    }
+
+    std::vector<char>& bytes() { return data; }
+    const std::vector<char>& bytes() const { return data; }
+
+private:
+    std::vector<char> data;
+};
+
+// Reads fields in order; once a read runs past the end every later read fails too
+class PathMessageReader {
+public:
+    explicit PathMessageReader(const std::vector<char>& data) : position(data.data()), end(data.data() + data.size()) {}
+
+    template <typename T>
+    bool get(T& value) {
+        if (static_cast<size_t>(end - position) < sizeof(T)) {
+            valid = false;
+            return false;
+        }
+        std::memcpy(&value, position, sizeof(T));
+        position += sizeof(T);
+        return valid;
+    }
+
+    bool getString(std::string& value) {
+        uint16_t length = 0;
+        if (!get(length) || static_cast<size_t>(end - position) < length) {
+            valid = false;
+            return false;
+        }
+        value.assign(position, length);
+        position += length;
+        return true;
+    }
+
+    const char* current() const { return position; }
+    size_t remaining() const { return static_cast<size_t>(end - position); }
+    bool skip(size_t bytes) {
+        if (remaining() < bytes) {
+            valid = false;
+            return false;
+        }
+        position += bytes;
+        return valid;
+    }
+
+private:
+    const char* position;
+    const char* end;
+    bool valid = true;
+};
+
+struct PathQueryRequest {
+    std::string product;
+    PropertySet include = 0;    // Every one of these properties
+    PropertySet exclude = 0;    // None of these
+    uint16_t limit = 5;
+};
+
+struct PathQueryHit {
+    PropertySet properties;
+    CompactPathEntry entry;
+};
+
+struct PathQueryResponse {
+    uint8_t status = PATH_QUERY_BAD_REQUEST;
+    uint32_t matchingKeys = 0;
+    uint64_t totalPaths = 0;
+    std::vector<PathQueryHit> paths;
+};
+
+inline void encodePathQueryRequest(PathMessageWriter& writer, const PathQueryRequest& request) {
+    writer.putString(request.product);
+    writer.put(request.include);
+    writer.put(request.exclude);
+    writer.put(request.limit);
+}
+
+inline bool decodePathQueryRequest(PathMessageReader& reader, PathQueryRequest& request) {
+    return reader.getString(request.product) && reader.get(request.include) &&
+        reader.get(request.exclude) && reader.get(request.limit);
+}
+
+// Body of a QUERY response (after id and status)
+inline void encodePathQueryResult(PathMessageWriter& writer, const PathQueryResult& result) {
+    writer.put(static_cast<uint32_t>(result.matchingKeys));
+    writer.put(static_cast<uint64_t>(result.totalPaths));
+    writer.put(static_cast<uint16_t>(result.paths.size()));
+    for (const auto& match : result.paths) {
+        writer.put(match.properties);
+        writer.put(*match.entry);
+    }
+}
+
+inline bool decodePathQueryResponse(PathMessageReader& reader, PathQueryResponse& response) {
+    uint16_t count = 0;
+    if (!reader.get(response.matchingKeys) || !reader.get(response.totalPaths) || !reader.get(count)) {
+        return false;
+    }
+    response.paths.resize(count);
+    for (auto& hit : response.paths) {
+        if (!reader.get(hit.properties) || !reader.get(hit.entry)) {
+            return false;
+        }
+    }
+    return true;
+}
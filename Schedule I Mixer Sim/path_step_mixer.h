@@ -0,0 +1,60 @@
+#pragma once
+
+#include "property_mixer_core.h"
+#include "path_table_scan.h"
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// PathScanFilter::stepProperties for tables generated from the mixing rules: replays
+// a path's mixes from the starting properties and collects every property it shows
+// on the way. Kept apart from path_table_scan.h so that query code without the
+// mixing data does not depend on it.
+class PathStepMixer {
+public:
+    PathStepMixer() {}
+
+    // ingredientNames: by ingredient index; ingredientPropertyIds: property id each
+    // ingredient adds; propertyBits: key bit of every property id
+    PathStepMixer(const std::vector<Property*>& start, const std::vector<std::string>& ingredientNames,
+        const std::map<std::string, std::string>& ingredientPropertyIds,
+        const std::unordered_map<std::string, uint64_t>& propertyBits)
+        : start(start), propertyBits(propertyBits) {
+        for (const auto& name : ingredientNames) {
+            auto it = ingredientPropertyIds.find(name);
+            ingredientProperties.push_back(it != ingredientPropertyIds.end() ? getPropertyByNameOrId(it->second) : nullptr);
+        }
+    }
+
+    // Union of the properties at every step of a path, starting properties included
+    PropertySet operator()(const CompactPathEntry& entry) const {
+        std::vector<Property*> props = start;
+        PropertySet seen = bitsOf(props);
+
+        for (uint8_t idx : entry.ingredientSequence) {
+            if (idx >= ingredientProperties.size()) {
+                break;
+            }
+            if (ingredientProperties[idx]) {
+                props = PropertyMixCalculator::mixProperties(props, ingredientProperties[idx], DrugType::Marijuana);
+                seen |= bitsOf(props);
+            }
+        }
+        return seen;
+    }
+
+private:
+    std::vector<Property*> start;
+    std::vector<Property*> ingredientProperties;    // By ingredient index
+    std::unordered_map<std::string, uint64_t> propertyBits;
+
+    PropertySet bitsOf(const std::vector<Property*>& props) const {
+        PropertySet bits = 0;
+        for (auto* prop : props) {
+            auto it = propertyBits.find(prop->id);
+            bits |= it != propertyBits.end() ? it->second : 0;
+        }
+        return bits;
+    }
+};
@@ -0,0 +1,572 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <algorithm>
+#include <utility>
+#include <initializer_list>
+#include <thread>
+#include <atomic>
+
+// Bit representation of properties (64 bits max)
+using PropertySet = uint64_t;
+
+// Run fn(i) for every i in [0, count) on up to `threads` threads (the caller's
+// included), handing out indices one at a time
+template <typename Fn>
+inline void parallelFor(size_t count, size_t threads, Fn fn) {
+    threads = std::min(threads, count);
+    if (threads <= 1) {
+        for (size_t i = 0; i < count; i++) {
+            fn(i);
+        }
+        return;
+    }
+
+    std::atomic<size_t> next(0);
+    auto work = [&]() {
+        for (size_t i = next++; i < count; i = next++) {
+            fn(i);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (size_t t = 1; t < threads; t++) {
+        workers.emplace_back(work);
+    }
+    work();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+// Fixed-capacity ingredient sequence so path entries stay trivially copyable.
+// Mapped tables are used without checking every entry, so a stored length past
+// MAX_LENGTH reads as MAX_LENGTH; ingredient indices are checked where they are
+// turned into names.
+struct IngredientSequence {
+    static constexpr size_t MAX_LENGTH = 15;
+
+    uint8_t length;
+    uint8_t items[MAX_LENGTH];
+
+    IngredientSequence() : length(0), items() {}
+    IngredientSequence(std::initializer_list<uint8_t> init) : length(0), items() {
+        for (uint8_t idx : init) {
+            push_back(idx);
+        }
+    }
+
+    size_t size() const { return std::min<size_t>(length, MAX_LENGTH); }
+    bool empty() const { return length == 0; }
+    bool full() const { return length == MAX_LENGTH; }
+
+    // Appends are ignored once the sequence is full; callers cap the depth up front
+    void push_back(uint8_t idx) {
+        if (length < MAX_LENGTH) {
+            items[length++] = idx;
+        }
+    }
+
+    void pop_back() {
+        if (length > 0) {
+            length--;
+        }
+    }
+
+    void clear() { length = 0; }
+
+    void resize(size_t newLength) {
+        newLength = std::min(newLength, MAX_LENGTH);
+        for (size_t i = length; i < newLength; i++) {
+            items[i] = 0;
+        }
+        length = static_cast<uint8_t>(newLength);
+    }
+
+    uint8_t& operator[](size_t i) { return items[i]; }
+    uint8_t operator[](size_t i) const { return items[i]; }
+    uint8_t back() const { return items[size() - 1]; }
+
+    uint8_t* begin() { return items; }
+    uint8_t* end() { return items + size(); }
+    const uint8_t* begin() const { return items; }
+    const uint8_t* end() const { return items + size(); }
+
+    bool operator==(const IngredientSequence& other) const {
+        return size() == other.size() && std::equal(begin(), end(), other.begin());
+    }
+    bool operator!=(const IngredientSequence& other) const { return !(*this == other); }
+};
+
+// Compact path entry structure with sequence preservation
+struct CompactPathEntry {
+    IngredientSequence ingredientSequence;  // Sequence of ingredient indices (0-15)
+    float baseValueBonus;
+    float addictiveness;
+    float valueMultiplier;
+
+    // Constructor for convenience
+    CompactPathEntry() : baseValueBonus(0), addictiveness(0), valueMultiplier(1.0f) {}
+};
+
+// Main lookup table: property bitset -> paths.
+// Keys are kept sorted in one array, the entries of each key sit contiguously in a
+// single arena, and an open-addressing index over the keys answers point lookups.
+class PropertyPathTable {
+public:
+    // Read-only view of the entries stored for one key
+    class EntryRange {
+    public:
+        EntryRange() : first(nullptr), last(nullptr) {}
+        EntryRange(const CompactPathEntry* first, const CompactPathEntry* last) : first(first), last(last) {}
+
+        const CompactPathEntry* begin() const { return first; }
+        const CompactPathEntry* end() const { return last; }
+        size_t size() const { return static_cast<size_t>(last - first); }
+        bool empty() const { return first == last; }
+        const CompactPathEntry& operator[](size_t i) const { return first[i]; }
+        const CompactPathEntry& front() const { return *first; }
+
+    private:
+        const CompactPathEntry* first;
+        const CompactPathEntry* last;
+    };
+
+    // Iterates keys in ascending order, yielding (key, entries) pairs
+    class const_iterator {
+    public:
+        const_iterator(const PropertyPathTable* table, size_t index) : table(table), index(index) {}
+
+        std::pair<PropertySet, EntryRange> operator*() const {
+            return { table->keyAt(index), table->entriesAt(index) };
+        }
+        const_iterator& operator++() { index++; return *this; }
+        bool operator==(const const_iterator& other) const { return index == other.index; }
+        bool operator!=(const const_iterator& other) const { return index != other.index; }
+
+    private:
+        const PropertyPathTable* table;
+        size_t index;
+    };
+
+    PropertyPathTable() : offsetList(1, 0), slotMask(0) {}
+
+    // Number of distinct property combinations
+    size_t size() const { return keyList.size(); }
+    bool empty() const { return keyList.empty(); }
+
+    // Total number of stored paths across all keys
+    size_t entryCount() const { return entryArena.size(); }
+
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, keyList.size()); }
+
+    PropertySet keyAt(size_t index) const { return keyList[index]; }
+
+    EntryRange entriesAt(size_t index) const {
+        const CompactPathEntry* base = entryArena.data();
+        return EntryRange(base + offsetList[index], base + offsetList[index + 1]);
+    }
+
+    // Position of a key in the sorted key array, or size() if absent
+    size_t indexOf(PropertySet key) const {
+        if (slots.empty()) {
+            return keyList.size();
+        }
+        for (size_t slot = hashKey(key) & slotMask; ; slot = (slot + 1) & slotMask) {
+            uint32_t stored = slots[slot];
+            if (stored == 0) {
+                return keyList.size();
+            }
+            if (keyList[stored - 1] == key) {
+                return stored - 1;
+            }
+        }
+    }
+
+    bool contains(PropertySet key) const { return indexOf(key) != keyList.size(); }
+
+    // Entries for a key; empty range if the key is not present
+    EntryRange find(PropertySet key) const {
+        size_t index = indexOf(key);
+        return index == keyList.size() ? EntryRange() : entriesAt(index);
+    }
+
+    // Raw column access for serialization
+    const std::vector<PropertySet>& keys() const { return keyList; }
+    const std::vector<uint32_t>& offsets() const { return offsetList; }
+    const std::vector<CompactPathEntry>& entries() const { return entryArena; }
+
+    void clear() {
+        std::vector<PropertySet>().swap(keyList);
+        std::vector<uint32_t>(1, 0).swap(offsetList);
+        std::vector<CompactPathEntry>().swap(entryArena);
+        std::vector<uint32_t>().swap(slots);
+        slotMask = 0;
+    }
+
+    void swap(PropertyPathTable& other) {
+        keyList.swap(other.keyList);
+        offsetList.swap(other.offsetList);
+        entryArena.swap(other.entryArena);
+        slots.swap(other.slots);
+        std::swap(slotMask, other.slotMask);
+    }
+
+    // Adopt already-grouped columns: keys strictly ascending, offsets of size keys + 1
+    static PropertyPathTable fromSortedColumns(std::vector<PropertySet>&& keys,
+        std::vector<uint32_t>&& offsets,
+        std::vector<CompactPathEntry>&& entries) {
+        PropertyPathTable table;
+        table.keyList = std::move(keys);
+        table.offsetList = std::move(offsets);
+        table.entryArena = std::move(entries);
+        table.rebuildIndex();
+        return table;
+    }
+
+    // Rewrite every key's entries in place. fn(key, entries, count) may reorder the
+    // entries and returns how many of the leading ones to keep; keys left with no
+    // entries are dropped and the arena is compacted in a single pass.
+    template <typename Fn>
+    void rewriteGroups(Fn fn) {
+        size_t keyWrite = 0;
+        uint32_t entryWrite = 0;
+
+        for (size_t i = 0; i < keyList.size(); i++) {
+            uint32_t begin = offsetList[i];
+            uint32_t count = offsetList[i + 1] - begin;
+
+            size_t keep = std::min<size_t>(fn(keyList[i], entryArena.data() + begin, count), count);
+            if (keep == 0) {
+                continue;
+            }
+
+            if (entryWrite != begin) {
+                std::copy(entryArena.begin() + begin, entryArena.begin() + begin + keep,
+                    entryArena.begin() + entryWrite);
+            }
+
+            keyList[keyWrite] = keyList[i];
+            offsetList[keyWrite] = entryWrite;
+            entryWrite += static_cast<uint32_t>(keep);
+            keyWrite++;
+        }
+
+        keyList.resize(keyWrite);
+        offsetList.resize(keyWrite + 1);
+        offsetList[keyWrite] = entryWrite;
+        entryArena.resize(entryWrite);
+        rebuildIndex();
+    }
+
+    // Keep-function for merge() that keeps every entry
+    struct KeepAll {
+        size_t operator()(PropertySet, CompactPathEntry*, size_t count) const { return count; }
+    };
+
+    // One contiguous key range of a table under construction
+    struct Partition {
+        std::vector<PropertySet> keys;
+        std::vector<uint32_t> counts;       // Entries per key
+        std::vector<CompactPathEntry> entries;
+
+        void addGroup(PropertySet key, size_t count) {
+            keys.push_back(key);
+            counts.push_back(static_cast<uint32_t>(count));
+        }
+    };
+
+    // Concatenate partitions that cover ascending, non-overlapping key ranges.
+    // Partitions are released as they are copied.
+    static PropertyPathTable fromPartitions(std::vector<Partition>& parts, size_t threads = 1) {
+        size_t partitionCount = parts.size();
+        std::vector<size_t> keyStart(partitionCount + 1, 0), entryStart(partitionCount + 1, 0);
+        for (size_t p = 0; p < partitionCount; p++) {
+            keyStart[p + 1] = keyStart[p] + parts[p].keys.size();
+            entryStart[p + 1] = entryStart[p] + parts[p].entries.size();
+        }
+
+        std::vector<PropertySet> keys(keyStart[partitionCount]);
+        std::vector<uint32_t> offsets(keyStart[partitionCount] + 1);
+        std::vector<CompactPathEntry> entries(entryStart[partitionCount]);
+        offsets[keys.size()] = static_cast<uint32_t>(entries.size());
+
+        parallelFor(partitionCount, threads, [&](size_t p) {
+            Partition& part = parts[p];
+            std::copy(part.keys.begin(), part.keys.end(), keys.begin() + keyStart[p]);
+            std::copy(part.entries.begin(), part.entries.end(), entries.begin() + entryStart[p]);
+
+            uint32_t offset = static_cast<uint32_t>(entryStart[p]);
+            for (size_t k = 0; k < part.counts.size(); k++) {
+                offsets[keyStart[p] + k] = offset;
+                offset += part.counts[k];
+            }
+            part = Partition();
+        });
+
+        return fromSortedColumns(std::move(keys), std::move(offsets), std::move(entries));
+    }
+
+    // Partition bit count and shift splitting keys of keyBits bits into about
+    // 4 ranges per thread; partition = key >> shift
+    static void partitionLayout(int keyBits, size_t threads, int& partitionBits, int& shift) {
+        partitionBits = 0;
+        while (threads > 1 && (size_t(1) << partitionBits) < threads * 4 && partitionBits < keyBits) {
+            partitionBits++;
+        }
+        shift = keyBits - partitionBits;
+    }
+
+    // First row of every partition, plus size() at the end
+    std::vector<size_t> partitionBounds(int partitionBits, int shift) const {
+        size_t partitionCount = size_t(1) << partitionBits;
+        std::vector<size_t> bounds(partitionCount + 1, size());
+        bounds[0] = 0;
+        for (size_t p = 1; p < partitionCount; p++) {
+            PropertySet first = static_cast<PropertySet>(p) << shift;
+            bounds[p] = std::lower_bound(keyList.begin(), keyList.end(), first) - keyList.begin();
+        }
+        return bounds;
+    }
+
+    // Merge two tables. Entries of a key present in both are concatenated (a first) and
+    // passed to keep(key, entries, count), which works like the rewriteGroups callback
+    // and must be safe to call from several threads. The key range is split on its top
+    // bits into partitions that are merged in parallel and then stitched together.
+    template <typename KeepFn = KeepAll>
+    static PropertyPathTable merge(const PropertyPathTable& a, const PropertyPathTable& b,
+        size_t threads = 1, KeepFn keep = KeepFn()) {
+        // Partition on the highest bits actually used by either table
+        PropertySet maxKey = std::max(a.empty() ? 0 : a.keyList.back(), b.empty() ? 0 : b.keyList.back());
+        int keyBits = 0;
+        while (keyBits < 64 && (maxKey >> keyBits) != 0) {
+            keyBits++;
+        }
+        int partitionBits, shift;
+        partitionLayout(keyBits, threads, partitionBits, shift);
+        size_t partitionCount = size_t(1) << partitionBits;
+
+        // Partition p covers keys whose top bits equal p
+        std::vector<size_t> boundsA = a.partitionBounds(partitionBits, shift);
+        std::vector<size_t> boundsB = b.partitionBounds(partitionBits, shift);
+
+        std::vector<Partition> parts(partitionCount);
+        parallelFor(partitionCount, threads, [&](size_t p) {
+            Partition& part = parts[p];
+            size_t i = boundsA[p], endA = boundsA[p + 1];
+            size_t j = boundsB[p], endB = boundsB[p + 1];
+            part.keys.reserve((endA - i) + (endB - j));
+            part.counts.reserve((endA - i) + (endB - j));
+
+            while (i < endA || j < endB) {
+                bool takeA = j == endB || (i < endA && a.keyList[i] <= b.keyList[j]);
+                bool takeB = i == endA || (j < endB && b.keyList[j] <= a.keyList[i]);
+                PropertySet key = takeA ? a.keyList[i] : b.keyList[j];
+
+                size_t groupStart = part.entries.size();
+                if (takeA) {
+                    EntryRange range = a.entriesAt(i++);
+                    part.entries.insert(part.entries.end(), range.begin(), range.end());
+                }
+                if (takeB) {
+                    EntryRange range = b.entriesAt(j++);
+                    part.entries.insert(part.entries.end(), range.begin(), range.end());
+                }
+
+                size_t count = part.entries.size() - groupStart;
+                size_t kept = std::min(keep(key, part.entries.data() + groupStart, count), count);
+                part.entries.resize(groupStart + kept);
+                if (kept > 0) {
+                    part.addGroup(key, kept);
+                }
+            }
+        });
+
+        return fromPartitions(parts, threads);
+    }
+
+private:
+    std::vector<PropertySet> keyList;           // Sorted ascending
+    std::vector<uint32_t> offsetList;           // keyList.size() + 1 offsets into entryArena
+    std::vector<CompactPathEntry> entryArena;   // Entries grouped by key
+    std::vector<uint32_t> slots;                // Open-addressing index: key position + 1, 0 = empty
+    size_t slotMask;
+
+    static size_t hashKey(PropertySet key) {
+        // splitmix64 finalizer
+        key ^= key >> 30;
+        key *= 0xbf58476d1ce4e5b9ULL;
+        key ^= key >> 27;
+        key *= 0x94d049bb133111ebULL;
+        key ^= key >> 31;
+        return static_cast<size_t>(key);
+    }
+
+    // Rebuild the lookup index at <= 50% load
+    void rebuildIndex() {
+        if (keyList.empty()) {
+            std::vector<uint32_t>().swap(slots);
+            slotMask = 0;
+            return;
+        }
+
+        size_t capacity = 16;
+        while (capacity < keyList.size() * 2) {
+            capacity <<= 1;
+        }
+
+        slots.assign(capacity, 0);
+        slotMask = capacity - 1;
+
+        for (size_t i = 0; i < keyList.size(); i++) {
+            size_t slot = hashKey(keyList[i]) & slotMask;
+            while (slots[slot] != 0) {
+                slot = (slot + 1) & slotMask;
+            }
+            slots[slot] = static_cast<uint32_t>(i + 1);
+        }
+    }
+};
+
+// Non-owning view over sorted key/offset/entry columns, either borrowed from a
+// PropertyPathTable or pointing straight into a mapped table file. Lookups binary
+// search the key column so nothing has to be built before the first query.
+class PathTableView {
+public:
+    using EntryRange = PropertyPathTable::EntryRange;
+
+    class const_iterator {
+    public:
+        const_iterator(const PathTableView* view, size_t index) : view(view), index(index) {}
+
+        std::pair<PropertySet, EntryRange> operator*() const {
+            return { view->keyAt(index), view->entriesAt(index) };
+        }
+        const_iterator& operator++() { index++; return *this; }
+        bool operator==(const const_iterator& other) const { return index == other.index; }
+        bool operator!=(const const_iterator& other) const { return index != other.index; }
+
+    private:
+        const PathTableView* view;
+        size_t index;
+    };
+
+    PathTableView() : keyData(nullptr), offsetData(nullptr), entryData(nullptr), keyCount(0) {}
+    PathTableView(const PropertySet* keys, const uint32_t* offsets, const CompactPathEntry* entries, size_t keyCount)
+        : keyData(keys), offsetData(offsets), entryData(entries), keyCount(keyCount) {}
+    PathTableView(const PropertyPathTable& table)
+        : keyData(table.keys().data()), offsetData(table.offsets().data()),
+        entryData(table.entries().data()), keyCount(table.size()) {}
+
+    size_t size() const { return keyCount; }
+    bool empty() const { return keyCount == 0; }
+    size_t entryCount() const { return keyCount == 0 ? 0 : offsetData[keyCount]; }
+
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, keyCount); }
+
+    PropertySet keyAt(size_t index) const { return keyData[index]; }
+
+    EntryRange entriesAt(size_t index) const {
+        return EntryRange(entryData + offsetData[index], entryData + offsetData[index + 1]);
+    }
+
+    // Position of a key in the sorted key column, or size() if absent
+    size_t indexOf(PropertySet key) const {
+        const PropertySet* found = std::lower_bound(keyData, keyData + keyCount, key);
+        return (found != keyData + keyCount && *found == key) ? static_cast<size_t>(found - keyData) : keyCount;
+    }
+
+    bool contains(PropertySet key) const { return indexOf(key) != keyCount; }
+
+    EntryRange find(PropertySet key) const {
+        size_t index = indexOf(key);
+        return index == keyCount ? EntryRange() : entriesAt(index);
+    }
+
+    const PropertySet* keys() const { return keyData; }
+    const uint32_t* offsets() const { return offsetData; }
+    const CompactPathEntry* entries() const { return entryData; }
+
+private:
+    const PropertySet* keyData;
+    const uint32_t* offsetData;
+    const CompactPathEntry* entryData;
+    size_t keyCount;
+};
+
+// One path out of a query result; points into the table it came from
+struct PathQueryMatch {
+    PropertySet properties;
+    const CompactPathEntry* entry;
+};
+
+struct PathQueryResult {
+    size_t matchingKeys = 0;            // Only complete when the query was counted in full
+    size_t totalPaths = 0;
+    std::vector<PathQueryMatch> paths;  // Best first: fewest ingredients, then highest bonus
+};
+
+// Bulk builder: collects (key, entry) rows in any order and groups them into a table
+class PathTableBuilder {
+public:
+    void reserve(size_t rowCount) { rows.reserve(rowCount); }
+
+    void add(PropertySet key, const CompactPathEntry& entry) {
+        rows.emplace_back(key, entry);
+    }
+
+    void addTable(const PropertyPathTable& table) {
+        rows.reserve(rows.size() + table.entryCount());
+        for (size_t i = 0; i < table.size(); i++) {
+            for (const auto& entry : table.entriesAt(i)) {
+                rows.emplace_back(table.keyAt(i), entry);
+            }
+        }
+    }
+
+    // Move all rows of another builder into this one
+    void append(PathTableBuilder& other) {
+        if (rows.empty()) {
+            rows.swap(other.rows);
+        }
+        else {
+            rows.insert(rows.end(), other.rows.begin(), other.rows.end());
+        }
+        std::vector<std::pair<PropertySet, CompactPathEntry>>().swap(other.rows);
+    }
+
+    size_t rowCount() const { return rows.size(); }
+    bool empty() const { return rows.empty(); }
+
+    // Group rows by key (insertion order is preserved within a key) and release the rows
+    PropertyPathTable build() {
+        std::stable_sort(rows.begin(), rows.end(),
+            [](const std::pair<PropertySet, CompactPathEntry>& a, const std::pair<PropertySet, CompactPathEntry>& b) {
+                return a.first < b.first;
+            });
+
+        std::vector<PropertySet> keys;
+        std::vector<uint32_t> offsets;
+        std::vector<CompactPathEntry> entries;
+        entries.reserve(rows.size());
+
+        for (size_t i = 0; i < rows.size(); i++) {
+            if (i == 0 || rows[i].first != rows[i - 1].first) {
+                keys.push_back(rows[i].first);
+                offsets.push_back(static_cast<uint32_t>(entries.size()));
+            }
+            entries.push_back(rows[i].second);
+        }
+        offsets.push_back(static_cast<uint32_t>(entries.size()));
+
+        std::vector<std::pair<PropertySet, CompactPathEntry>>().swap(rows);
+        return PropertyPathTable::fromSortedColumns(std::move(keys), std::move(offsets), std::move(entries));
+    }
+
+private:
+    std::vector<std::pair<PropertySet, CompactPathEntry>> rows;
+};
@@ -0,0 +1,144 @@
+#pragma once
+
+#include "path_table_file.h"
+#include "path_query_index.h"
+#include <cstdint>
+#include <iterator>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+// Identity of a table file on disk. A cached table is only reused while its file
+// still has the same size, modification time and (for v2 files) data checksum.
+struct PathTableFileStamp {
+    uint64_t size = 0;
+    int64_t modified = 0;
+    uint64_t checksum = 0;
+
+    bool operator==(const PathTableFileStamp& other) const {
+        return size == other.size && modified == other.modified && checksum == other.checksum;
+    }
+    bool operator!=(const PathTableFileStamp& other) const { return !(*this == other); }
+};
+
+// Stat the file and read its header; false if it does not exist
+inline bool readPathTableFileStamp(const std::string& filename, PathTableFileStamp& stamp) {
+#ifdef _WIN32
+    struct _stat64 status;
+    if (_stat64(filename.c_str(), &status) != 0) {
+        return false;
+    }
+#else
+    struct stat status;
+    if (stat(filename.c_str(), &status) != 0) {
+        return false;
+    }
+#endif
+    stamp.size = static_cast<uint64_t>(status.st_size);
+    stamp.modified = static_cast<int64_t>(status.st_mtime);
+
+    // Legacy v1 files have no checksum; size and time have to do for them
+    PathTableFileInfo info;
+    stamp.checksum = readPathTableFileInfo(filename, info) ? info.dataChecksum : 0;
+    return true;
+}
+
+// Loaded tables kept for reuse, least recently used first out. Eviction keeps the
+// heap memory of the tables (see IndexedPathTable::memoryUsage) within the budget,
+// but never drops the table used last or the pinned one. Tables still referenced
+// elsewhere stay alive until released. Safe to use from several threads.
+class PathTableCache {
+public:
+    explicit PathTableCache(size_t memoryBudget) : budget(memoryBudget), used(0) {}
+
+    // The cached table for filename if its file still matches stamp
+    std::shared_ptr<IndexedPathTable> find(const std::string& filename, const PathTableFileStamp& stamp) {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto it = entries.begin(); it != entries.end(); ++it) {
+            if (it->filename != filename) {
+                continue;
+            }
+            if (it->stamp != stamp) {
+                // The file changed on disk
+                used -= it->bytes;
+                entries.erase(it);
+                return nullptr;
+            }
+            entries.splice(entries.begin(), entries, it);
+            return it->table;
+        }
+        return nullptr;
+    }
+
+    bool contains(const std::string& filename) {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto& entry : entries) {
+            if (entry.filename == filename) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Keep filename's table through evictions, e.g. the one on screen while others are prefetched
+    void pin(const std::string& filename) {
+        std::lock_guard<std::mutex> lock(mutex);
+        pinned = filename;
+    }
+
+    void insert(const std::string& filename, const PathTableFileStamp& stamp, std::shared_ptr<IndexedPathTable> table) {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto it = entries.begin(); it != entries.end(); ++it) {
+            if (it->filename == filename) {
+                used -= it->bytes;
+                entries.erase(it);
+                break;
+            }
+        }
+
+        Entry entry;
+        entry.filename = filename;
+        entry.stamp = stamp;
+        entry.bytes = table->memoryUsage();
+        entry.table = std::move(table);
+        used += entry.bytes;
+        entries.push_front(std::move(entry));
+
+        for (auto it = std::prev(entries.end()); used > budget && it != entries.begin();) {
+            if (it->filename == pinned) {
+                --it;
+                continue;
+            }
+            used -= it->bytes;
+            it = std::prev(entries.erase(it));
+        }
+    }
+
+    // Room left before loading a table of this many bytes would evict another
+    bool hasRoomFor(size_t bytes) {
+        std::lock_guard<std::mutex> lock(mutex);
+        return used + bytes <= budget;
+    }
+
+    size_t memoryUsage() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return used;
+    }
+
+private:
+    struct Entry {
+        std::string filename;
+        PathTableFileStamp stamp;
+        std::shared_ptr<IndexedPathTable> table;
+        size_t bytes = 0;
+    };
+
+    std::mutex mutex;
+    std::list<Entry> entries;   // Most recently used first
+    std::string pinned;
+    size_t budget;
+    size_t used;
+};
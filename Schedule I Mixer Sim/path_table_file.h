@@ -0,0 +1,750 @@
+#pragma once
+
+#include "path_table.h"
+#include "path_trie.h"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <type_traits>
+#include <unordered_map>
+#include <thread>
+#include <atomic>
+#include <cstdio>
+#include <cerrno>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#endif
+
+// =================== PATH TABLE FILE FORMAT ===================
+//
+// v1 (legacy): uint32 key count, then per key: uint64 key, uint8 entry count, and per
+// entry a uint8 length, the ingredient bytes and three floats. Parsed record by record.
+//
+// v2: a fixed header followed by sections that can be used in place once mapped:
+//   dictionary  product name, property ids by bit position, ingredient names by index
+//   keys        uint64[keyCount], strictly ascending
+//   offsets     uint32[keyCount + 1], entry index where each key's entries start
+//   entries     CompactPathEntry[entryCount], fixed 28-byte stride
+// Every section starts on an 8-byte boundary. All values are little-endian.
+//
+// Tables flagged PATH_TABLE_FLAG_TRIE store sequences in a prefix trie instead: a
+// nodes section (uint32 parent[nodeCount] followed by uint8 ingredient[nodeCount])
+// sits before the entries, and entries are 16-byte TriePathEntry records.
+
+static_assert(std::is_trivially_copyable<CompactPathEntry>::value, "path entries are written as raw records");
+static_assert(sizeof(CompactPathEntry) == 28, "v2 entry stride is 28 bytes");
+static_assert(sizeof(TriePathEntry) == 16, "v2 trie entry stride is 16 bytes");
+
+const char PATH_TABLE_MAGIC[8] = { 'S', '1', 'P', 'A', 'T', 'H', 'S', '\x1a' };
+const uint32_t PATH_TABLE_VERSION = 2;
+const uint32_t PATH_TABLE_FLAG_TRIE = 1;
+
+struct PathTableFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    uint32_t entryStride;
+    uint32_t maxDepth;
+    uint64_t keyCount;
+    uint64_t entryCount;
+    uint64_t dictionaryOffset;
+    uint64_t dictionarySize;
+    uint64_t keysOffset;
+    uint64_t offsetsOffset;
+    uint64_t entriesOffset;
+    uint64_t fileSize;
+    uint64_t dataChecksum;      // Checksum of everything after the header
+    uint64_t datasetHash;       // Checkpoints: hash of the mixing data the table was generated from
+    uint64_t completedMask;     // Checkpoints: bit per first ingredient already processed
+    uint32_t flags;
+    uint32_t nodeCount;         // Trie tables only
+    uint64_t nodesOffset;       // Trie tables only
+};
+
+static_assert(sizeof(PathTableFileHeader) == 128, "v2 header is 128 bytes");
+
+// Names needed to interpret keys and ingredient indices stored in a table
+struct PathTableDictionary {
+    std::string productName;
+    uint32_t maxDepth = 0;
+    std::vector<std::string> propertyIds;       // By bit position
+    std::vector<std::string> ingredientNames;   // By ingredient index
+    uint64_t datasetHash = 0;                   // 0 when unknown
+    uint64_t completedMask = 0;
+};
+
+// Details about a table file as it was read
+struct PathTableFileInfo {
+    uint32_t version = 0;
+    PathTableDictionary dictionary;
+    uint64_t dataChecksum = 0;
+    uint64_t keyCount = 0;      // v2 only
+    uint64_t entryCount = 0;    // v2 only
+};
+
+// How far a table load has got; written by the loading thread, readable from any other
+struct PathTableLoadProgress {
+    std::atomic<uint64_t> bytesRead{ 0 };
+    std::atomic<uint64_t> bytesTotal{ 0 };
+    std::atomic<uint64_t> rowsIndexed{ 0 };
+    std::atomic<uint64_t> rowsTotal{ 0 };
+};
+
+// Data checksum: FNV-1a over 1 MiB blocks, with the block hashes folded together by FNV-1a
+class PathTableChecksum {
+public:
+    static constexpr size_t BLOCK_SIZE = 1 << 20;
+
+    static uint64_t hashBytes(const void* data, size_t size, uint64_t hash = 0xcbf29ce484222325ULL) {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        for (size_t i = 0; i < size; i++) {
+            hash ^= bytes[i];
+            hash *= 0x100000001b3ULL;
+        }
+        return hash;
+    }
+
+    static uint64_t foldBlockHash(uint64_t combined, uint64_t blockHash) {
+        return hashBytes(&blockHash, sizeof(blockHash), combined);
+    }
+
+    PathTableChecksum() : combined(0xcbf29ce484222325ULL), blockHash(0xcbf29ce484222325ULL), blockFill(0) {}
+
+    void update(const void* data, size_t size) {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        while (size > 0) {
+            size_t take = std::min(size, BLOCK_SIZE - blockFill);
+            blockHash = hashBytes(bytes, take, blockHash);
+            blockFill += take;
+            bytes += take;
+            size -= take;
+
+            if (blockFill == BLOCK_SIZE) {
+                foldBlock();
+            }
+        }
+    }
+
+    uint64_t finish() {
+        if (blockFill > 0) {
+            foldBlock();
+        }
+        return combined;
+    }
+
+private:
+    uint64_t combined;
+    uint64_t blockHash;
+    size_t blockFill;
+
+    void foldBlock() {
+        combined = foldBlockHash(combined, blockHash);
+        blockHash = 0xcbf29ce484222325ULL;
+        blockFill = 0;
+    }
+};
+
+inline uint64_t alignPathTableOffset(uint64_t offset) {
+    return (offset + 7) & ~uint64_t(7);
+}
+
+inline void appendDictionaryString(std::vector<char>& out, const std::string& value) {
+    uint32_t length = static_cast<uint32_t>(value.size());
+    out.insert(out.end(), reinterpret_cast<const char*>(&length), reinterpret_cast<const char*>(&length) + sizeof(length));
+    out.insert(out.end(), value.begin(), value.end());
+}
+
+inline std::vector<char> encodePathTableDictionary(const PathTableDictionary& dictionary) {
+    std::vector<char> out;
+    appendDictionaryString(out, dictionary.productName);
+
+    uint32_t propertyCount = static_cast<uint32_t>(dictionary.propertyIds.size());
+    out.insert(out.end(), reinterpret_cast<const char*>(&propertyCount), reinterpret_cast<const char*>(&propertyCount) + sizeof(propertyCount));
+    for (const auto& id : dictionary.propertyIds) {
+        appendDictionaryString(out, id);
+    }
+
+    uint32_t ingredientCount = static_cast<uint32_t>(dictionary.ingredientNames.size());
+    out.insert(out.end(), reinterpret_cast<const char*>(&ingredientCount), reinterpret_cast<const char*>(&ingredientCount) + sizeof(ingredientCount));
+    for (const auto& name : dictionary.ingredientNames) {
+        appendDictionaryString(out, name);
+    }
+
+    return out;
+}
+
+inline bool decodePathTableDictionary(const char* data, size_t size, PathTableDictionary& dictionary) {
+    size_t pos = 0;
+
+    auto readCount = [&](uint32_t& value) {
+        if (size - pos < sizeof(value)) return false;
+        std::memcpy(&value, data + pos, sizeof(value));
+        pos += sizeof(value);
+        return true;
+    };
+    auto readString = [&](std::string& value) {
+        uint32_t length;
+        if (!readCount(length) || size - pos < length) return false;
+        value.assign(data + pos, length);
+        pos += length;
+        return true;
+    };
+
+    uint32_t count;
+    if (!readString(dictionary.productName) || !readCount(count)) return false;
+    dictionary.propertyIds.resize(count);
+    for (auto& id : dictionary.propertyIds) {
+        if (!readString(id)) return false;
+    }
+
+    if (!readCount(count)) return false;
+    dictionary.ingredientNames.resize(count);
+    for (auto& name : dictionary.ingredientNames) {
+        if (!readString(name)) return false;
+    }
+
+    return true;
+}
+
+// A run of bytes at a fixed position in the output file; padding runs have no data
+struct PathTableSegment {
+    uint64_t offset;
+    const char* data;
+    size_t size;
+};
+
+// Checksum a list of contiguous segments covering [start, end). Blocks are hashed
+// on several threads and folded in file order, matching PathTableChecksum exactly.
+inline uint64_t checksumPathTableSegments(const std::vector<PathTableSegment>& segments, uint64_t start, uint64_t end) {
+    const size_t blockSize = PathTableChecksum::BLOCK_SIZE;
+    size_t blockCount = static_cast<size_t>((end - start + blockSize - 1) / blockSize);
+    std::vector<uint64_t> blockHashes(blockCount);
+    const char zeros[8] = {};
+
+    auto hashBlocks = [&](size_t firstBlock, size_t lastBlock) {
+        size_t seg = 0;
+        for (size_t block = firstBlock; block < lastBlock; block++) {
+            uint64_t blockStart = start + block * blockSize;
+            uint64_t blockEnd = std::min<uint64_t>(blockStart + blockSize, end);
+            uint64_t hash = 0xcbf29ce484222325ULL;
+
+            while (seg < segments.size() && segments[seg].offset + segments[seg].size <= blockStart) {
+                seg++;
+            }
+            for (size_t i = seg; i < segments.size() && segments[i].offset < blockEnd; i++) {
+                uint64_t from = std::max(blockStart, segments[i].offset);
+                uint64_t to = std::min(blockEnd, segments[i].offset + segments[i].size);
+                if (segments[i].data) {
+                    hash = PathTableChecksum::hashBytes(segments[i].data + (from - segments[i].offset), static_cast<size_t>(to - from), hash);
+                }
+                else {
+                    hash = PathTableChecksum::hashBytes(zeros, static_cast<size_t>(to - from), hash);
+                }
+            }
+            blockHashes[block] = hash;
+        }
+    };
+
+    size_t threadCount = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), blockCount);
+    if (threadCount <= 1) {
+        hashBlocks(0, blockCount);
+    }
+    else {
+        std::vector<std::thread> threads;
+        size_t perThread = (blockCount + threadCount - 1) / threadCount;
+        for (size_t t = 0; t < threadCount; t++) {
+            size_t first = t * perThread;
+            size_t last = std::min(blockCount, first + perThread);
+            if (first < last) {
+                threads.emplace_back(hashBlocks, first, last);
+            }
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+
+    uint64_t combined = 0xcbf29ce484222325ULL;
+    for (uint64_t hash : blockHashes) {
+        combined = PathTableChecksum::foldBlockHash(combined, hash);
+    }
+    return combined;
+}
+
+// Atomically replace target with source; reason says why not on failure. Windows
+// refuses while another program has the target open or mapped, so that is retried
+// for a moment in case it is just closing it.
+inline bool replacePathTableFile(const std::string& source, const std::string& target, std::string& reason) {
+#ifdef _WIN32
+    for (int attempt = 0; attempt < 5; attempt++) {
+        if (MoveFileExA(source.c_str(), target.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+            return true;
+        }
+        DWORD code = GetLastError();
+        reason = "error " + std::to_string(code);
+        if (code != ERROR_ACCESS_DENIED && code != ERROR_SHARING_VIOLATION && code != ERROR_USER_MAPPED_FILE) {
+            return false;
+        }
+        Sleep(200);
+    }
+    reason += ", it is open in another program";
+    return false;
+#else
+    if (std::rename(source.c_str(), target.c_str()) == 0) {
+        return true;
+    }
+    reason = std::strerror(errno);
+    return false;
+#endif
+}
+
+// Header fields shared by both table layouts
+inline PathTableFileHeader makePathTableHeader(const PathTableDictionary& dictionary, size_t keyCount, size_t entryCount) {
+    PathTableFileHeader header = {};
+    std::memcpy(header.magic, PATH_TABLE_MAGIC, sizeof(header.magic));
+    header.version = PATH_TABLE_VERSION;
+    header.headerSize = sizeof(PathTableFileHeader);
+    header.entryStride = sizeof(CompactPathEntry);
+    header.maxDepth = dictionary.maxDepth;
+    header.datasetHash = dictionary.datasetHash;
+    header.completedMask = dictionary.completedMask;
+    header.keyCount = keyCount;
+    header.entryCount = entryCount;
+    return header;
+}
+
+// Lay out the header's sections and write them. Columns are written straight from
+// memory in large blocks to a temporary file, which then replaces the target, so an
+// interrupted save never leaves a damaged table behind.
+inline bool writePathTableSections(PathTableFileHeader& header, const std::string& filename,
+    const std::vector<char>& dictionaryBytes, const void* keys, const void* offsets,
+    const void* nodeParents, const void* nodeIngredients, const void* entries) {
+    header.dictionaryOffset = header.headerSize;
+    header.dictionarySize = dictionaryBytes.size();
+    header.keysOffset = alignPathTableOffset(header.dictionaryOffset + header.dictionarySize);
+    header.offsetsOffset = alignPathTableOffset(header.keysOffset + header.keyCount * sizeof(PropertySet));
+    uint64_t afterOffsets = alignPathTableOffset(header.offsetsOffset + (header.keyCount + 1) * sizeof(uint32_t));
+    if (header.flags & PATH_TABLE_FLAG_TRIE) {
+        header.nodesOffset = afterOffsets;
+        afterOffsets = alignPathTableOffset(header.nodesOffset + uint64_t(header.nodeCount) * (sizeof(uint32_t) + sizeof(uint8_t)));
+    }
+    header.entriesOffset = afterOffsets;
+    header.fileSize = header.entriesOffset + header.entryCount * header.entryStride;
+
+    // Lay out every byte after the header, padding included
+    std::vector<PathTableSegment> segments;
+    uint64_t position = header.headerSize;
+    auto addSection = [&](uint64_t offset, const void* data, size_t size) {
+        if (offset > position) {
+            segments.push_back({ position, nullptr, static_cast<size_t>(offset - position) });
+        }
+        segments.push_back({ offset, static_cast<const char*>(data), size });
+        position = offset + size;
+    };
+
+    addSection(header.dictionaryOffset, dictionaryBytes.data(), dictionaryBytes.size());
+    addSection(header.keysOffset, keys, header.keyCount * sizeof(PropertySet));
+    addSection(header.offsetsOffset, offsets, (header.keyCount + 1) * sizeof(uint32_t));
+    if (header.flags & PATH_TABLE_FLAG_TRIE) {
+        addSection(header.nodesOffset, nodeParents, header.nodeCount * sizeof(uint32_t));
+        addSection(header.nodesOffset + header.nodeCount * sizeof(uint32_t), nodeIngredients, header.nodeCount * sizeof(uint8_t));
+    }
+    addSection(header.entriesOffset, entries, header.entryCount * header.entryStride);
+
+    header.dataChecksum = checksumPathTableSegments(segments, header.headerSize, header.fileSize);
+
+    std::string tempFile = filename + ".tmp";
+    std::ofstream file(tempFile, std::ios::binary | std::ios::trunc);
+
+    if (!file) {
+        std::cerr << "Error opening file for writing: " << tempFile << std::endl;
+        return false;
+    }
+
+    const char padding[8] = {};
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (const auto& segment : segments) {
+        file.write(segment.data ? segment.data : padding, segment.size);
+    }
+    file.close();
+
+    if (!file) {
+        std::cerr << "Error writing file: " << tempFile << std::endl;
+        std::remove(tempFile.c_str());
+        return false;
+    }
+
+    std::string reason;
+    if (!replacePathTableFile(tempFile, filename, reason)) {
+        // Keep the new table under another name rather than throwing the work away
+        std::string keptFile = filename + ".new";
+        std::string keptReason;
+        std::cerr << "Error replacing file: " << filename << " (" << reason << ")" << std::endl;
+        if (replacePathTableFile(tempFile, keptFile, keptReason)) {
+            std::cerr << "The new table was kept as " << keptFile << "; rename it to " << filename
+                << " once that is no longer in use" << std::endl;
+        }
+        else {
+            std::remove(tempFile.c_str());
+        }
+        return false;
+    }
+
+    return true;
+}
+
+// Write a table in the v2 format
+inline bool writePathTableFile(const PropertyPathTable& table, const std::string& filename, const PathTableDictionary& dictionary) {
+    PathTableFileHeader header = makePathTableHeader(dictionary, table.size(), table.entryCount());
+
+    if (header.maxDepth == 0) {
+        for (const auto& entry : table.entries()) {
+            header.maxDepth = std::max<uint32_t>(header.maxDepth, static_cast<uint32_t>(entry.ingredientSequence.size()));
+        }
+    }
+
+    return writePathTableSections(header, filename, encodePathTableDictionary(dictionary),
+        table.keys().data(), table.offsets().data(), nullptr, nullptr, table.entries().data());
+}
+
+// Write a trie table in the v2 format
+inline bool writePathTrieFile(const PathTrieTable& table, const std::string& filename, const PathTableDictionary& dictionary) {
+    PathTableFileHeader header = makePathTableHeader(dictionary, table.size(), table.entryCount());
+    header.flags |= PATH_TABLE_FLAG_TRIE;
+    header.entryStride = sizeof(TriePathEntry);
+    header.nodeCount = static_cast<uint32_t>(table.trie().size());
+
+    if (header.maxDepth == 0) {
+        for (const auto& entry : table.entries()) {
+            header.maxDepth = std::max<uint32_t>(header.maxDepth, table.trie().depth(entry.node));
+        }
+    }
+
+    return writePathTableSections(header, filename, encodePathTableDictionary(dictionary),
+        table.keys().data(), table.offsets().data(), table.trie().parents().data(),
+        table.trie().ingredients().data(), table.entries().data());
+}
+
+// Check a v2 header against the size of the file it came from
+inline bool validatePathTableHeader(const PathTableFileHeader& header, uint64_t actualSize) {
+    if (std::memcmp(header.magic, PATH_TABLE_MAGIC, sizeof(header.magic)) != 0) return false;
+    if (header.version != PATH_TABLE_VERSION) return false;
+    if (header.flags & ~PATH_TABLE_FLAG_TRIE) return false;
+
+    bool trie = (header.flags & PATH_TABLE_FLAG_TRIE) != 0;
+    uint32_t stride = trie ? sizeof(TriePathEntry) : sizeof(CompactPathEntry);
+    if (header.headerSize != sizeof(PathTableFileHeader) || header.entryStride != stride) return false;
+    if (header.fileSize != actualSize) return false;
+    if (header.entryCount > UINT32_MAX) return false;
+
+    // Every count and offset is bounded by the file size, so the sums below cannot overflow
+    if (header.keyCount > actualSize / sizeof(PropertySet) || header.entryCount > actualSize / stride) return false;
+    if (header.dictionaryOffset > actualSize || header.dictionarySize > actualSize || header.keysOffset > actualSize ||
+        header.offsetsOffset > actualSize || header.entriesOffset > actualSize || header.nodesOffset > actualSize) return false;
+    if (header.keysOffset % 8 != 0 || header.offsetsOffset % 8 != 0 || header.entriesOffset % 8 != 0) return false;
+
+    uint64_t afterOffsets = header.offsetsOffset + (header.keyCount + 1) * sizeof(uint32_t);
+    if (trie) {
+        if (header.nodeCount == 0 || header.nodesOffset % 8 != 0 || afterOffsets > header.nodesOffset) return false;
+        afterOffsets = header.nodesOffset + uint64_t(header.nodeCount) * (sizeof(uint32_t) + sizeof(uint8_t));
+    }
+
+    return header.dictionaryOffset + header.dictionarySize <= header.keysOffset &&
+        header.keysOffset + header.keyCount * sizeof(PropertySet) <= header.offsetsOffset &&
+        afterOffsets <= header.entriesOffset &&
+        header.entriesOffset + header.entryCount * stride == header.fileSize;
+}
+
+// Check that offsets are monotonic and keys strictly ascending
+inline bool validatePathTableColumns(const PropertySet* keys, const uint32_t* offsets, uint64_t keyCount, uint64_t entryCount) {
+    if (offsets[0] != 0 || offsets[keyCount] != entryCount) return false;
+    for (uint64_t i = 0; i < keyCount; i++) {
+        if (offsets[i] > offsets[i + 1]) return false;
+        if (i > 0 && keys[i - 1] >= keys[i]) return false;
+    }
+    return true;
+}
+
+// Check that every entry's sequence fits and names known ingredients (indices are 0-15)
+inline bool validatePathTableEntries(const CompactPathEntry* entries, uint64_t entryCount, size_t ingredientCount) {
+    ingredientCount = std::min<size_t>(ingredientCount, 16);
+    for (uint64_t i = 0; i < entryCount; i++) {
+        const IngredientSequence& sequence = entries[i].ingredientSequence;
+        if (sequence.length > IngredientSequence::MAX_LENGTH) return false;
+        for (size_t j = 0; j < sequence.length; j++) {
+            if (sequence.items[j] >= ingredientCount) return false;
+        }
+    }
+    return true;
+}
+
+// Translate a table written with a different property/ingredient ordering into the
+// expected one. Keys or entries that reference names we don't know are dropped.
+inline PropertyPathTable remapPathTable(const PropertyPathTable& table, const PathTableDictionary& stored, const PathTableDictionary& expected) {
+    std::unordered_map<std::string, size_t> propertyPositions;
+    for (size_t i = 0; i < expected.propertyIds.size(); i++) {
+        propertyPositions[expected.propertyIds[i]] = i;
+    }
+    std::unordered_map<std::string, size_t> ingredientPositions;
+    for (size_t i = 0; i < expected.ingredientNames.size(); i++) {
+        ingredientPositions[expected.ingredientNames[i]] = i;
+    }
+
+    std::vector<int> propertyMap(stored.propertyIds.size(), -1);
+    for (size_t i = 0; i < stored.propertyIds.size(); i++) {
+        auto it = propertyPositions.find(stored.propertyIds[i]);
+        if (it != propertyPositions.end() && it->second < 64) propertyMap[i] = static_cast<int>(it->second);
+    }
+    std::vector<int> ingredientMap(stored.ingredientNames.size(), -1);
+    for (size_t i = 0; i < stored.ingredientNames.size(); i++) {
+        auto it = ingredientPositions.find(stored.ingredientNames[i]);
+        if (it != ingredientPositions.end()) ingredientMap[i] = static_cast<int>(it->second);
+    }
+
+    PathTableBuilder builder;
+    for (const auto& [propBits, entries] : table) {
+        PropertySet mapped = 0;
+        bool known = true;
+        for (size_t bit = 0; bit < 64 && known; bit++) {
+            if (!(propBits & (1ULL << bit))) continue;
+            if (bit >= propertyMap.size() || propertyMap[bit] < 0) known = false;
+            else mapped |= 1ULL << propertyMap[bit];
+        }
+        if (!known) continue;
+
+        for (const auto& entry : entries) {
+            CompactPathEntry remapped = entry;
+            bool valid = true;
+            for (auto& idx : remapped.ingredientSequence) {
+                if (idx >= ingredientMap.size() || ingredientMap[idx] < 0) {
+                    valid = false;
+                    break;
+                }
+                idx = static_cast<uint8_t>(ingredientMap[idx]);
+            }
+            if (valid) {
+                builder.add(mapped, remapped);
+            }
+        }
+    }
+
+    return builder.build();
+}
+
+// Parse a legacy v1 file held in memory
+inline bool parsePathTableV1(const std::vector<char>& data, PropertyPathTable& table) {
+    size_t pos = 0;
+    auto read = [&](void* out, size_t size) {
+        if (data.size() - pos < size) return false;
+        std::memcpy(out, data.data() + pos, size);
+        pos += size;
+        return true;
+    };
+
+    uint32_t tableSize;
+    if (!read(&tableSize, sizeof(tableSize))) return false;
+
+    PathTableBuilder builder;
+    for (uint32_t i = 0; i < tableSize; i++) {
+        PropertySet propBits;
+        uint8_t entryCount;
+        if (!read(&propBits, sizeof(propBits)) || !read(&entryCount, sizeof(entryCount))) return false;
+
+        for (uint8_t j = 0; j < entryCount; j++) {
+            CompactPathEntry entry;
+            uint8_t seqLength;
+            if (!read(&seqLength, sizeof(seqLength)) || data.size() - pos < seqLength) return false;
+
+            for (uint8_t k = 0; k < seqLength; k++) {
+                entry.ingredientSequence.push_back(static_cast<uint8_t>(data[pos + k]));
+            }
+            pos += seqLength;
+
+            if (!read(&entry.baseValueBonus, sizeof(entry.baseValueBonus)) ||
+                !read(&entry.addictiveness, sizeof(entry.addictiveness)) ||
+                !read(&entry.valueMultiplier, sizeof(entry.valueMultiplier))) {
+                return false;
+            }
+
+            builder.add(propBits, entry);
+        }
+    }
+
+    table = builder.build();
+    return true;
+}
+
+// Parse a v2 file held in memory
+inline bool parsePathTableV2(const std::vector<char>& data, PropertyPathTable& table, PathTableFileInfo& info) {
+    PathTableFileHeader header;
+    std::memcpy(&header, data.data(), sizeof(header));
+    if (!validatePathTableHeader(header, data.size())) {
+        std::cerr << "Invalid path table header" << std::endl;
+        return false;
+    }
+
+    PathTableChecksum checksum;
+    checksum.update(data.data() + header.headerSize, data.size() - header.headerSize);
+    if (checksum.finish() != header.dataChecksum) {
+        std::cerr << "Path table checksum mismatch" << std::endl;
+        return false;
+    }
+
+    info.version = header.version;
+    info.dataChecksum = header.dataChecksum;
+    info.keyCount = header.keyCount;
+    info.entryCount = header.entryCount;
+    if (!decodePathTableDictionary(data.data() + header.dictionaryOffset, header.dictionarySize, info.dictionary)) {
+        std::cerr << "Invalid path table dictionary" << std::endl;
+        return false;
+    }
+    info.dictionary.maxDepth = header.maxDepth;
+    info.dictionary.datasetHash = header.datasetHash;
+    info.dictionary.completedMask = header.completedMask;
+
+    std::vector<PropertySet> keys(header.keyCount);
+    std::vector<uint32_t> offsets(header.keyCount + 1);
+    std::memcpy(keys.data(), data.data() + header.keysOffset, keys.size() * sizeof(PropertySet));
+    std::memcpy(offsets.data(), data.data() + header.offsetsOffset, offsets.size() * sizeof(uint32_t));
+
+    if (!validatePathTableColumns(keys.data(), offsets.data(), header.keyCount, header.entryCount)) {
+        std::cerr << "Invalid path table columns" << std::endl;
+        return false;
+    }
+
+    if (header.flags & PATH_TABLE_FLAG_TRIE) {
+        std::vector<uint32_t> parents(header.nodeCount);
+        std::vector<uint8_t> ingredients(header.nodeCount);
+        std::vector<TriePathEntry> entries(header.entryCount);
+        std::memcpy(parents.data(), data.data() + header.nodesOffset, parents.size() * sizeof(uint32_t));
+        std::memcpy(ingredients.data(), data.data() + header.nodesOffset + parents.size() * sizeof(uint32_t), ingredients.size());
+        std::memcpy(entries.data(), data.data() + header.entriesOffset, entries.size() * sizeof(TriePathEntry));
+
+        PathTrie trie;
+        bool nodesValid = trie.assign(std::move(parents), std::move(ingredients));
+        for (size_t i = 0; nodesValid && i < entries.size(); i++) {
+            nodesValid = entries[i].node < trie.size();
+        }
+        if (!nodesValid) {
+            std::cerr << "Invalid path table trie" << std::endl;
+            return false;
+        }
+
+        // Query engines work on flat entries
+        table = PathTrieTable::fromColumns(std::move(keys), std::move(offsets), std::move(entries), std::move(trie)).toPathTable();
+        return true;
+    }
+
+    std::vector<CompactPathEntry> entries(header.entryCount);
+    std::memcpy(entries.data(), data.data() + header.entriesOffset, entries.size() * sizeof(CompactPathEntry));
+    if (!validatePathTableEntries(entries.data(), entries.size(), info.dictionary.ingredientNames.size())) {
+        std::cerr << "Invalid path table entries" << std::endl;
+        return false;
+    }
+    table = PropertyPathTable::fromSortedColumns(std::move(keys), std::move(offsets), std::move(entries));
+    return true;
+}
+
+inline bool isPathTableV2(const char* data, size_t size) {
+    return size >= sizeof(PathTableFileHeader) && std::memcmp(data, PATH_TABLE_MAGIC, sizeof(PATH_TABLE_MAGIC)) == 0;
+}
+
+// Read just the header and dictionary of a v2 file, e.g. to vet a checkpoint
+// before paying for a full load
+inline bool readPathTableFileInfo(const std::string& filename, PathTableFileInfo& info) {
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+    if (!file) {
+        return false;
+    }
+
+    uint64_t fileSize = static_cast<uint64_t>(file.tellg());
+    PathTableFileHeader header;
+    file.seekg(0);
+    if (fileSize < sizeof(header) || !file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        !isPathTableV2(reinterpret_cast<const char*>(&header), sizeof(header)) ||
+        !validatePathTableHeader(header, fileSize)) {
+        return false;
+    }
+
+    std::vector<char> dictionaryBytes(static_cast<size_t>(header.dictionarySize));
+    file.seekg(static_cast<std::streamoff>(header.dictionaryOffset));
+    if (!file.read(dictionaryBytes.data(), dictionaryBytes.size()) ||
+        !decodePathTableDictionary(dictionaryBytes.data(), dictionaryBytes.size(), info.dictionary)) {
+        return false;
+    }
+
+    info.version = header.version;
+    info.dataChecksum = header.dataChecksum;
+    info.keyCount = header.keyCount;
+    info.entryCount = header.entryCount;
+    info.dictionary.maxDepth = header.maxDepth;
+    info.dictionary.datasetHash = header.datasetHash;
+    info.dictionary.completedMask = header.completedMask;
+    return true;
+}
+
+// Read a table file of either version. v2 tables written with a different property
+// or ingredient ordering are remapped to the expected dictionary.
+inline PropertyPathTable readPathTableFile(const std::string& filename, const PathTableDictionary& expected,
+    PathTableFileInfo* infoOut = nullptr, PathTableLoadProgress* progress = nullptr) {
+    PropertyPathTable table;
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+
+    if (!file) {
+        std::cerr << "Error opening file for reading: " << filename << std::endl;
+        return table;
+    }
+
+    // Read it all, in blocks so progress can be reported; both formats are parsed from memory
+    const size_t READ_BLOCK = 8 << 20;
+    std::vector<char> data(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    if (progress) {
+        progress->bytesTotal = data.size();
+    }
+    for (size_t done = 0; done < data.size() && file;) {
+        size_t block = std::min(READ_BLOCK, data.size() - done);
+        file.read(data.data() + done, block);
+        done += block;
+        if (progress) {
+            progress->bytesRead = done;
+        }
+    }
+    file.close();
+
+    PathTableFileInfo info;
+    bool ok;
+    if (isPathTableV2(data.data(), data.size())) {
+        ok = parsePathTableV2(data, table, info);
+        if (ok && (info.dictionary.propertyIds != expected.propertyIds || info.dictionary.ingredientNames != expected.ingredientNames)) {
+            std::cout << "Path table " << filename << " uses a different property layout; remapping" << std::endl;
+            table = remapPathTable(table, info.dictionary, expected);
+        }
+    }
+    else {
+        info.version = 1;
+        info.dictionary = expected;
+        info.dictionary.datasetHash = 0;
+        info.dictionary.completedMask = 0;
+        ok = parsePathTableV1(data, table);
+    }
+
+    if (!ok) {
+        std::cerr << "Error reading path table: " << filename << std::endl;
+        table.clear();
+    }
+
+    if (infoOut) {
+        *infoOut = info;
+    }
+    return table;
+}
@@ -0,0 +1,329 @@
+#pragma once
+
+#include "path_table.h"
+#include <cstdint>
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <functional>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define PATH_SCAN_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// MSVC compiles AVX2 intrinsics anywhere; GCC/Clang need the function marked
+#if defined(PATH_SCAN_X86) && (defined(__GNUC__) || defined(__clang__))
+#define PATH_SCAN_AVX2 __attribute__((target("avx2")))
+#else
+#define PATH_SCAN_AVX2
+#endif
+
+// Every property a path shows at any step of its mix, starting product included.
+// The table only stores final properties, so this comes from whoever knows the
+// mixing rules.
+using PathStepProperties = std::function<PropertySet(const CompactPathEntry& entry)>;
+
+// Query predicate. Key and addictiveness conditions apply per row; bonus and
+// step conditions per path.
+struct PathScanFilter {
+    PropertySet include = 0;        // Every one of these properties
+    PropertySet exclude = 0;        // None of these
+    uint8_t minProperties = 0;      // Property count range, inclusive
+    uint8_t maxProperties = 64;
+    float minAddictiveness = -std::numeric_limits<float>::infinity();
+    float maxAddictiveness = std::numeric_limits<float>::infinity();
+    float minBaseValueBonus = -std::numeric_limits<float>::infinity();
+    float maxBaseValueBonus = std::numeric_limits<float>::infinity();
+    PropertySet neverThrough = 0;   // Not at any step; without stepProperties only the result is checked
+    PathStepProperties stepProperties;
+
+    // Nothing but "contains all of include"
+    bool isPlain() const {
+        return exclude == 0 && neverThrough == 0 && minProperties == 0 && maxProperties >= 64 &&
+            !hasAddictivenessRange() && !hasPathConditions();
+    }
+
+    bool hasAddictivenessRange() const {
+        return minAddictiveness != -std::numeric_limits<float>::infinity() ||
+            maxAddictiveness != std::numeric_limits<float>::infinity();
+    }
+
+    bool hasPathConditions() const {
+        return minBaseValueBonus != -std::numeric_limits<float>::infinity() ||
+            maxBaseValueBonus != std::numeric_limits<float>::infinity() ||
+            (neverThrough != 0 && stepProperties);
+    }
+
+    // rowAddictiveness is that of the row's first path (all paths of a key share it)
+    bool acceptsRow(PropertySet key, float rowAddictiveness) const {
+        return (key & include) == include && passesRowLimits(key, rowAddictiveness);
+    }
+
+    // Every row condition except include
+    bool passesRowLimits(PropertySet key, float rowAddictiveness) const {
+        if ((key & (exclude | neverThrough)) != 0) {
+            return false;
+        }
+        uint32_t count = 0;
+        for (PropertySet bits = key; bits; bits &= bits - 1) {
+            count++;
+        }
+        return count >= minProperties && count <= maxProperties &&
+            rowAddictiveness >= minAddictiveness && rowAddictiveness <= maxAddictiveness;
+    }
+
+    bool acceptsPath(const CompactPathEntry& entry) const {
+        if (!(entry.baseValueBonus >= minBaseValueBonus) || !(entry.baseValueBonus <= maxBaseValueBonus)) {
+            return false;
+        }
+        return neverThrough == 0 || !stepProperties || (stepProperties(entry) & neverThrough) == 0;
+    }
+};
+
+inline bool cpuSupportsAvx2() {
+#if defined(PATH_SCAN_X86) && defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return false;
+
+    __cpuid(info, 1);
+    bool osSavesYmm = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (_xgetbv(0) & 6) == 6;
+    if (!osSavesYmm) return false;
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#elif defined(PATH_SCAN_X86)
+    return __builtin_cpu_supports("avx2");
+#else
+    return false;
+#endif
+}
+
+// Scans a path table column by column. Keys are read straight from the table (so a
+// mapped file is scanned in place); the per-row stats every filter needs are copied
+// once into their own dense columns. The AVX2 path tests 8 rows per step.
+class PathTableScanner {
+public:
+    PathTableScanner() : useAvx2(false) {}
+
+    explicit PathTableScanner(const PathTableView& view) : view(view), useAvx2(cpuSupportsAvx2()) {
+        size_t rows = view.size();
+        propertyCounts.resize(rows);
+        bestLengths.resize(rows);
+        addictiveness.resize(rows);
+        baseValueBonus.resize(rows);
+
+        for (size_t row = 0; row < rows; row++) {
+            PropertySet key = view.keyAt(row);
+            uint8_t count = 0;
+            for (; key; key &= key - 1) {
+                count++;
+            }
+            propertyCounts[row] = count;
+
+            // Entries of a key share their stats; the first one is the shortest
+            auto entries = view.entriesAt(row);
+            if (entries.empty()) {
+                bestLengths[row] = UINT8_MAX;
+                addictiveness[row] = std::numeric_limits<float>::quiet_NaN();   // Never in range
+                baseValueBonus[row] = 0.0f;
+            }
+            else {
+                bestLengths[row] = static_cast<uint8_t>(entries.front().ingredientSequence.size());
+                addictiveness[row] = entries.front().addictiveness;
+                baseValueBonus[row] = entries.front().baseValueBonus;
+            }
+        }
+    }
+
+    size_t size() const { return view.size(); }
+    bool usesAvx2() const { return useAvx2; }
+    size_t memoryUsage() const {
+        return propertyCounts.capacity() + bestLengths.capacity() +
+            (addictiveness.capacity() + baseValueBonus.capacity()) * sizeof(float);
+    }
+    const PathTableView& tableView() const { return view; }
+
+    // Rows matching the filter, ascending
+    std::vector<uint32_t> scan(const PathScanFilter& filter) const {
+        // A property never passed through cannot be in the result either
+        if (filter.neverThrough != 0) {
+            PathScanFilter rowFilter;
+            rowFilter.include = filter.include;
+            rowFilter.exclude = filter.exclude | filter.neverThrough;
+            rowFilter.minProperties = filter.minProperties;
+            rowFilter.maxProperties = filter.maxProperties;
+            rowFilter.minAddictiveness = filter.minAddictiveness;
+            rowFilter.maxAddictiveness = filter.maxAddictiveness;
+            return scan(rowFilter);
+        }
+
+        std::vector<uint32_t> rows;
+        size_t done = 0;
+#ifdef PATH_SCAN_X86
+        if (useAvx2) {
+            done = scanAvx2(filter, rows);
+        }
+#endif
+        scanScalar(filter, done, view.size(), rows);
+        return rows;
+    }
+
+    // Best `limit` paths among matching rows, same order as PathQueryIndex results
+    PathQueryResult query(const PathScanFilter& filter, size_t limit) const {
+        PathQueryResult result;
+        std::vector<uint32_t> rows = scan(filter);
+        if (filter.hasPathConditions()) {
+            return queryPaths(filter, rows, limit);
+        }
+
+        for (uint32_t row : rows) {
+            result.totalPaths += view.entriesAt(row).size();
+        }
+        result.matchingKeys = rows.size();
+
+        // Rank rows by their best path; the top `limit` rows hold the top `limit` paths
+        auto better = [this](uint32_t a, uint32_t b) {
+            if (bestLengths[a] != bestLengths[b]) return bestLengths[a] < bestLengths[b];
+            if (baseValueBonus[a] != baseValueBonus[b]) return baseValueBonus[a] > baseValueBonus[b];
+            return a < b;
+        };
+        size_t topRows = std::min(limit, rows.size());
+        std::partial_sort(rows.begin(), rows.begin() + topRows, rows.end(), better);
+
+        for (size_t i = 0; i < topRows; i++) {
+            for (const auto& entry : view.entriesAt(rows[i])) {
+                result.paths.push_back({ view.keyAt(rows[i]), &entry });
+            }
+        }
+
+        std::stable_sort(result.paths.begin(), result.paths.end(),
+            [](const PathQueryMatch& a, const PathQueryMatch& b) {
+                if (a.entry->ingredientSequence.size() == b.entry->ingredientSequence.size()) {
+                    return a.entry->baseValueBonus > b.entry->baseValueBonus;
+                }
+                return a.entry->ingredientSequence.size() < b.entry->ingredientSequence.size();
+            });
+        if (result.paths.size() > limit) {
+            result.paths.resize(limit);
+        }
+
+        return result;
+    }
+
+private:
+    // query() when paths themselves are filtered: every path of every matching row
+    // is checked, and rows that keep none of them do not count
+    PathQueryResult queryPaths(const PathScanFilter& filter, std::vector<uint32_t>& rows, size_t limit) const {
+        PathQueryResult result;
+        std::sort(rows.begin(), rows.end(), [this](uint32_t a, uint32_t b) {
+            if (bestLengths[a] != bestLengths[b]) return bestLengths[a] < bestLengths[b];
+            if (baseValueBonus[a] != baseValueBonus[b]) return baseValueBonus[a] > baseValueBonus[b];
+            return a < b;
+        });
+
+        for (uint32_t row : rows) {
+            size_t accepted = 0;
+            for (const auto& entry : view.entriesAt(row)) {
+                if (filter.acceptsPath(entry)) {
+                    result.paths.push_back({ view.keyAt(row), &entry });
+                    accepted++;
+                }
+            }
+            result.totalPaths += accepted;
+            result.matchingKeys += accepted > 0 ? 1 : 0;
+        }
+
+        std::stable_sort(result.paths.begin(), result.paths.end(),
+            [](const PathQueryMatch& a, const PathQueryMatch& b) {
+                if (a.entry->ingredientSequence.size() == b.entry->ingredientSequence.size()) {
+                    return a.entry->baseValueBonus > b.entry->baseValueBonus;
+                }
+                return a.entry->ingredientSequence.size() < b.entry->ingredientSequence.size();
+            });
+        if (result.paths.size() > limit) {
+            result.paths.resize(limit);
+        }
+        return result;
+    }
+
+    PathTableView view;
+    std::vector<uint8_t> propertyCounts;
+    std::vector<uint8_t> bestLengths;
+    std::vector<float> addictiveness;
+    std::vector<float> baseValueBonus;
+    bool useAvx2;
+
+    bool matches(const PathScanFilter& filter, size_t row) const {
+        PropertySet key = view.keyAt(row);
+        return (key & filter.include) == filter.include &&
+            (key & filter.exclude) == 0 &&
+            propertyCounts[row] >= filter.minProperties && propertyCounts[row] <= filter.maxProperties &&
+            addictiveness[row] >= filter.minAddictiveness && addictiveness[row] <= filter.maxAddictiveness;
+    }
+
+    void scanScalar(const PathScanFilter& filter, size_t begin, size_t end, std::vector<uint32_t>& rows) const {
+        for (size_t row = begin; row < end; row++) {
+            if (matches(filter, row)) {
+                rows.push_back(static_cast<uint32_t>(row));
+            }
+        }
+    }
+
+#ifdef PATH_SCAN_X86
+    // Returns how many leading rows were handled; the rest go through scanScalar
+    PATH_SCAN_AVX2 size_t scanAvx2(const PathScanFilter& filter, std::vector<uint32_t>& rows) const {
+        const PropertySet* keys = view.keys();
+        size_t blocks = view.size() / 8;
+
+        const __m256i include = _mm256_set1_epi64x(static_cast<long long>(filter.include));
+        const __m256i exclude = _mm256_set1_epi64x(static_cast<long long>(filter.exclude));
+        const __m256i zero = _mm256_setzero_si256();
+        const __m128i minCount = _mm_set1_epi8(static_cast<char>(filter.minProperties));
+        const __m128i maxCount = _mm_set1_epi8(static_cast<char>(filter.maxProperties));
+        const __m256 minAddict = _mm256_set1_ps(filter.minAddictiveness);
+        const __m256 maxAddict = _mm256_set1_ps(filter.maxAddictiveness);
+
+        for (size_t block = 0; block < blocks; block++) {
+            size_t base = block * 8;
+            int mask = 0;
+
+            // Keys: 4 per register, include bits all present and exclude bits all absent
+            for (int half = 0; half < 2; half++) {
+                __m256i key = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + base + half * 4));
+                __m256i hasAll = _mm256_cmpeq_epi64(_mm256_and_si256(key, include), include);
+                __m256i hasNone = _mm256_cmpeq_epi64(_mm256_and_si256(key, exclude), zero);
+                int keyMask = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_and_si256(hasAll, hasNone)));
+                mask |= keyMask << (half * 4);
+            }
+            if (mask == 0) continue;
+
+            // Property counts: 8 bytes, unsigned range check via min/max
+            __m128i counts = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(propertyCounts.data() + base));
+            __m128i aboveMin = _mm_cmpeq_epi8(_mm_max_epu8(counts, minCount), counts);
+            __m128i belowMax = _mm_cmpeq_epi8(_mm_min_epu8(counts, maxCount), counts);
+            mask &= _mm_movemask_epi8(_mm_and_si128(aboveMin, belowMax)) & 0xff;
+
+            // Addictiveness: 8 floats
+            __m256 addict = _mm256_loadu_ps(addictiveness.data() + base);
+            __m256 inRange = _mm256_and_ps(_mm256_cmp_ps(addict, minAddict, _CMP_GE_OQ), _mm256_cmp_ps(addict, maxAddict, _CMP_LE_OQ));
+            mask &= _mm256_movemask_ps(inRange);
+
+            while (mask) {
+                int bit = 0;
+                while (!((mask >> bit) & 1)) {
+                    bit++;
+                }
+                rows.push_back(static_cast<uint32_t>(base + bit));
+                mask &= mask - 1;
+            }
+        }
+
+        return blocks * 8;
+    }
+#endif
+};
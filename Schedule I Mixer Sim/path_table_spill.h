@@ -0,0 +1,501 @@
+#pragma once
+
+#include "path_table.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <queue>
+#include <string>
+#include <vector>
+
+// Per-key filter applied while spilling and merging, same signature as the
+// rewriteGroups callback; null keeps everything
+using PathGroupFilter = size_t (*)(PropertySet key, CompactPathEntry* entries, size_t count);
+
+// Sorted run file: a header, the byte offset of every key-range partition, then
+// one record per key: [key u64][count u32][count entries]. Runs are scratch files
+// read back by the same build, so the layout is native and unversioned.
+struct PathRunHeader {
+    char magic[8];
+    uint32_t partitionBits;
+    uint32_t shift;
+    uint64_t keyCount;
+    uint64_t entryCount;
+};
+
+static const char PATH_RUN_MAGIC[8] = { 'S', '1', 'R', 'U', 'N', '\0', '\0', '\0' };
+
+inline bool writePathRun(const PropertyPathTable& table, const std::string& filename, int partitionBits, int shift) {
+    std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        std::cerr << "Error: Could not create run file " << filename << std::endl;
+        return false;
+    }
+
+    PathRunHeader header;
+    std::memcpy(header.magic, PATH_RUN_MAGIC, sizeof(header.magic));
+    header.partitionBits = static_cast<uint32_t>(partitionBits);
+    header.shift = static_cast<uint32_t>(shift);
+    header.keyCount = table.size();
+    header.entryCount = table.entryCount();
+
+    // Record offsets follow from the entry counts, so the partition table can be written up front
+    std::vector<size_t> bounds = table.partitionBounds(partitionBits, shift);
+    std::vector<uint64_t> partitionOffsets(bounds.size());
+    uint64_t position = sizeof(header) + bounds.size() * sizeof(uint64_t);
+    for (size_t p = 0; p + 1 < bounds.size(); p++) {
+        partitionOffsets[p] = position;
+        for (size_t row = bounds[p]; row < bounds[p + 1]; row++) {
+            position += sizeof(PropertySet) + sizeof(uint32_t) + table.entriesAt(row).size() * sizeof(CompactPathEntry);
+        }
+    }
+    partitionOffsets.back() = position;
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(partitionOffsets.data()), partitionOffsets.size() * sizeof(uint64_t));
+    for (size_t row = 0; row < table.size(); row++) {
+        PropertySet key = table.keyAt(row);
+        auto entries = table.entriesAt(row);
+        uint32_t count = static_cast<uint32_t>(entries.size());
+        file.write(reinterpret_cast<const char*>(&key), sizeof(key));
+        file.write(reinterpret_cast<const char*>(&count), sizeof(count));
+        file.write(reinterpret_cast<const char*>(entries.begin()), count * sizeof(CompactPathEntry));
+    }
+
+    if (!file) {
+        std::cerr << "Error: Failed writing run file " << filename << std::endl;
+        file.close();
+        std::remove(filename.c_str());
+        return false;
+    }
+    return true;
+}
+
+// Streams the records of one partition of a run file through a fixed-size buffer
+class PathRunReader {
+public:
+    static constexpr size_t BUFFER_SIZE = 256 * 1024;
+
+    PathRunReader() : remaining(0), bufferPos(0), bufferEnd(0), key(0), failed(false) {}
+
+    bool open(const std::string& filename, uint64_t begin, uint64_t end) {
+        file.open(filename, std::ios::binary);
+        if (!file || !file.seekg(static_cast<std::streamoff>(begin))) {
+            failed = true;
+            return false;
+        }
+        remaining = end - begin;
+        buffer.resize(BUFFER_SIZE);
+        return true;
+    }
+
+    // Load the next record; false at the end of the partition or on a read error
+    bool next() {
+        uint32_t count = 0;
+        if ((remaining == 0 && bufferPos == bufferEnd) || !read(&key, sizeof(key)) || !read(&count, sizeof(count))) {
+            return false;
+        }
+        entries.resize(count);
+        return read(entries.data(), count * sizeof(CompactPathEntry));
+    }
+
+    PropertySet currentKey() const { return key; }
+    std::vector<CompactPathEntry>& currentEntries() { return entries; }
+    bool hasFailed() const { return failed; }
+
+private:
+    std::ifstream file;
+    uint64_t remaining;
+    std::vector<char> buffer;
+    size_t bufferPos;
+    size_t bufferEnd;
+    PropertySet key;
+    std::vector<CompactPathEntry> entries;
+    bool failed;
+
+    bool read(void* out, size_t bytes) {
+        char* dest = static_cast<char*>(out);
+        while (bytes > 0) {
+            if (bufferPos == bufferEnd) {
+                size_t chunk = static_cast<size_t>(std::min<uint64_t>(remaining, buffer.size()));
+                if (chunk == 0 || !file.read(buffer.data(), chunk)) {
+                    failed = true;
+                    return false;
+                }
+                remaining -= chunk;
+                bufferPos = 0;
+                bufferEnd = chunk;
+            }
+
+            size_t take = std::min(bytes, bufferEnd - bufferPos);
+            std::memcpy(dest, buffer.data() + bufferPos, take);
+            bufferPos += take;
+            dest += take;
+            bytes -= take;
+        }
+        return true;
+    }
+};
+
+// Header and partition offsets of a run file
+struct PathRunIndex {
+    PathRunHeader header;
+    std::vector<uint64_t> partitionOffsets;
+};
+
+inline bool readPathRunIndex(const std::string& filename, PathRunIndex& index) {
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.read(reinterpret_cast<char*>(&index.header), sizeof(index.header)) ||
+        std::memcmp(index.header.magic, PATH_RUN_MAGIC, sizeof(index.header.magic)) != 0 ||
+        index.header.partitionBits > 20) {
+        std::cerr << "Error: Invalid run file " << filename << std::endl;
+        return false;
+    }
+
+    index.partitionOffsets.resize((size_t(1) << index.header.partitionBits) + 1);
+    if (!file.read(reinterpret_cast<char*>(index.partitionOffsets.data()), index.partitionOffsets.size() * sizeof(uint64_t))) {
+        std::cerr << "Error: Invalid run file " << filename << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// k-way merge of one partition of runs [first, last). Entries of a key found in
+// several runs are concatenated in run order, filtered, and handed to
+// emit(key, entries, count) in key order. False on a read error.
+template <typename Emit>
+inline bool mergeRunPartition(const std::vector<std::string>& files, const std::vector<PathRunIndex>& runs,
+    size_t first, size_t last, size_t p, PathGroupFilter filter, Emit emit) {
+    std::vector<PathRunReader> readers(last - first);
+
+    // Smallest key first, lowest run first among equal keys
+    typedef std::pair<PropertySet, size_t> HeapItem;
+    std::priority_queue<HeapItem, std::vector<HeapItem>, std::greater<HeapItem>> heap;
+    for (size_t r = 0; r < readers.size(); r++) {
+        const auto& offsets = runs[first + r].partitionOffsets;
+        if (!readers[r].open(files[first + r], offsets[p], offsets[p + 1])) {
+            return false;
+        }
+        if (readers[r].next()) {
+            heap.push({ readers[r].currentKey(), r });
+        }
+    }
+
+    std::vector<CompactPathEntry> group;
+    while (!heap.empty()) {
+        PropertySet key = heap.top().first;
+        group.clear();
+
+        while (!heap.empty() && heap.top().first == key) {
+            size_t r = heap.top().second;
+            heap.pop();
+
+            auto& entries = readers[r].currentEntries();
+            group.insert(group.end(), entries.begin(), entries.end());
+            if (readers[r].next()) {
+                heap.push({ readers[r].currentKey(), r });
+            }
+        }
+
+        size_t kept = filter ? std::min(filter(key, group.data(), group.size()), group.size()) : group.size();
+        if (kept > 0) {
+            emit(key, group.data(), kept);
+        }
+    }
+
+    for (const auto& reader : readers) {
+        if (reader.hasFailed()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Merge runs [first, last) into one new run file with the same partition layout
+inline bool mergePathRunsToFile(const std::vector<std::string>& files, const std::vector<PathRunIndex>& runs,
+    size_t first, size_t last, PathGroupFilter filter, const std::string& filename) {
+    std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        std::cerr << "Error: Could not create run file " << filename << std::endl;
+        return false;
+    }
+
+    // Header and partition offsets are rewritten once the records are known
+    PathRunHeader header = runs[first].header;
+    header.keyCount = 0;
+    header.entryCount = 0;
+    size_t partitionCount = size_t(1) << header.partitionBits;
+    std::vector<uint64_t> partitionOffsets(partitionCount + 1);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(partitionOffsets.data()), partitionOffsets.size() * sizeof(uint64_t));
+
+    uint64_t position = sizeof(header) + partitionOffsets.size() * sizeof(uint64_t);
+    bool ok = true;
+    for (size_t p = 0; p < partitionCount && ok; p++) {
+        partitionOffsets[p] = position;
+        ok = mergeRunPartition(files, runs, first, last, p, filter,
+            [&](PropertySet key, const CompactPathEntry* entries, size_t count) {
+                uint32_t count32 = static_cast<uint32_t>(count);
+                file.write(reinterpret_cast<const char*>(&key), sizeof(key));
+                file.write(reinterpret_cast<const char*>(&count32), sizeof(count32));
+                file.write(reinterpret_cast<const char*>(entries), count * sizeof(CompactPathEntry));
+                position += sizeof(key) + sizeof(count32) + count * sizeof(CompactPathEntry);
+                header.keyCount++;
+                header.entryCount += count;
+            });
+    }
+    partitionOffsets[partitionCount] = position;
+
+    if (ok) {
+        file.seekp(0);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(partitionOffsets.data()), partitionOffsets.size() * sizeof(uint64_t));
+    }
+    if (!ok || !file) {
+        std::cerr << "Error: Failed merging runs into " << filename << std::endl;
+        file.close();
+        std::remove(filename.c_str());
+        return false;
+    }
+    return true;
+}
+
+// Merge sorted run files into a table. Runs are merged at most MAX_MERGE_RUNS at a
+// time, in extra passes through intermediate run files (named after scratchPrefix)
+// when there are more, and no more than MAX_OPEN_RUNS run files are open at once.
+// The last pass streams every partition twice: once to count what the filter keeps,
+// then again straight into the final columns, so the result is never held twice.
+inline bool mergePathRuns(const std::vector<std::string>& inputFiles, size_t threads, PathGroupFilter filter,
+    const std::string& scratchPrefix, PropertyPathTable& result) {
+    static constexpr size_t MAX_MERGE_RUNS = 16;
+    static constexpr size_t MAX_OPEN_RUNS = 256;
+
+    result.clear();
+    if (inputFiles.empty()) {
+        return true;
+    }
+    threads = std::max<size_t>(1, std::min(threads, MAX_OPEN_RUNS / MAX_MERGE_RUNS));
+
+    std::vector<std::string> files = inputFiles;
+    std::vector<std::string> scratchFiles;
+    auto removeScratch = [&]() {
+        for (const auto& filename : scratchFiles) {
+            std::remove(filename.c_str());
+        }
+        scratchFiles.clear();
+    };
+
+    // All runs must share one partition layout
+    std::vector<PathRunIndex> runs(files.size());
+    for (size_t r = 0; r < files.size(); r++) {
+        if (!readPathRunIndex(files[r], runs[r])) {
+            return false;
+        }
+        if (runs[r].header.partitionBits != runs[0].header.partitionBits || runs[r].header.shift != runs[0].header.shift) {
+            std::cerr << "Error: Invalid run file " << files[r] << std::endl;
+            return false;
+        }
+    }
+
+    for (int pass = 0; files.size() > MAX_MERGE_RUNS; pass++) {
+        size_t groupCount = (files.size() + MAX_MERGE_RUNS - 1) / MAX_MERGE_RUNS;
+        std::vector<std::string> merged(groupCount);
+        std::atomic<bool> failed(false);
+        parallelFor(groupCount, threads, [&](size_t g) {
+            merged[g] = scratchPrefix + "_" + std::to_string(pass) + "_" + std::to_string(g) + ".run";
+            size_t first = g * MAX_MERGE_RUNS;
+            if (!mergePathRunsToFile(files, runs, first, std::min(first + MAX_MERGE_RUNS, files.size()), filter, merged[g])) {
+                failed = true;
+            }
+        });
+
+        // This pass's inputs are done with; the caller removes its own runs
+        std::vector<std::string> previousScratch;
+        previousScratch.swap(scratchFiles);
+        scratchFiles = merged;
+        for (const auto& filename : previousScratch) {
+            std::remove(filename.c_str());
+        }
+
+        files = merged;
+        runs.assign(files.size(), PathRunIndex());
+        for (size_t r = 0; r < files.size() && !failed; r++) {
+            failed = !readPathRunIndex(files[r], runs[r]);
+        }
+        if (failed) {
+            removeScratch();
+            return false;
+        }
+    }
+
+    size_t partitionCount = size_t(1) << runs[0].header.partitionBits;
+    std::vector<size_t> keyCounts(partitionCount, 0), entryCounts(partitionCount, 0);
+    std::atomic<bool> failed(false);
+    parallelFor(partitionCount, threads, [&](size_t p) {
+        if (!mergeRunPartition(files, runs, 0, files.size(), p, filter,
+            [&](PropertySet, const CompactPathEntry*, size_t count) {
+                keyCounts[p]++;
+                entryCounts[p] += count;
+            })) {
+            failed = true;
+        }
+    });
+
+    std::vector<size_t> keyStart(partitionCount + 1, 0), entryStart(partitionCount + 1, 0);
+    for (size_t p = 0; p < partitionCount; p++) {
+        keyStart[p + 1] = keyStart[p] + keyCounts[p];
+        entryStart[p + 1] = entryStart[p] + entryCounts[p];
+    }
+
+    std::vector<PropertySet> keys;
+    std::vector<uint32_t> offsets;
+    std::vector<CompactPathEntry> entries;
+    if (!failed) {
+        keys.resize(keyStart[partitionCount]);
+        offsets.resize(keyStart[partitionCount] + 1);
+        entries.resize(entryStart[partitionCount]);
+        offsets[keys.size()] = static_cast<uint32_t>(entries.size());
+
+        parallelFor(partitionCount, threads, [&](size_t p) {
+            size_t keyIndex = keyStart[p];
+            size_t entryIndex = entryStart[p];
+            bool ok = mergeRunPartition(files, runs, 0, files.size(), p, filter,
+                [&](PropertySet key, const CompactPathEntry* group, size_t count) {
+                    // The runs changed under us if this pass finds more than the first
+                    if (keyIndex >= keyStart[p + 1] || entryIndex + count > entryStart[p + 1]) {
+                        failed = true;
+                        return;
+                    }
+                    keys[keyIndex] = key;
+                    offsets[keyIndex] = static_cast<uint32_t>(entryIndex);
+                    std::copy(group, group + count, entries.begin() + entryIndex);
+                    keyIndex++;
+                    entryIndex += count;
+                });
+            if (!ok || keyIndex != keyStart[p + 1] || entryIndex != entryStart[p + 1]) {
+                failed = true;
+            }
+        });
+    }
+    removeScratch();
+
+    if (failed) {
+        std::cerr << "Error: Failed reading run files" << std::endl;
+        return false;
+    }
+
+    result = PropertyPathTable::fromSortedColumns(std::move(keys), std::move(offsets), std::move(entries));
+    return true;
+}
+
+// PathTableBuilder that writes its rows out as a filtered, sorted run file before
+// spilling them would take more than byteLimit (0 = never). A set of builders is
+// combined with combine(), which only touches the disk if one of them actually spilled.
+class SpillingPathTableBuilder {
+public:
+    SpillingPathTableBuilder(const std::string& runPrefix, int keyBits, size_t byteLimit, PathGroupFilter filter)
+        : runPrefix(runPrefix), byteLimit(byteLimit), filter(filter) {
+        // Enough partitions that the final merge can use every core
+        PropertyPathTable::partitionLayout(keyBits, std::max<size_t>(std::thread::hardware_concurrency(), 1),
+            partitionBits, shift);
+        reserveRows();
+    }
+
+    void add(PropertySet key, const CompactPathEntry& entry) {
+        pending.add(key, entry);
+        if (byteLimit > 0 && (pending.rowCount() + 1) * ROW_BYTES > byteLimit) {
+            spill();
+        }
+    }
+
+    size_t rowCount() const { return pending.rowCount(); }
+    const std::vector<std::string>& runs() const { return runFiles; }
+
+    // Write the pending rows to a new run file. On failure the rows stay in memory
+    // and spilling is switched off for this builder.
+    bool spill() {
+        if (pending.empty()) {
+            return true;
+        }
+
+        PropertyPathTable table = pending.build();
+        if (filter) {
+            table.rewriteGroups(filter);
+        }
+
+        std::string filename = runPrefix + "_" + std::to_string(runFiles.size()) + ".run";
+        if (!writePathRun(table, filename, partitionBits, shift)) {
+            byteLimit = 0;
+            pending.addTable(table);
+            return false;
+        }
+        runFiles.push_back(filename);
+        reserveRows();
+        return true;
+    }
+
+    void removeRuns() {
+        for (const auto& filename : runFiles) {
+            std::remove(filename.c_str());
+        }
+        runFiles.clear();
+    }
+
+    // Group the rows of all builders, in builder order, into one table. Without any
+    // spills this is a plain in-memory build; otherwise the remaining rows are spilled
+    // too and every run is merged with the builders' filter.
+    static bool combine(std::vector<SpillingPathTableBuilder>& builders, size_t threads, PropertyPathTable& result) {
+        bool spilled = false;
+        for (const auto& builder : builders) {
+            spilled = spilled || !builder.runFiles.empty();
+        }
+
+        if (!spilled) {
+            PathTableBuilder all;
+            for (auto& builder : builders) {
+                all.append(builder.pending);
+            }
+            result = all.build();
+            return true;
+        }
+
+        std::vector<std::string> files;
+        bool ok = true;
+        for (auto& builder : builders) {
+            ok = builder.spill() && ok;
+            files.insert(files.end(), builder.runFiles.begin(), builder.runFiles.end());
+        }
+
+        ok = ok && mergePathRuns(files, threads, builders.front().filter, builders.front().runPrefix + "_merge", result);
+        for (auto& builder : builders) {
+            builder.removeRuns();
+        }
+        return ok;
+    }
+
+private:
+    typedef std::pair<PropertySet, CompactPathEntry> Row;
+
+    // Peak bytes per pending row while it is spilled: the row itself, plus either the
+    // stable_sort scratch or the grouped columns built from it. Rows are reserved up
+    // front, so vector growth never holds them twice.
+    static constexpr size_t ROW_BYTES = sizeof(Row) +
+        std::max(sizeof(Row), sizeof(CompactPathEntry) + sizeof(PropertySet) + sizeof(uint32_t));
+
+    PathTableBuilder pending;
+    std::vector<std::string> runFiles;
+    std::string runPrefix;
+    size_t byteLimit;
+    PathGroupFilter filter;
+    int partitionBits;
+    int shift;
+
+    void reserveRows() {
+        if (byteLimit > 0) {
+            pending.reserve(byteLimit / ROW_BYTES);
+        }
+    }
+};
@@ -0,0 +1,179 @@
+#pragma once
+
+#include "path_table.h"
+#include <cstdint>
+#include <vector>
+#include <unordered_map>
+
+// Prefix trie of ingredient sequences. Node 0 is the empty sequence; every other
+// node is its parent's sequence plus one ingredient. Parents always have smaller ids
+// than their children.
+class PathTrie {
+public:
+    static constexpr uint32_t ROOT = 0;
+
+    PathTrie() : parentList(1, ROOT), ingredientList(1, 0), depthList(1, 0) {}
+
+    size_t size() const { return parentList.size(); }
+
+    uint32_t parent(uint32_t node) const { return parentList[node]; }
+    uint8_t ingredient(uint32_t node) const { return ingredientList[node]; }
+    uint8_t depth(uint32_t node) const { return depthList[node]; }
+
+    // Node for the sequence extended by one ingredient, created if needed
+    uint32_t child(uint32_t node, uint8_t ingredient) {
+        uint64_t edge = (static_cast<uint64_t>(node) << 8) | ingredient;
+        auto it = children.find(edge);
+        if (it != children.end()) {
+            return it->second;
+        }
+
+        uint32_t id = static_cast<uint32_t>(parentList.size());
+        parentList.push_back(node);
+        ingredientList.push_back(ingredient);
+        depthList.push_back(static_cast<uint8_t>(depthList[node] + 1));
+        children.emplace(edge, id);
+        return id;
+    }
+
+    uint32_t insert(const IngredientSequence& sequence) {
+        uint32_t node = ROOT;
+        for (uint8_t idx : sequence) {
+            node = child(node, idx);
+        }
+        return node;
+    }
+
+    IngredientSequence sequence(uint32_t node) const {
+        IngredientSequence result;
+        result.resize(depthList[node]);
+        for (size_t i = depthList[node]; i > 0; i--) {
+            result[i - 1] = ingredientList[node];
+            node = parentList[node];
+        }
+        return result;
+    }
+
+    const std::vector<uint32_t>& parents() const { return parentList; }
+    const std::vector<uint8_t>& ingredients() const { return ingredientList; }
+
+    // Adopt stored columns. Parents must precede children and no path may be longer
+    // than an IngredientSequence holds.
+    bool assign(std::vector<uint32_t>&& parents, std::vector<uint8_t>&& ingredients) {
+        if (parents.empty() || parents.size() != ingredients.size() || parents[0] != ROOT) {
+            return false;
+        }
+
+        std::vector<uint8_t> depths(parents.size(), 0);
+        for (size_t node = 1; node < parents.size(); node++) {
+            if (parents[node] >= node || depths[parents[node]] >= IngredientSequence::MAX_LENGTH) {
+                return false;
+            }
+            depths[node] = static_cast<uint8_t>(depths[parents[node]] + 1);
+        }
+
+        parentList = std::move(parents);
+        ingredientList = std::move(ingredients);
+        depthList = std::move(depths);
+
+        children.clear();
+        for (uint32_t node = 1; node < parentList.size(); node++) {
+            children.emplace((static_cast<uint64_t>(parentList[node]) << 8) | ingredientList[node], node);
+        }
+        return true;
+    }
+
+private:
+    std::vector<uint32_t> parentList;
+    std::vector<uint8_t> ingredientList;
+    std::vector<uint8_t> depthList;
+    std::unordered_map<uint64_t, uint32_t> children;   // (parent << 8 | ingredient) -> node
+};
+
+// Path entry that refers to a trie node instead of carrying its sequence
+struct TriePathEntry {
+    uint32_t node;
+    float baseValueBonus;
+    float addictiveness;
+    float valueMultiplier;
+};
+
+// Path table whose sequences live in a shared prefix trie. Keys and offsets are laid
+// out as in PropertyPathTable; full entries are rebuilt on demand.
+class PathTrieTable {
+public:
+    PathTrieTable() : offsetList(1, 0) {}
+
+    static PathTrieTable fromTable(const PathTableView& view) {
+        PathTrieTable result;
+        if (view.empty()) {
+            result.offsetList.assign(1, 0);
+            return result;
+        }
+
+        result.keyList.assign(view.keys(), view.keys() + view.size());
+        result.offsetList.assign(view.offsets(), view.offsets() + view.size() + 1);
+        result.entryList.reserve(view.entryCount());
+
+        for (size_t i = 0; i < view.entryCount(); i++) {
+            const CompactPathEntry& entry = view.entries()[i];
+            result.entryList.push_back({ result.pathTrie.insert(entry.ingredientSequence),
+                entry.baseValueBonus, entry.addictiveness, entry.valueMultiplier });
+        }
+        return result;
+    }
+
+    static PathTrieTable fromColumns(std::vector<PropertySet>&& keys, std::vector<uint32_t>&& offsets,
+        std::vector<TriePathEntry>&& entries, PathTrie&& trie) {
+        PathTrieTable result;
+        result.keyList = std::move(keys);
+        result.offsetList = std::move(offsets);
+        result.entryList = std::move(entries);
+        result.pathTrie = std::move(trie);
+        return result;
+    }
+
+    size_t size() const { return keyList.size(); }
+    size_t entryCount() const { return entryList.size(); }
+
+    CompactPathEntry entryAt(size_t index) const {
+        const TriePathEntry& stored = entryList[index];
+        CompactPathEntry entry;
+        entry.ingredientSequence = pathTrie.sequence(stored.node);
+        entry.baseValueBonus = stored.baseValueBonus;
+        entry.addictiveness = stored.addictiveness;
+        entry.valueMultiplier = stored.valueMultiplier;
+        return entry;
+    }
+
+    // Expand into a flat table for the query engines
+    PropertyPathTable toPathTable() const {
+        std::vector<CompactPathEntry> entries;
+        entries.reserve(entryList.size());
+        for (size_t i = 0; i < entryList.size(); i++) {
+            entries.push_back(entryAt(i));
+        }
+
+        std::vector<PropertySet> keys(keyList);
+        std::vector<uint32_t> offsets(offsetList);
+        return PropertyPathTable::fromSortedColumns(std::move(keys), std::move(offsets), std::move(entries));
+    }
+
+    // Stored bytes, for comparing against the flat layout
+    size_t byteSize() const {
+        return keyList.size() * sizeof(PropertySet) + offsetList.size() * sizeof(uint32_t) +
+            entryList.size() * sizeof(TriePathEntry) + pathTrie.size() * (sizeof(uint32_t) + sizeof(uint8_t));
+    }
+
+    const std::vector<PropertySet>& keys() const { return keyList; }
+    const std::vector<uint32_t>& offsets() const { return offsetList; }
+    const std::vector<TriePathEntry>& entries() const { return entryList; }
+    const PathTrie& trie() const { return pathTrie; }
+    PathTrie& trie() { return pathTrie; }
+
+private:
+    std::vector<PropertySet> keyList;
+    std::vector<uint32_t> offsetList;
+    std::vector<TriePathEntry> entryList;
+    PathTrie pathTrie;
+};
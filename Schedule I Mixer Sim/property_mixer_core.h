@@ -322,9 +322,14 @@ public:
 private:
     ProductManager() : weedMixMap(nullptr), methMixMap(nullptr), cokeMixMap(nullptr) {}
     ~ProductManager() {
+        // Drug types may share a map (see initializeGameSystem)
         delete weedMixMap;
-        delete methMixMap;
-        delete cokeMixMap;
+        if (methMixMap != weedMixMap) {
+            delete methMixMap;
+        }
+        if (cokeMixMap != weedMixMap && cokeMixMap != methMixMap) {
+            delete cokeMixMap;
+        }
 
         for (auto* recipe : mixRecipes) {
             delete recipe;
@@ -0,0 +1,128 @@
+#include "../Schedule I Mixer Sim/property_mixer_core.h"
+#include "../Schedule I Mixer Sim/mix_session.h"
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <map>
+#include <chrono>
+#include <cstdlib>
+
+// Headless mixing sessions: replays scripts saved by the visualizer (F5) through
+// MixSession, reports how long each kind of action took and prints the final state,
+// so interactive behaviour can be benchmarked and diffed without a display.
+
+// Time spent on one kind of action across all runs
+struct ActionTiming {
+    size_t count = 0;
+    double totalUs = 0.0;
+    double maxUs = 0.0;
+};
+
+// Free allocated memory
+void cleanup() {
+    for (auto& pair : products) {
+        delete pair.second;
+    }
+    products.clear();
+}
+
+void printState(const MixSession& session) {
+    std::cout << "Product: " << (session.product().empty() ? "(none)" : session.product()) << std::endl;
+
+    std::cout << "Ingredients:";
+    for (const auto& ingredient : session.history()) {
+        std::cout << " " << ingredient << ";";
+    }
+    std::cout << std::endl;
+
+    std::cout << "Properties:" << std::endl;
+    for (const auto& prop : session.properties()) {
+        std::cout << "  " << prop.property->name << " <-";
+        for (const auto& origin : prop.ingredients) {
+            std::cout << " " << origin << ";";
+        }
+        std::cout << std::endl;
+    }
+}
+
+// Replay a script repeat times; false if any action failed
+bool replayScript(const std::string& filename, int repeat, std::map<std::string, ActionTiming>& timings) {
+    std::vector<MixAction> actions;
+    if (!MixSession::loadScript(filename, actions)) {
+        return false;
+    }
+
+    bool ok = true;
+    MixSession session;
+    for (int run = 0; run < repeat; run++) {
+        session = MixSession();
+        for (size_t i = 0; i < actions.size(); i++) {
+            auto start = std::chrono::steady_clock::now();
+            bool done = session.perform(actions[i]);
+            double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+            ActionTiming& timing = timings[actions[i].verb];
+            timing.count++;
+            timing.totalUs += us;
+            timing.maxUs = std::max(timing.maxUs, us);
+
+            if (!done && run == 0) {
+                std::cerr << "Warning: " << filename << " action " << (i + 1) << " (" << actions[i].verb
+                    << (actions[i].argument.empty() ? "" : " " + actions[i].argument) << ") did nothing" << std::endl;
+                ok = false;
+            }
+        }
+    }
+
+    std::cout << "== " << filename << ": " << actions.size() << " actions" << std::endl;
+    printState(session);
+    return ok;
+}
+
+int main(int argc, char* argv[]) {
+    int repeat = 1;
+    std::vector<std::string> scripts;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--repeat" && i + 1 < argc) {
+            repeat = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (arg.compare(0, 2, "--") == 0) {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            return 1;
+        }
+        else {
+            scripts.push_back(arg);
+        }
+    }
+
+    if (scripts.empty()) {
+        std::cerr << "Usage: SessionReplay [--repeat <n>] <session script>..." << std::endl;
+        return 1;
+    }
+
+    // Initialize the property system
+    initializeGameSystem();
+
+    bool ok = true;
+    std::map<std::string, ActionTiming> timings;
+    for (const auto& script : scripts) {
+        ok &= replayScript(script, repeat, timings);
+    }
+
+    std::cout << "== Timings over " << repeat << " run(s)" << std::endl;
+    std::cout << std::left << std::setw(10) << "action" << std::right << std::setw(10) << "count"
+        << std::setw(14) << "mean us" << std::setw(14) << "max us" << std::setw(14) << "total ms" << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+    for (const auto& pair : timings) {
+        const ActionTiming& timing = pair.second;
+        std::cout << std::left << std::setw(10) << pair.first << std::right << std::setw(10) << timing.count
+            << std::setw(14) << timing.totalUs / timing.count << std::setw(14) << timing.maxUs
+            << std::setw(14) << timing.totalUs / 1000.0 << std::endl;
+    }
+
+    cleanup();
+    return ok ? 0 : 1;
+}
@@ -1,4 +1,10 @@
 #include "../Schedule I Mixer Sim/property_mixer_core.h"
+#include "../Schedule I Mixer Sim/path_table.h"
+#include "../Schedule I Mixer Sim/path_table_file.h"
+#include "../Schedule I Mixer Sim/mapped_path_table.h"
+#include "../Schedule I Mixer Sim/path_query_index.h"
+#include "../Schedule I Mixer Sim/path_table_spill.h"
+#include "../Schedule I Mixer Sim/path_step_mixer.h"
 #include <iostream>
 #include <iomanip>
 #include <vector>
@@ -16,6 +22,9 @@
 #include <unordered_map>
 #include <stack>
 #include <functional>
+#include <cstdlib>
+#include <sstream>
+#include <cstdio>
 
 // Define ingredient mapping
 std::map<std::string, std::string> ingredientPropertyMapping = {
@@ -37,23 +46,6 @@ std::map<std::string, std::string> ingredientPropertyMapping = {
     {"Battery", "brighteyed"}
 };
 
-// Memory-optimized data structures
-using PropertySet = uint64_t;    // Bit representation of properties (64 bits max)
-
-// Compact path entry structure with sequence preservation
-struct CompactPathEntry {
-    std::vector<uint8_t> ingredientSequence;  // Sequence of ingredient indices (0-15)
-    float baseValueBonus;
-    float addictiveness;
-    float valueMultiplier;
-
-    // Constructor for convenience
-    CompactPathEntry() : baseValueBonus(0), addictiveness(0), valueMultiplier(1.0f) {}
-};
-
-// Main lookup table: property bitset -> paths
-using PropertyPathTable = std::unordered_map<PropertySet, std::vector<CompactPathEntry>>;
-
 // Mapping tables for bit conversion
 std::unordered_map<std::string, uint64_t> propertyBitMapping;
 std::vector<std::string> ingredientByBitPosition;
@@ -63,6 +55,13 @@ std::vector<std::string> propertyByBitPosition;
 std::atomic<size_t> permutationsDone = 0;
 std::mutex resultMutex;
 
+// RAM budget for generation in bytes (--memory-budget); 0 keeps everything in memory
+size_t memoryBudgetBytes = 0;
+
+// Largest query covered by the answer cache (--answers); 0 only uses an existing cache
+uint32_t answerCacheTerms = 0;
+const uint32_t ANSWER_CACHE_PATHS = 5;
+
 // =================== BIT MAPPING FUNCTIONS ===================
 
 // Initialize bit mappings
@@ -166,110 +165,156 @@ void displayProgressBar(size_t totalPermutations) {
 
 // =================== FILE I/O FUNCTIONS ===================
 
-// Save path table in binary format
-void saveBinaryPathTable(const PropertyPathTable& table, const std::string& filename) {
-    std::ofstream file(filename, std::ios::binary);
-
-    if (!file) {
-        std::cerr << "Error opening file for writing: " << filename << std::endl;
-        return;
+// Hash of everything generation depends on: starting product, property data,
+// the mixer map and the ingredient list. Checkpoints from other data are never resumed.
+uint64_t computeDatasetHash(const std::string& productName) {
+    uint64_t hash = PathTableChecksum::hashBytes(productName.data(), productName.size());
+    auto hashString = [&](const std::string& value) {
+        hash = PathTableChecksum::hashBytes(value.data(), value.size() + 1, hash);
+    };
+    auto hashValue = [&](const auto& value) {
+        hash = PathTableChecksum::hashBytes(&value, sizeof(value), hash);
+    };
+
+    auto product = products.find(productName);
+    if (product != products.end()) {
+        for (auto* prop : product->second->properties) {
+            hashString(prop->id);
+        }
     }
 
-    // Write table size
-    uint32_t tableSize = table.size();
-    file.write(reinterpret_cast<const char*>(&tableSize), sizeof(tableSize));
-
-    // Write each entry
-    for (const auto& [propBits, entries] : table) {
-        // Write property bitset
-        file.write(reinterpret_cast<const char*>(&propBits), sizeof(propBits));
-
-        // Write number of entries
-        uint8_t entryCount = entries.size();
-        file.write(reinterpret_cast<const char*>(&entryCount), sizeof(entryCount));
-
-        // Write each path entry
-        for (const auto& entry : entries) {
-            // Write sequence length
-            uint8_t seqLength = entry.ingredientSequence.size();
-            file.write(reinterpret_cast<const char*>(&seqLength), sizeof(seqLength));
-
-            // Write ingredient sequence
-            for (uint8_t idx : entry.ingredientSequence) {
-                file.write(reinterpret_cast<const char*>(&idx), sizeof(idx));
-            }
+    for (const auto& [id, prop] : properties) {
+        hashString(id);
+        hashValue(prop->tier);
+        hashValue(prop->addictiveness);
+        hashValue(prop->valueChange);
+        hashValue(prop->valueMultiplier);
+        hashValue(prop->addBaseValueMultiple);
+        hashValue(prop->mixDirection.x);
+        hashValue(prop->mixDirection.y);
+        hashValue(prop->mixMagnitude);
+    }
 
-            // Write stats
-            file.write(reinterpret_cast<const char*>(&entry.baseValueBonus), sizeof(entry.baseValueBonus));
-            file.write(reinterpret_cast<const char*>(&entry.addictiveness), sizeof(entry.addictiveness));
-            file.write(reinterpret_cast<const char*>(&entry.valueMultiplier), sizeof(entry.valueMultiplier));
+    MixerMap* mixerMap = ProductManager::getInstance().getMixerMap(DrugType::Marijuana);
+    if (mixerMap) {
+        hashValue(mixerMap->mapRadius);
+        for (auto* effect : mixerMap->effects) {
+            hashValue(effect->position.x);
+            hashValue(effect->position.y);
+            hashValue(effect->radius);
+            hashString(effect->property ? effect->property->id : "");
         }
     }
 
-    file.close();
-    std::cout << "Saved " << tableSize << " property combinations to " << filename << std::endl;
+    for (const auto& [ingredient, propertyId] : ingredientPropertyMapping) {
+        hashString(ingredient);
+        hashString(propertyId);
+    }
+
+    // 0 is reserved for "unknown"
+    return hash == 0 ? 1 : hash;
 }
 
-// Load path table from binary format
-PropertyPathTable loadBinaryPathTable(const std::string& filename) {
-    PropertyPathTable table;
-    std::ifstream file(filename, std::ios::binary);
+// Names stored alongside a table so readers can interpret keys and sequences
+PathTableDictionary currentDictionary(const std::string& productName = "", int maxDepth = 0) {
+    PathTableDictionary dictionary;
+    dictionary.productName = productName;
+    dictionary.maxDepth = maxDepth;
+    dictionary.propertyIds = propertyByBitPosition;
+    dictionary.ingredientNames = ingredientByBitPosition;
+    return dictionary;
+}
 
-    if (!file) {
-        std::cerr << "Error opening file for reading: " << filename << std::endl;
-        return table;
+// Save path table in binary format (v2)
+void saveBinaryPathTable(const PropertyPathTable& table, const std::string& filename,
+    const std::string& productName = "", int maxDepth = 0) {
+    if (writePathTableFile(table, filename, currentDictionary(productName, maxDepth))) {
+        std::cout << "Saved " << table.size() << " property combinations to " << filename << std::endl;
     }
+}
 
-    // Read table size
-    uint32_t tableSize;
-    file.read(reinterpret_cast<char*>(&tableSize), sizeof(tableSize));
-
-    // Read each entry
-    for (uint32_t i = 0; i < tableSize; i++) {
-        // Read property bitset
-        PropertySet propBits;
-        file.read(reinterpret_cast<char*>(&propBits), sizeof(propBits));
-
-        // Read number of entries
-        uint8_t entryCount;
-        file.read(reinterpret_cast<char*>(&entryCount), sizeof(entryCount));
+// Save path table with its sequences stored as a prefix trie
+void saveTrieTable(const PropertyPathTable& table, const std::string& filename,
+    const std::string& productName = "", int maxDepth = 0) {
+    PathTrieTable trieTable = PathTrieTable::fromTable(PathTableView(table));
+    if (writePathTrieFile(trieTable, filename, currentDictionary(productName, maxDepth))) {
+        size_t flatBytes = table.keys().size() * sizeof(PropertySet) + table.offsets().size() * sizeof(uint32_t) +
+            table.entries().size() * sizeof(CompactPathEntry);
+        std::cout << "Saved " << table.size() << " property combinations to " << filename
+            << " as a prefix trie (" << trieTable.trie().size() << " nodes, "
+            << flatBytes / 1024 << " KB -> " << trieTable.byteSize() / 1024 << " KB)" << std::endl;
+    }
+}
 
-        // Read each path entry
-        std::vector<CompactPathEntry> entries;
-        for (uint8_t j = 0; j < entryCount; j++) {
-            CompactPathEntry entry;
+// Save a generation checkpoint; completedMask has a bit set for every first ingredient
+// whose sequences are included
+void saveCheckpoint(const PropertyPathTable& table, const std::string& filename,
+    const std::string& productName, int ingredientCount, uint64_t completedMask) {
+    PathTableDictionary dictionary = currentDictionary(productName, ingredientCount);
+    dictionary.datasetHash = computeDatasetHash(productName);
+    dictionary.completedMask = completedMask;
 
-            // Read sequence length
-            uint8_t seqLength;
-            file.read(reinterpret_cast<char*>(&seqLength), sizeof(seqLength));
+    if (writePathTableFile(table, filename, dictionary)) {
+        std::cout << "Saved " << table.size() << " property combinations to " << filename << std::endl;
+    }
+}
 
-            // Read ingredient sequence
-            entry.ingredientSequence.resize(seqLength);
-            for (uint8_t k = 0; k < seqLength; k++) {
-                file.read(reinterpret_cast<char*>(&entry.ingredientSequence[k]), sizeof(uint8_t));
-            }
+// Open a path table for querying; v2 files are mapped rather than read
+bool loadBinaryPathTable(MappedPathTable& table, const std::string& filename, std::ostream& log = std::cout) {
+    PathTableFileInfo info;
+    bool ok = table.open(filename, currentDictionary(), &info);
+    log << "Loaded " << table.size() << " property combinations from " << filename
+        << " (format v" << info.version << (table.isMapped() ? ", mapped" : "") << ")" << std::endl;
+    return ok;
+}
 
-            // Read stats
-            file.read(reinterpret_cast<char*>(&entry.baseValueBonus), sizeof(entry.baseValueBonus));
-            file.read(reinterpret_cast<char*>(&entry.addictiveness), sizeof(entry.addictiveness));
-            file.read(reinterpret_cast<char*>(&entry.valueMultiplier), sizeof(entry.valueMultiplier));
+// paths_<product>.dat -> paths_<product>.answers
+std::string answerFileName(const std::string& tableFile) {
+    size_t dot = tableFile.rfind(".dat");
+    return (dot == std::string::npos ? tableFile : tableFile.substr(0, dot)) + ".answers";
+}
 
-            entries.push_back(entry);
+// Attach the table's answer cache, first building it when --answers asks for one
+// that is missing, stale or too small
+void prepareAnswerCache(IndexedPathTable& table, const std::string& tableFile, std::ostream& log = std::cout) {
+    std::string answersFile = answerFileName(tableFile);
+    PathTableFileInfo info;
+    if (!readPathTableFileInfo(tableFile, info)) {
+        if (answerCacheTerms > 0) {
+            log << "Answer cache needs a v2 table file, skipping" << std::endl;
         }
+        return;
+    }
 
-        table[propBits] = entries;
+    if (table.attachAnswers(answersFile, info.dataChecksum) && table.answers.maxTerms() >= answerCacheTerms) {
+        log << "Using answer cache " << answersFile << " (queries of up to " << table.answers.maxTerms()
+            << " properties)" << std::endl;
+        return;
+    }
+    table.answers.close();
+    if (answerCacheTerms == 0) {
+        return;
     }
 
-    file.close();
-    std::cout << "Loaded " << table.size() << " property combinations from " << filename << std::endl;
-    return table;
+    auto startTime = std::chrono::high_resolution_clock::now();
+    size_t threads = std::max(1u, std::thread::hardware_concurrency());
+    if (!table.writeAnswers(answersFile, static_cast<uint32_t>(propertyByBitPosition.size()), answerCacheTerms,
+            ANSWER_CACHE_PATHS, info.dataChecksum, threads) ||
+        !table.attachAnswers(answersFile, info.dataChecksum)) {
+        log << "Could not build answer cache " << answersFile << std::endl;
+        return;
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::high_resolution_clock::now() - startTime).count();
+    log << "Built answer cache " << answersFile << ": " << PathAnswerCache::slotCount(
+        static_cast<uint32_t>(propertyByBitPosition.size()), answerCacheTerms) << " queries in " << elapsed << " ms" << std::endl;
 }
 
 // =================== PROCESSING FUNCTIONS ===================
 
 // Process a batch of sequences for a specific ingredient count
 void processSequenceBatch(
-    PropertyPathTable& pathTable,
+    PathTableBuilder& pathTable,
     const std::vector<Property*>& initialProperties,
     size_t startIngredient,
     size_t endIngredient,
@@ -290,16 +335,16 @@ void processSequenceBatch(
             initialProperties, firstProp, DrugType::Marijuana);
 
         // Current sequence starts with this ingredient
-        std::vector<uint8_t> currentSeq = { static_cast<uint8_t>(firstIngredient) };
+        IngredientSequence currentSeq = { static_cast<uint8_t>(firstIngredient) };
 
         // Stack-based DFS to avoid recursion and stack overflow
         struct StackState {
-            std::vector<uint8_t> sequence;
+            IngredientSequence sequence;
             std::vector<Property*> properties;
             size_t depth;
             size_t nextIngredient;
 
-            StackState(const std::vector<uint8_t>& seq, const std::vector<Property*>& props,
+            StackState(const IngredientSequence& seq, const std::vector<Property*>& props,
                 size_t d, size_t next)
                 : sequence(seq), properties(props), depth(d), nextIngredient(next) {}
         };
@@ -353,7 +398,7 @@ void processSequenceBatch(
                 // Add to results - need lock here
                 {
                     std::lock_guard<std::mutex> lock(resultMutex);
-                    pathTable[propBits].push_back(entry);
+                    pathTable.add(propBits, entry);
                 }
 
                 sequencesProcessed++;
@@ -371,7 +416,7 @@ void processSequenceBatch(
                         current.properties, prop, DrugType::Marijuana);
 
                     // Add to sequence
-                    std::vector<uint8_t> newSeq = current.sequence;
+                    IngredientSequence newSeq = current.sequence;
                     newSeq.push_back(i);
 
                     // Push to stack
@@ -383,34 +428,33 @@ void processSequenceBatch(
 }
 
 // Filter and sort path table entries - can be called after merging
-void filterAndSortPathTable(PropertyPathTable& table) {
-    for (auto& [propBits, entries] : table) {
-        if (entries.empty()) continue;
-
-        // Sort by sequence length (fewer = better)
-        std::sort(entries.begin(), entries.end(),
-            [](const CompactPathEntry& a, const CompactPathEntry& b) {
-                if (a.ingredientSequence.size() == b.ingredientSequence.size()) {
-                    return a.baseValueBonus > b.baseValueBonus;
-                }
-        return a.ingredientSequence.size() < b.ingredientSequence.size();
-            });
-
-        // Keep only shortest paths
-        size_t shortestLength = entries[0].ingredientSequence.size();
-        entries.erase(
-            std::remove_if(entries.begin(), entries.end(),
-                [shortestLength](const CompactPathEntry& entry) {
-                    return entry.ingredientSequence.size() > shortestLength;
-                }),
-            entries.end()
-                    );
-
-        // Limit to top 5
-        if (entries.size() > 5) {
-            entries.resize(5);
-        }
+// Keep the best paths of one property combination: only the shortest ones, highest
+// base value bonus first, at most 5. Returns how many of the entries to keep.
+size_t keepShortestPaths(PropertySet, CompactPathEntry* entries, size_t count) {
+    if (count == 0) return 0;
+
+    // Sort by sequence length (fewer = better); stable so ties keep their merge order
+    std::stable_sort(entries, entries + count,
+        [](const CompactPathEntry& a, const CompactPathEntry& b) {
+            if (a.ingredientSequence.size() == b.ingredientSequence.size()) {
+                return a.baseValueBonus > b.baseValueBonus;
+            }
+            return a.ingredientSequence.size() < b.ingredientSequence.size();
+        });
+
+    // Keep only shortest paths
+    size_t shortestLength = entries[0].ingredientSequence.size();
+    size_t kept = 1;
+    while (kept < count && entries[kept].ingredientSequence.size() == shortestLength) {
+        kept++;
     }
+
+    // Limit to top 5
+    return std::min<size_t>(kept, 5);
+}
+
+void filterAndSortPathTable(PropertyPathTable& table) {
+    table.rewriteGroups(keepShortestPaths);
 }
 
 // Process single ingredient combinations
@@ -419,6 +463,8 @@ void processSingleIngredientCombinations(
     const std::vector<Property*>& initialProperties
 ) {
     size_t totalIngredients = ingredientByBitPosition.size();
+    PathTableBuilder builder;
+    builder.addTable(pathTable);
 
     // Process all single-ingredient combinations directly
     for (size_t i = 0; i < totalIngredients; i++) {
@@ -449,102 +495,52 @@ void processSingleIngredientCombinations(
             entry.valueMultiplier = valueMultiplier;
 
             // Add to table
-            pathTable[propBits].push_back(entry);
+            builder.add(propBits, entry);
         }
     }
+
+    pathTable = builder.build();
 }
 
-// More efficient path table merging
-void mergePathTables(PropertyPathTable& target, PropertyPathTable& source) {
-    // Reserve capacity in target to avoid excessive reallocation
-    if (target.size() < target.size() + source.size()) {
-        target.reserve(target.size() + source.size());
+// Merge source into target and clear source. With filter set both tables must already
+// be filtered; the shortest-path filter is then reapplied to each key as it is merged,
+// which gives the same result as filtering the combined table afterwards.
+void mergePathTables(PropertyPathTable& target, PropertyPathTable& source, int numThreads, bool filter) {
+    if (source.empty()) {
+        return;
     }
 
-    // Process source entries in batches to avoid long-running operations
-    const size_t BATCH_SIZE = 1000;
-    size_t entriesProcessed = 0;
-    size_t totalEntries = source.size();
-
-    // Create a vector of keys to process to avoid iterator invalidation
-    std::vector<PropertySet> sourceKeys;
-    sourceKeys.reserve(source.size());
-    for (const auto& [propBits, _] : source) {
-        sourceKeys.push_back(propBits);
+    if (target.empty()) {
+        target.swap(source);
+        return;
     }
 
-    // Display merge progress
-    auto startTime = std::chrono::steady_clock::now();
-
-    // Process keys in batches
-    for (size_t i = 0; i < sourceKeys.size(); i++) {
-        PropertySet propBits = sourceKeys[i];
-        auto& entries = source[propBits];
-
-        // Move entries to target
-        auto targetIt = target.find(propBits);
-        if (targetIt == target.end()) {
-            // Property set not in target, insert directly
-            target.emplace(propBits, std::move(entries));
-        }
-        else {
-            // Already exists in target, append entries
-            auto& targetEntries = targetIt->second;
-            targetEntries.insert(
-                targetEntries.end(),
-                std::make_move_iterator(entries.begin()),
-                std::make_move_iterator(entries.end())
-            );
-        }
-
-        // Empty the source entries to free memory immediately
-        std::vector<CompactPathEntry>().swap(entries);
-
-        // Update progress every batch
-        entriesProcessed++;
-        if (entriesProcessed % BATCH_SIZE == 0 || entriesProcessed == totalEntries) {
-            auto now = std::chrono::steady_clock::now();
-            auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(now - startTime).count();
-            if (elapsed == 0) elapsed = 1;
-
-            float progress = static_cast<float>(entriesProcessed) / totalEntries;
-            float entriesPerSecond = static_cast<float>(entriesProcessed) / elapsed;
-
-            int eta = 0;
-            if (progress > 0.01f) {
-                eta = static_cast<int>((1.0f - progress) * elapsed / progress);
-            }
-
-            std::cout << "\rMerge: " << std::fixed << std::setprecision(1)
-                << (progress * 100.0f) << "% ("
-                << entriesProcessed << "/" << totalEntries
-                << "), " << static_cast<int>(entriesPerSecond) << " entries/s"
-                << ", ETA: " << eta << "s" << std::flush;
-        }
-    }
+    PropertyPathTable merged = filter
+        ? PropertyPathTable::merge(target, source, numThreads, keepShortestPaths)
+        : PropertyPathTable::merge(target, source, numThreads);
+    target.swap(merged);
 
     // Clear the source table completely to free memory
-    PropertyPathTable empty;
-    source.swap(empty);
-
-    std::cout << std::endl;
+    source.clear();
 }
 
 // =================== MAIN PROCESSING FUNCTION ===================
 
-// Process ingredients recursively, one first-ingredient at a time
-PropertyPathTable processIngredientBatch(
+// Process ingredients recursively, one first-ingredient at a time.
+// False if spilled results could not be merged back from disk.
+bool processIngredientBatch(
     int firstIngredient,
     int targetDepth,
     const std::vector<Property*>& initialProperties,
-    int numThreads
+    int numThreads,
+    PropertyPathTable& batchResult
 ) {
-    PropertyPathTable batchResult;
+    batchResult.clear();
     std::string firstIngName = ingredientByBitPosition[firstIngredient];
     Property* firstProp = getPropertyByNameOrId(ingredientPropertyMapping[firstIngName]);
 
     if (!firstProp) {
-        return batchResult; // Empty result if ingredient not found
+        return true; // Empty result if ingredient not found
     }
 
     // Apply first ingredient
@@ -552,7 +548,7 @@ PropertyPathTable processIngredientBatch(
         initialProperties, firstProp, DrugType::Marijuana);
 
     // Create stack state with first ingredient
-    std::vector<uint8_t> startSeq = { static_cast<uint8_t>(firstIngredient) };
+    IngredientSequence startSeq = { static_cast<uint8_t>(firstIngredient) };
 
     // If target depth is 1, we're done
     if (targetDepth == 1) {
@@ -573,14 +569,24 @@ PropertyPathTable processIngredientBatch(
         entry.valueMultiplier = valueMultiplier;
 
         PropertySet propBits = propertiesToBitset(firstProps);
-        batchResult[propBits].push_back(entry);
-        return batchResult;
+        PathTableBuilder builder;
+        builder.add(propBits, entry);
+        batchResult = builder.build();
+        return true;
     }
 
     // For depth > 1, process in parallel
     std::vector<std::thread> workers;
-    std::vector<PropertyPathTable> threadResults(numThreads);
     std::atomic<size_t> sequencesProcessed(0);
+
+    // Under a memory budget each thread spills its rows to sorted run files once it holds
+    // its share; half the budget is left for the merged tables
+    size_t threadBudget = memoryBudgetBytes / (2 * static_cast<size_t>(numThreads));
+    std::vector<SpillingPathTableBuilder> threadResults;
+    for (int t = 0; t < numThreads; t++) {
+        threadResults.emplace_back("paths_spill_" + std::to_string(firstIngredient) + "_" + std::to_string(t),
+            static_cast<int>(propertyByBitPosition.size()), threadBudget, keepShortestPaths);
+    }
     std::atomic<int> completedThreads(0);
 
     // Calculate how many ingredients each thread should handle
@@ -607,17 +613,17 @@ PropertyPathTable processIngredientBatch(
                     firstProps, secondProp, DrugType::Marijuana);
 
                 // Start sequence with first and second ingredients
-                std::vector<uint8_t> currentSeq = startSeq;
+                IngredientSequence currentSeq = startSeq;
                 currentSeq.push_back(secondIdx);
 
                 // Stack-based processing for depth > 2
                 if (targetDepth > 2) {
                     struct StackState {
-                        std::vector<uint8_t> sequence;
+                        IngredientSequence sequence;
                         std::vector<Property*> properties;
                         size_t depth;
 
-                        StackState(const std::vector<uint8_t>& seq, const std::vector<Property*>& props, size_t d)
+                        StackState(const IngredientSequence& seq, const std::vector<Property*>& props, size_t d)
                             : sequence(seq), properties(props), depth(d) {}
                     };
 
@@ -647,7 +653,7 @@ PropertyPathTable processIngredientBatch(
                             entry.valueMultiplier = valueMultiplier;
 
                             PropertySet propBits = propertiesToBitset(current.properties);
-                            threadResults[t][propBits].push_back(entry);
+                            threadResults[t].add(propBits, entry);
                             sequencesProcessed++;
                             continue;
                         }
@@ -661,7 +667,7 @@ PropertyPathTable processIngredientBatch(
                                 std::vector<Property*> nextProps = PropertyMixCalculator::mixProperties(
                                     current.properties, nextProp, DrugType::Marijuana);
 
-                                std::vector<uint8_t> nextSeq = current.sequence;
+                                IngredientSequence nextSeq = current.sequence;
                                 nextSeq.push_back(nextIdx);
 
                                 dfsStack.push(StackState(nextSeq, nextProps, current.depth + 1));
@@ -688,7 +694,7 @@ PropertyPathTable processIngredientBatch(
                     entry.valueMultiplier = valueMultiplier;
 
                     PropertySet propBits = propertiesToBitset(secondProps);
-                    threadResults[t][propBits].push_back(entry);
+                    threadResults[t].add(propBits, entry);
                     sequencesProcessed++;
                 }
             }
@@ -776,22 +782,123 @@ PropertyPathTable processIngredientBatch(
         progressThread.join();
     }
 
-    // Merge thread results into batch result
-    for (int t = 0; t < numThreads; t++) {
-        mergePathTables(batchResult, threadResults[t]);
+    // Group all thread results into the batch result, merging spilled runs back from disk
+    if (!SpillingPathTableBuilder::combine(threadResults, numThreads, batchResult)) {
+        std::cerr << "Error: Could not merge spilled results for " << firstIngName << std::endl;
+        return false;
     }
 
     // Filter and sort the batch result
     filterAndSortPathTable(batchResult);
 
-    return batchResult;
+    return true;
+}
+
+// Where an interrupted generation run can pick up again. findResumePoint only
+// vets checkpoint headers; loadResumePoint reads the tables themselves.
+struct ResumePoint {
+    int ingredientCount = 1;                // Depth to continue at
+    size_t nextFirstIdx = 0;                // First ingredient to process next at that depth
+    std::string globalFile;                 // Checkpoint of all shallower depths, empty if none
+    std::string incrementalFile;            // Interim checkpoint at this depth, empty if none
+    uint64_t globalRows = 0;
+    uint64_t incrementalRows = 0;
+    PropertyPathTable globalPathTable;      // All shallower depths
+    PropertyPathTable incrementalResults;   // Batches already merged at this depth
+};
+
+std::string checkpointFileName(const std::string& productName, int ingredientCount) {
+    return "paths_" + (productName.empty() ? "none" : productName) + "_" + std::to_string(ingredientCount) + ".dat";
+}
+
+std::string interimFileName(const std::string& productName, int ingredientCount, size_t firstIdx) {
+    return "paths_" + (productName.empty() ? "none" : productName) + "_" + std::to_string(ingredientCount) +
+        "_interim_" + std::to_string(firstIdx) + ".dat";
+}
+
+// True if a checkpoint's header says it was produced from the current data at the
+// given depth with exactly the given first ingredients completed; rows gets its row count
+bool checkpointMatches(const std::string& filename, const std::string& productName, int ingredientCount,
+    uint64_t completedMask, uint64_t& rows) {
+    PathTableFileInfo info;
+    if (!readPathTableFileInfo(filename, info) ||
+        info.dictionary.datasetHash != computeDatasetHash(productName) ||
+        info.dictionary.maxDepth != static_cast<uint32_t>(ingredientCount) ||
+        info.dictionary.completedMask != completedMask ||
+        info.dictionary.propertyIds != propertyByBitPosition ||
+        info.dictionary.ingredientNames != ingredientByBitPosition) {
+        return false;
+    }
+    rows = info.keyCount;
+    return true;
+}
+
+// Load a checkpoint in full, so the data checksum is verified
+bool loadCheckpoint(const std::string& filename, PropertyPathTable& table) {
+    PathTableFileInfo info;
+    table = readPathTableFile(filename, currentDictionary(), &info);
+    return info.version != 0 && table.size() == info.keyCount;
 }
 
-// Memory-efficient approach for generating combinations with incremental processing
-PropertyPathTable findAllPaths(int maxIngredientCount, int numThreads, const std::string& productName = "") {
-    PropertyPathTable globalPathTable;
+// Find the furthest consistent checkpoint for this product, up to maxIngredientCount.
+// Only headers are read; nothing is loaded until loadResumePoint.
+bool findResumePoint(const std::string& productName, int maxIngredientCount, ResumePoint& resume) {
+    size_t totalIngredients = ingredientByBitPosition.size();
+    uint64_t allIngredients = totalIngredients >= 64 ? ~0ULL : (1ULL << totalIngredients) - 1;
+    resume = ResumePoint();
+
+    // Latest depth that finished completely
+    int completedDepth = 0;
+    for (int depth = maxIngredientCount; depth >= 1; depth--) {
+        std::string filename = checkpointFileName(productName, depth);
+        if (checkpointMatches(filename, productName, depth, allIngredients, resume.globalRows)) {
+            completedDepth = depth;
+            resume.globalFile = filename;
+            break;
+        }
+    }
+    resume.ingredientCount = completedDepth + 1;
+
+    // Latest interim checkpoint within the next depth
+    if (resume.ingredientCount >= 2 && resume.ingredientCount <= maxIngredientCount) {
+        for (size_t firstIdx = totalIngredients; firstIdx-- > 0;) {
+            uint64_t completedMask = firstIdx + 1 >= 64 ? ~0ULL : (1ULL << (firstIdx + 1)) - 1;
+            std::string filename = interimFileName(productName, resume.ingredientCount, firstIdx);
+            if (checkpointMatches(filename, productName, resume.ingredientCount, completedMask, resume.incrementalRows)) {
+                resume.nextFirstIdx = firstIdx + 1;
+                resume.incrementalFile = filename;
+                break;
+            }
+        }
+    }
+
+    return completedDepth > 0 || resume.nextFirstIdx > 0;
+}
+
+// Read the checkpoints findResumePoint picked; false (with nothing kept) if one is damaged
+bool loadResumePoint(ResumePoint& resume) {
+    if ((!resume.globalFile.empty() && !loadCheckpoint(resume.globalFile, resume.globalPathTable)) ||
+        (!resume.incrementalFile.empty() && !loadCheckpoint(resume.incrementalFile, resume.incrementalResults))) {
+        resume.globalPathTable.clear();
+        resume.incrementalResults.clear();
+        return false;
+    }
+    return true;
+}
+
+// Memory-efficient approach for generating combinations with incremental processing.
+// False if a batch failed; the checkpoints written so far are kept for resuming.
+bool findAllPaths(int maxIngredientCount, int numThreads, PropertyPathTable& globalPathTable,
+    const std::string& productName = "", ResumePoint* resume = nullptr) {
+    globalPathTable.clear();
     std::vector<Property*> initialProperties;
 
+    // Path entries hold a fixed number of ingredient slots
+    if (maxIngredientCount > static_cast<int>(IngredientSequence::MAX_LENGTH)) {
+        std::cout << "Limiting maximum ingredients to " << IngredientSequence::MAX_LENGTH << std::endl;
+        maxIngredientCount = static_cast<int>(IngredientSequence::MAX_LENGTH);
+    }
+
     // Get initial properties from product if provided
     if (!productName.empty()) {
         auto it = products.find(productName);
@@ -804,8 +911,28 @@ PropertyPathTable findAllPaths(int maxIngredientCount, int numThreads, const std
         }
     }
 
+    if (memoryBudgetBytes > 0) {
+        std::cout << "Memory budget: " << memoryBudgetBytes / (1024 * 1024) << " MB, spilling to disk beyond it" << std::endl;
+    }
+
+    size_t totalIngredients = ingredientByBitPosition.size();
+    uint64_t allIngredients = totalIngredients >= 64 ? ~0ULL : (1ULL << totalIngredients) - 1;
+
+    // Pick up from a checkpoint if one was supplied
+    int startCount = 1;
+    size_t startFirstIdx = 0;
+    PropertyPathTable resumedResults;
+    if (resume) {
+        startCount = resume->ingredientCount;
+        startFirstIdx = resume->nextFirstIdx;
+        globalPathTable.swap(resume->globalPathTable);
+        resumedResults.swap(resume->incrementalResults);
+        std::cout << "Resuming at " << startCount << " ingredient combinations, first ingredient "
+            << startFirstIdx + 1 << "/" << totalIngredients << std::endl;
+    }
+
     // Process one ingredient count at a time
-    for (int ingredientCount = 1; ingredientCount <= maxIngredientCount; ingredientCount++) {
+    for (int ingredientCount = startCount; ingredientCount <= maxIngredientCount; ingredientCount++) {
         std::cout << "\n========== Processing " << ingredientCount << " ingredient combinations ==========" << std::endl;
 
         // For 1-ingredient paths, use simple processing
@@ -813,54 +940,57 @@ PropertyPathTable findAllPaths(int maxIngredientCount, int numThreads, const std
             processSingleIngredientCombinations(globalPathTable, initialProperties);
 
             // Save progress
-            std::string finalFile = "paths_" +
-                (productName.empty() ? "none" : productName) +
-                "_" + std::to_string(ingredientCount) + ".dat";
-
-            saveBinaryPathTable(globalPathTable, finalFile);
+            saveCheckpoint(globalPathTable, checkpointFileName(productName, ingredientCount),
+                productName, ingredientCount, allIngredients);
             std::cout << "Completed 1-ingredient combinations." << std::endl;
             std::cout << "Current unique property combinations: " << globalPathTable.size() << std::endl;
             continue;
         }
 
         // For multi-ingredient paths, process one first-ingredient at a time
-        size_t totalIngredients = ingredientByBitPosition.size();
         PropertyPathTable incrementalResults;
+        size_t firstIdxBegin = 0;
+        if (ingredientCount == startCount) {
+            incrementalResults.swap(resumedResults);
+            filterAndSortPathTable(incrementalResults);     // Interim files from older builds are unfiltered
+            firstIdxBegin = startFirstIdx;
+        }
+        uint64_t completedMask = firstIdxBegin >= 64 ? ~0ULL : (1ULL << firstIdxBegin) - 1;
 
         auto startTime = std::chrono::steady_clock::now();
 
-        for (size_t firstIdx = 0; firstIdx < totalIngredients; firstIdx++) {
+        for (size_t firstIdx = firstIdxBegin; firstIdx < totalIngredients; firstIdx++) {
             std::cout << "\nProcessing first ingredient " << firstIdx + 1 << "/" << totalIngredients
                 << " (" << ingredientByBitPosition[firstIdx] << ")" << std::endl;
 
             // Process this batch
-            PropertyPathTable batchResult = processIngredientBatch(
-                firstIdx, ingredientCount, initialProperties, numThreads);
+            PropertyPathTable batchResult;
+            if (!processIngredientBatch(firstIdx, ingredientCount, initialProperties, numThreads, batchResult)) {
+                return false;
+            }
 
             // Get interim batch size
             size_t batchCombinations = batchResult.size();
 
             // Merge this batch into incremental results
             std::cout << "Merging batch into incremental results..." << std::endl;
-            mergePathTables(incrementalResults, batchResult);
+            mergePathTables(incrementalResults, batchResult, numThreads, true);
+            completedMask |= 1ULL << firstIdx;
 
             // Save interim results after each first ingredient
-            std::string interimFile = "paths_" +
-                (productName.empty() ? "none" : productName) +
-                "_" + std::to_string(ingredientCount) +
-                "_interim_" + std::to_string(firstIdx) + ".dat";
-
-            saveBinaryPathTable(incrementalResults, interimFile);
+            saveCheckpoint(incrementalResults, interimFileName(productName, ingredientCount, firstIdx),
+                productName, ingredientCount, completedMask);
 
             // Calculate overall progress
             float overallProgress = (firstIdx + 1.0f) / totalIngredients;
+            float sessionProgress = (firstIdx + 1.0f - firstIdxBegin) / (totalIngredients - firstIdxBegin);
 
             // Calculate ETA
             auto now = std::chrono::steady_clock::now();
             auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(now - startTime).count();
             int eta = 0;
-            if (overallProgress > 0.01f) {
-                eta = static_cast<int>((1.0f - overallProgress) * elapsed / overallProgress);
+            if (sessionProgress > 0.01f) {
+                eta = static_cast<int>((1.0f - sessionProgress) * elapsed / sessionProgress);
             }
 
             int etaHrs = eta / 3600;
@@ -876,125 +1006,452 @@ PropertyPathTable findAllPaths(int maxIngredientCount, int numThreads, const std
                 << " (+" << batchCombinations << " from this batch)" << std::endl;
         }
 
-        // Final filtering and sorting
+        // Batches were filtered as they were merged; just add the new depth to the global results
         std::cout << "\nFinalizing results for " << ingredientCount << " ingredient combinations..." << std::endl;
-        filterAndSortPathTable(incrementalResults);
-
-        // Merge with global results
-        mergePathTables(globalPathTable, incrementalResults);
+        mergePathTables(globalPathTable, incrementalResults, numThreads, false);
 
         // Save final results for this ingredient count
-        std::string finalFile = "paths_" +
-            (productName.empty() ? "none" : productName) +
-            "_" + std::to_string(ingredientCount) + ".dat";
-
-        saveBinaryPathTable(globalPathTable, finalFile);
+        saveCheckpoint(globalPathTable, checkpointFileName(productName, ingredientCount),
+            productName, ingredientCount, allIngredients);
         std::cout << "Completed " << ingredientCount << " ingredient combinations." << std::endl;
         std::cout << "Total unique property combinations: " << globalPathTable.size() << std::endl;
     }
 
-    return globalPathTable;
+    return true;
+}
+
+// Offer to continue from checkpoints left by an interrupted run, then generate
+bool generatePathTable(int maxIngredientCount, int numThreads, const std::string& productName, PropertyPathTable& result) {
+    int depthLimit = std::min(maxIngredientCount, static_cast<int>(IngredientSequence::MAX_LENGTH));
+    ResumePoint resume;
+
+    if (findResumePoint(productName, depthLimit, resume)) {
+        std::cout << "Found checkpoint: " << resume.ingredientCount - 1 << "-ingredient combinations complete ("
+            << resume.globalRows << " rows)";
+        if (resume.nextFirstIdx > 0) {
+            std::cout << ", " << resume.nextFirstIdx << "/" << ingredientByBitPosition.size()
+                << " first ingredients done for " << resume.ingredientCount << " (" << resume.incrementalRows << " rows)";
+        }
+        std::cout << ". Resume? (y/n): ";
+
+        char response;
+        std::cin >> response;
+        std::cin.ignore();  // Clear newline
+
+        if (response == 'y' || response == 'Y') {
+            if (loadResumePoint(resume)) {
+                return findAllPaths(maxIngredientCount, numThreads, result, productName, &resume);
+            }
+            std::cerr << "Error: Could not load the checkpoint; starting over" << std::endl;
+        }
+    }
+
+    return findAllPaths(maxIngredientCount, numThreads, result, productName);
 }
 
 // =================== PATH SEARCH FUNCTION ===================
 
-// Find paths for desired properties
-void findPathsForDesiredProperties(const PropertyPathTable& table, const std::vector<std::string>& desiredPropertyIds) {
-    std::cout << "Finding paths for properties: ";
-    for (const auto& id : desiredPropertyIds) {
-        std::cout << id << " ";
+// Parse "min-max", "min-" (no upper limit) or a single value, which is either the
+// lower bound or, with singleIsExact, both bounds
+bool parseRange(const std::string& text, float& low, float& high, bool singleIsExact) {
+    size_t dash = text.find('-', 1);
+    char* end = nullptr;
+
+    low = std::strtof(text.c_str(), &end);
+    if (end == text.c_str()) return false;
+    if (dash == std::string::npos) {
+        high = singleIsExact ? low : std::numeric_limits<float>::infinity();
+        return *end == '\0';
     }
-    std::cout << std::endl;
+    if (end != text.c_str() + dash) return false;
 
-    // Convert desired property IDs to a bitset
-    PropertySet desiredBits = 0;
+    std::string upper = text.substr(dash + 1);
+    if (upper.empty()) {
+        high = std::numeric_limits<float>::infinity();
+        return true;
+    }
+    high = std::strtof(upper.c_str(), &end);
+    return end != upper.c_str() && *end == '\0';
+}
+
+// Replays queried paths from the product's properties (for never-through terms)
+PathStepMixer queryStepMixer;
+
+void setQueryProduct(const std::string& productName) {
+    auto it = products.find(productName);
+    queryStepMixer = PathStepMixer(it != products.end() ? it->second->properties : std::vector<Property*>(),
+        ingredientByBitPosition, ingredientPropertyMapping, propertyBitMapping);
+}
+
+// A parsed query line
+struct ParsedQuery {
+    PathScanFilter filter;
     std::vector<Property*> desiredProps;
+    std::vector<Property*> excludedProps;
+    std::vector<Property*> avoidedProps;    // Never at any step
+    std::vector<std::string> warnings;
+    bool hasCriteria = false;       // At least one valid property or filter
+};
 
-    for (const auto& id : desiredPropertyIds) {
-        Property* prop = getPropertyByNameOrId(id);
-        if (prop) {
-            desiredBits |= propertyToBit(prop);
-            desiredProps.push_back(prop);
-            std::cout << " - " << prop->name << " (Tier " << prop->tier << ")" << std::endl;
+// Split a comma-separated query line into trimmed terms
+std::vector<std::string> splitQueryTerms(const std::string& input) {
+    std::vector<std::string> terms;
+    std::stringstream ss(input);
+    std::string term;
+
+    while (std::getline(ss, term, ',')) {
+        term.erase(0, term.find_first_not_of(" \t\r"));
+        term.erase(term.find_last_not_of(" \t\r") + 1);
+
+        if (!term.empty()) {
+            terms.push_back(term);
+        }
+    }
+    return terms;
+}
+
+// Terms are property IDs to include, IDs prefixed with '-' to exclude from the
+// result or '!' to never pass through at any step, and props=N[-M],
+// addict=MIN[-MAX] and bonus=MIN[-MAX] filters. A range may leave out MAX after the
+// dash; a single props value is exact, a single addict or bonus value a minimum.
+ParsedQuery parseQueryTerms(const std::vector<std::string>& terms) {
+    ParsedQuery query;
+    PathScanFilter& filter = query.filter;
+
+    for (const auto& id : terms) {
+        size_t equals = id.find('=');
+        if (equals != std::string::npos) {
+            std::string name = id.substr(0, equals);
+            float low, high;
+            if (!parseRange(id.substr(equals + 1), low, high, name == "props")) {
+                query.warnings.push_back("Invalid range in '" + id + "'");
+            }
+            else if (name == "props") {
+                filter.minProperties = static_cast<uint8_t>(std::max(0.0f, std::min(low, 64.0f)));
+                filter.maxProperties = static_cast<uint8_t>(std::max(0.0f, std::min(high, 64.0f)));
+                query.hasCriteria = true;
+            }
+            else if (name == "addict") {
+                filter.minAddictiveness = low;
+                filter.maxAddictiveness = high;
+                query.hasCriteria = true;
+            }
+            else if (name == "bonus") {
+                filter.minBaseValueBonus = low;
+                filter.maxBaseValueBonus = high;
+                query.hasCriteria = true;
+            }
+            else {
+                query.warnings.push_back("Unknown filter '" + name + "'");
+            }
+            continue;
+        }
+
+        bool exclude = id[0] == '-';
+        bool avoid = id[0] == '!';
+        Property* prop = getPropertyByNameOrId(exclude || avoid ? id.substr(1) : id);
+        if (!prop) {
+            query.warnings.push_back("Unknown property '" + id + "'");
+        }
+        else if (avoid) {
+            filter.neverThrough |= propertyToBit(prop);
+            filter.stepProperties = std::cref(queryStepMixer);
+            query.avoidedProps.push_back(prop);
+            query.hasCriteria = true;
+        }
+        else if (exclude) {
+            filter.exclude |= propertyToBit(prop);
+            query.excludedProps.push_back(prop);
+            query.hasCriteria = true;
         }
         else {
-            std::cout << "Warning: Unknown property '" << id << "'" << std::endl;
+            filter.include |= propertyToBit(prop);
+            query.desiredProps.push_back(prop);
+            query.hasCriteria = true;
         }
     }
 
-    if (desiredProps.empty()) {
-        std::cout << "No valid properties specified." << std::endl;
-        return;
+    return query;
+}
+
+// Print one path, highlighting the desired properties
+void printPathMatch(int number, const PathQueryMatch& match, const std::vector<Property*>& desiredProps) {
+    const CompactPathEntry& entry = *match.entry;
+
+    // Convert ingredient indices to names
+    std::vector<std::string> ingredientNames;
+    for (uint8_t idx : entry.ingredientSequence) {
+        if (idx < ingredientByBitPosition.size()) {
+            ingredientNames.push_back(ingredientByBitPosition[idx]);
+        }
     }
 
-    // Find matching paths
-    std::vector<std::pair<PropertySet, CompactPathEntry>> matchingPaths;
+    // Get all properties
+    std::vector<Property*> allProps = bitsetToProperties(match.properties);
 
-    for (const auto& [propBits, entries] : table) {
-        // Check if all desired bits are present
-        if ((propBits & desiredBits) == desiredBits) {
-            // Add all entries for this property combination
-            for (const auto& entry : entries) {
-                matchingPaths.emplace_back(propBits, entry);
-            }
+    std::cout << "\nPath " << number << " (" << ingredientNames.size() << " ingredients):" << std::endl;
+    std::cout << "Ingredients (in order): ";
+    for (const auto& name : ingredientNames) {
+        std::cout << name << " ";
+    }
+    std::cout << std::endl;
+
+    std::cout << "Properties (" << allProps.size() << "): ";
+    for (auto* prop : allProps) {
+        // Highlight desired properties
+        bool isDesired = std::find(desiredProps.begin(), desiredProps.end(), prop) != desiredProps.end();
+        if (isDesired) {
+            std::cout << "[" << prop->name << "] ";
+        }
+        else {
+            std::cout << prop->name << " ";
         }
     }
+    std::cout << std::endl;
 
-    // Sort by ingredient count only (fewer = better)
-    std::sort(matchingPaths.begin(), matchingPaths.end(),
-        [](const auto& a, const auto& b) {
-            return a.second.ingredientSequence.size() < b.second.ingredientSequence.size();
-        });
+    std::cout << "Base Value Bonus: " << entry.baseValueBonus << std::endl;
+    std::cout << "Addictiveness: " << entry.addictiveness << std::endl;
+    std::cout << "Value Multiplier: " << entry.valueMultiplier << std::endl;
+}
+
+// Find paths for desired properties (see parseQueryTerms for the term syntax)
+void findPathsForDesiredProperties(const IndexedPathTable& table, const std::vector<std::string>& desiredPropertyIds) {
+    std::cout << "Finding paths for properties: ";
+    for (const auto& id : desiredPropertyIds) {
+        std::cout << id << " ";
+    }
+    std::cout << std::endl;
+
+    ParsedQuery query = parseQueryTerms(desiredPropertyIds);
+    const std::vector<Property*>& desiredProps = query.desiredProps;
+    for (const auto& warning : query.warnings) {
+        std::cout << "Warning: " << warning << std::endl;
+    }
+    for (auto* prop : query.excludedProps) {
+        std::cout << " - not " << prop->name << std::endl;
+    }
+    for (auto* prop : query.avoidedProps) {
+        std::cout << " - never " << prop->name << std::endl;
+    }
+    for (auto* prop : desiredProps) {
+        std::cout << " - " << prop->name << " (Tier " << prop->tier << ")" << std::endl;
+    }
+
+    if (!query.hasCriteria) {
+        std::cout << "No valid properties specified." << std::endl;
+        return;
+    }
+
+    PathQueryResult result = table.query(query.filter, 5);
 
     // Display results
-    if (matchingPaths.empty()) {
+    if (result.paths.empty()) {
         std::cout << "No paths found that contain all specified properties." << std::endl;
+
+        // Suggest the property sets that get closest
+        std::vector<PathNearMatch> nearest = table.findNearest(query.filter, 5);
+        if (nearest.empty()) {
+            return;
+        }
+        std::cout << "\nClosest achievable property sets:" << std::endl;
+
+        int shown = 0;
+        for (const auto& near : nearest) {
+            printPathMatch(++shown, near.match, desiredProps);
+
+            std::cout << "Covers " << near.covered << " of " << desiredProps.size() << " (missing: ";
+            bool first = true;
+            for (auto* prop : desiredProps) {
+                if (!(near.match.properties & propertiesToBitset({ prop }))) {
+                    std::cout << (first ? "" : ", ") << prop->name;
+                    first = false;
+                }
+            }
+            std::cout << ")" << std::endl;
+        }
         return;
     }
 
-    std::cout << "\nFound " << matchingPaths.size() << " paths. Showing top 5:" << std::endl;
+    std::cout << "\nFound " << result.totalPaths << " paths. Showing top 5:" << std::endl;
 
     int shown = 0;
-    for (const auto& [propBits, entry] : matchingPaths) {
-        if (shown >= 5) break;
-
-        // Convert ingredient indices to names
-        std::vector<std::string> ingredientNames;
-        for (uint8_t idx : entry.ingredientSequence) {
-            if (idx < ingredientByBitPosition.size()) {
-                ingredientNames.push_back(ingredientByBitPosition[idx]);
+    for (const auto& match : result.paths) {
+        printPathMatch(++shown, match, desiredProps);
+    }
+}
+
+// =================== BATCH QUERIES ===================
+
+// Output formats for --batch
+enum class BatchFormat {
+    JsonLines,
+    Csv
+};
+
+std::string jsonString(const std::string& value) {
+    std::string out = "\"";
+    for (char c : value) {
+        switch (c) {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                char escaped[8];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                out += escaped;
+            }
+            else {
+                out += c;
             }
         }
+    }
+    return out + "\"";
+}
 
-        // Get all properties
-        std::vector<Property*> allProps = bitsetToProperties(propBits);
+std::string csvField(const std::string& value) {
+    if (value.find_first_of(",\"\r\n") == std::string::npos) {
+        return value;
+    }
+    std::string out = "\"";
+    for (char c : value) {
+        out += c;
+        if (c == '"') {
+            out += '"';
+        }
+    }
+    return out + "\"";
+}
 
-        std::cout << "\nPath " << (shown + 1) << " (" << ingredientNames.size() << " ingredients):" << std::endl;
-        std::cout << "Ingredients (in order): ";
-        for (const auto& name : ingredientNames) {
-            std::cout << name << " ";
+// NaN and infinity have no JSON spelling: null in JSON, an empty value in CSV
+std::string formatNumber(double value, BatchFormat format) {
+    if (!std::isfinite(value)) {
+        return format == BatchFormat::Csv ? "" : "null";
+    }
+    std::ostringstream out;
+    out << value;
+    return out.str();
+}
+
+const char* const BATCH_NO_CRITERIA_ERROR = "No valid properties specified";
+
+// One output line for a query. CSV rows hold every path in a cell, paths separated
+// by ';', ingredients by '>' and properties by '+'. A query without any valid
+// criteria gets an error in both formats.
+std::string formatBatchResult(const std::string& line, const ParsedQuery& query,
+    const PathQueryResult& result, BatchFormat format) {
+    std::vector<std::string> sequences, propertyLists, bonuses, addictiveness, multipliers;
+    std::vector<std::vector<std::string>> ingredientNames, propertyIds;
+
+    for (const auto& match : result.paths) {
+        std::vector<std::string> names;
+        for (uint8_t idx : match.entry->ingredientSequence) {
+            names.push_back(idx < ingredientByBitPosition.size() ? ingredientByBitPosition[idx] : "?");
         }
-        std::cout << std::endl;
-
-        std::cout << "Properties (" << allProps.size() << "): ";
-        for (auto* prop : allProps) {
-            // Highlight desired properties
-            bool isDesired = std::find(desiredProps.begin(), desiredProps.end(), prop) != desiredProps.end();
-            if (isDesired) {
-                std::cout << "[" << prop->name << "] ";
-            }
-            else {
-                std::cout << prop->name << " ";
+        std::vector<std::string> ids;
+        for (auto* prop : bitsetToProperties(match.properties)) {
+            ids.push_back(prop->id);
+        }
+        ingredientNames.push_back(names);
+        propertyIds.push_back(ids);
+        bonuses.push_back(formatNumber(match.entry->baseValueBonus, format));
+        addictiveness.push_back(formatNumber(match.entry->addictiveness, format));
+        multipliers.push_back(formatNumber(match.entry->valueMultiplier, format));
+    }
+
+    auto join = [](const std::vector<std::string>& parts, const std::string& separator) {
+        std::string out;
+        for (size_t i = 0; i < parts.size(); i++) {
+            out += (i ? separator : "") + parts[i];
+        }
+        return out;
+    };
+
+    if (format == BatchFormat::Csv) {
+        for (size_t i = 0; i < result.paths.size(); i++) {
+            sequences.push_back(join(ingredientNames[i], ">"));
+            propertyLists.push_back(join(propertyIds[i], "+"));
+        }
+        return csvField(line) + "," + std::to_string(result.matchingKeys) + "," + std::to_string(result.totalPaths) + "," +
+            csvField(join(sequences, ";")) + "," + csvField(join(propertyLists, ";")) + "," +
+            csvField(join(bonuses, ";")) + "," + csvField(join(addictiveness, ";")) + "," +
+            csvField(join(multipliers, ";")) + "," + csvField(join(query.warnings, ";")) + "," +
+            (query.hasCriteria ? "" : csvField(BATCH_NO_CRITERIA_ERROR));
+    }
+
+    auto jsonArray = [&](const std::vector<std::string>& values) {
+        std::vector<std::string> quoted;
+        for (const auto& value : values) {
+            quoted.push_back(jsonString(value));
+        }
+        return "[" + join(quoted, ",") + "]";
+    };
+
+    std::string out = "{\"query\":" + jsonString(line);
+    if (!query.hasCriteria) {
+        out += ",\"error\":" + jsonString(BATCH_NO_CRITERIA_ERROR);
+    }
+    out += ",\"matchingKeys\":" + std::to_string(result.matchingKeys) +
+        ",\"totalPaths\":" + std::to_string(result.totalPaths) + ",\"paths\":[";
+    for (size_t i = 0; i < result.paths.size(); i++) {
+        out += std::string(i ? "," : "") + "{\"ingredients\":" + jsonArray(ingredientNames[i]) +
+            ",\"properties\":" + jsonArray(propertyIds[i]) +
+            ",\"baseValueBonus\":" + bonuses[i] +
+            ",\"addictiveness\":" + addictiveness[i] +
+            ",\"valueMultiplier\":" + multipliers[i] + "}";
+    }
+    out += "]";
+    if (!query.warnings.empty()) {
+        out += ",\"warnings\":" + jsonArray(query.warnings);
+    }
+    return out + "}";
+}
+
+// Answer every query line (same syntax as the interactive prompt; blank lines and
+// '#' comments are skipped), writing one line per query in input order. Lines are
+// read in chunks and each chunk is answered on numThreads threads.
+size_t runBatchQueries(const IndexedPathTable& table, std::istream& in, std::ostream& out,
+    BatchFormat format, size_t limit, int numThreads) {
+    const size_t CHUNK_SIZE = 4096;
+    size_t answered = 0;
+
+    if (format == BatchFormat::Csv) {
+        out << "query,matching_keys,total_paths,sequences,properties,base_value_bonus,addictiveness,value_multiplier,warnings,error\n";
+    }
+
+    std::vector<std::string> lines;
+    std::vector<std::string> results;
+    std::string line;
+    bool more = true;
+    while (more) {
+        lines.clear();
+        while (lines.size() < CHUNK_SIZE && (more = static_cast<bool>(std::getline(in, line)))) {
+            line.erase(line.find_last_not_of(" \t\r") + 1);
+            if (!line.empty() && line[0] != '#') {
+                lines.push_back(line);
             }
         }
-        std::cout << std::endl;
 
-        std::cout << "Base Value Bonus: " << entry.baseValueBonus << std::endl;
-        std::cout << "Addictiveness: " << entry.addictiveness << std::endl;
-        std::cout << "Value Multiplier: " << entry.valueMultiplier << std::endl;
+        results.assign(lines.size(), std::string());
+        parallelFor(lines.size(), static_cast<size_t>(std::max(numThreads, 1)), [&](size_t i) {
+            ParsedQuery query = parseQueryTerms(splitQueryTerms(lines[i]));
+            PathQueryResult result;
+            if (query.hasCriteria) {
+                result = table.query(query.filter, limit);
+            }
+            results[i] = formatBatchResult(lines[i], query, result, format);
+        });
 
-        shown++;
+        for (const auto& result : results) {
+            out << result << '\n';
+        }
+        answered += lines.size();
     }
+
+    out.flush();
+    return answered;
 }
 
 // Free allocated memory
@@ -1007,12 +1464,125 @@ void cleanup() {
 
 // =================== MAIN FUNCTION ===================
 
-int main() {
+int main(int argc, char* argv[]) {
+    // --trie stores the final table's sequences as a prefix trie
+    // --memory-budget <MB> spills generation results to disk beyond that much RAM
+    // --answers <k> precomputes the best paths of every query of up to k properties
+    // --batch <file|-> answers one query per line against an existing table and exits;
+    //   --product, --format jsonl|csv, --output, --limit and --threads go with it
+    bool useTrie = false;
+    std::string batchInput;
+    std::string batchOutput;
+    std::string batchProduct;
+    BatchFormat batchFormat = BatchFormat::JsonLines;
+    size_t batchLimit = 5;
+    int batchThreads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--trie") {
+            useTrie = true;
+        }
+        else if (arg == "--batch" && i + 1 < argc) {
+            batchInput = argv[++i];
+        }
+        else if (arg == "--output" && i + 1 < argc) {
+            batchOutput = argv[++i];
+        }
+        else if (arg == "--product" && i + 1 < argc) {
+            batchProduct = argv[++i];
+        }
+        else if (arg == "--format" && i + 1 < argc) {
+            std::string format = argv[++i];
+            if (format == "jsonl" || format == "json") {
+                batchFormat = BatchFormat::JsonLines;
+            }
+            else if (format == "csv") {
+                batchFormat = BatchFormat::Csv;
+            }
+            else {
+                std::cerr << "Unknown format: " << format << " (expected jsonl or csv)" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--limit" && i + 1 < argc) {
+            batchLimit = static_cast<size_t>(std::max(1, std::atoi(argv[++i])));
+        }
+        else if (arg == "--threads" && i + 1 < argc) {
+            batchThreads = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (arg == "--memory-budget" && i + 1 < argc) {
+            char* end = nullptr;
+            unsigned long long megabytes = std::strtoull(argv[++i], &end, 10);
+            if (*end != '\0' || megabytes == 0) {
+                std::cerr << "Invalid memory budget: " << argv[i] << std::endl;
+                return 1;
+            }
+            memoryBudgetBytes = static_cast<size_t>(megabytes) * 1024 * 1024;
+        }
+        else if (arg == "--answers" && i + 1 < argc) {
+            int terms = std::atoi(argv[++i]);
+            if (terms < 1 || terms > static_cast<int>(PathAnswerCache::MAX_TERMS)) {
+                std::cerr << "Invalid answer cache size: " << argv[i] << " (1-" << PathAnswerCache::MAX_TERMS << ")" << std::endl;
+                return 1;
+            }
+            answerCacheTerms = static_cast<uint32_t>(terms);
+        }
+        else {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            return 1;
+        }
+    }
+
     // Initialize the property system
     initializeGameSystem();
     initializeProducts();
     initializeBitMappings();
 
+    if (!batchInput.empty()) {
+        // Batch mode keeps stdout for results, so progress goes to stderr
+        std::string filename = "paths_" + (batchProduct.empty() ? "none" : batchProduct) + ".dat";
+        IndexedPathTable pathTable;
+        if (!loadBinaryPathTable(pathTable.table, filename, std::cerr)) {
+            std::cerr << "Error: Could not load " << filename << " (generate it first)" << std::endl;
+            cleanup();
+            return 1;
+        }
+        pathTable.rebuildIndex();
+        prepareAnswerCache(pathTable, filename, std::cerr);
+        setQueryProduct(batchProduct);
+
+        std::ifstream inputFile;
+        if (batchInput != "-") {
+            inputFile.open(batchInput);
+            if (!inputFile) {
+                std::cerr << "Error: Could not open " << batchInput << std::endl;
+                cleanup();
+                return 1;
+            }
+        }
+        std::ofstream outputFile;
+        if (!batchOutput.empty()) {
+            outputFile.open(batchOutput, std::ios::trunc);
+            if (!outputFile) {
+                std::cerr << "Error: Could not create " << batchOutput << std::endl;
+                cleanup();
+                return 1;
+            }
+        }
+
+        auto startTime = std::chrono::high_resolution_clock::now();
+        size_t answered = runBatchQueries(pathTable,
+            batchInput == "-" ? std::cin : static_cast<std::istream&>(inputFile),
+            batchOutput.empty() ? std::cout : static_cast<std::ostream&>(outputFile),
+            batchFormat, batchLimit, batchThreads);
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::high_resolution_clock::now() - startTime).count();
+        std::cerr << "Answered " << answered << " queries in " << elapsed << " ms" << std::endl;
+
+        cleanup();
+        return 0;
+    }
+
     std::cout << "===== Schedule I Property Path Generator (Optimized) =====" << std::endl;
 
     // Ask user which product to start with
@@ -1024,10 +1594,11 @@ int main() {
     std::string productName = "";  // Empty for no starting product
     std::cout << "\nEnter starting product (or press Enter for none): ";
     std::getline(std::cin, productName);
+    setQueryProduct(productName);
 
     // Check if path table already exists for this product
     std::string filename = "paths_" + (productName.empty() ? "none" : productName) + ".dat";
-    PropertyPathTable pathTable;
+    IndexedPathTable pathTable;
 
     std::ifstream testFile(filename);
     if (testFile.good()) {
@@ -1039,7 +1610,7 @@ int main() {
         std::cin.ignore();  // Clear newline
 
         if (response == 'y' || response == 'Y') {
-            pathTable = loadBinaryPathTable(filename);
+            loadBinaryPathTable(pathTable.table, filename);
         }
         else {
             // Generate new table
@@ -1054,8 +1625,19 @@ int main() {
 
             std::cin.ignore(); // Clear newline
 
-            pathTable = findAllPaths(maxIngredientCount, threads, productName);
-            saveBinaryPathTable(pathTable, filename);
+            PropertyPathTable generated;
+            if (!generatePathTable(maxIngredientCount, threads, productName, generated)) {
+                std::cerr << "Error: Generation failed; run again to resume from the last checkpoint" << std::endl;
+                cleanup();
+                return 1;
+            }
+            if (useTrie) {
+                saveTrieTable(generated, filename, productName, maxIngredientCount);
+            }
+            else {
+                saveBinaryPathTable(generated, filename, productName, maxIngredientCount);
+            }
+            pathTable.table.adopt(std::move(generated));
         }
     }
     else {
@@ -1071,15 +1653,31 @@ int main() {
 
         std::cin.ignore(); // Clear newline
 
-        pathTable = findAllPaths(maxIngredientCount, threads, productName);
-        saveBinaryPathTable(pathTable, filename);
+        PropertyPathTable generated;
+        if (!generatePathTable(maxIngredientCount, threads, productName, generated)) {
+            std::cerr << "Error: Generation failed; run again to resume from the last checkpoint" << std::endl;
+            cleanup();
+            return 1;
+        }
+        if (useTrie) {
+            saveTrieTable(generated, filename, productName, maxIngredientCount);
+        }
+        else {
+            saveBinaryPathTable(generated, filename, productName, maxIngredientCount);
+        }
+        pathTable.table.adopt(std::move(generated));
     }
 
+    pathTable.rebuildIndex();
+    prepareAnswerCache(pathTable, filename);
+
     // Property search interface
     while (true) {
         std::cout << "\n=== Property Path Finder ===" << std::endl;
         std::cout << "Enter property IDs to search for (comma-separated), or 'quit' to exit:" << std::endl;
         std::cout << "Example: energizing,foggy,spicy" << std::endl;
+        std::cout << "Prefix an ID with '-' to exclude it or '!' to never pass through it; props=N[-M]," << std::endl;
+        std::cout << "addict=MIN[-MAX] and bonus=MIN[-MAX] filter further (MIN or MIN- alone: no upper limit)" << std::endl;
 
         std::string input;
         std::getline(std::cin, input);
@@ -1089,19 +1687,7 @@ int main() {
         }
 
         // Split input by commas
-        std::vector<std::string> propertyIds;
-        std::stringstream ss(input);
-        std::string id;
-
-        while (std::getline(ss, id, ',')) {
-            // Trim whitespace
-            id.erase(0, id.find_first_not_of(" \t"));
-            id.erase(id.find_last_not_of(" \t") + 1);
-
-            if (!id.empty()) {
-                propertyIds.push_back(id);
-            }
-        }
+        std::vector<std::string> propertyIds = splitQueryTerms(input);
 
         if (propertyIds.empty()) {
             std::cout << "No properties specified." << std::endl;
@@ -14,7 +14,20 @@
 #include <fstream>
 #include <mutex>
 #include <future>
+#include <memory>
+#include <tuple>
+#include <thread>
+#include <condition_variable>
+#include <chrono>
+#include <deque>
 #include "../Schedule I Mixer Sim/property_mixer_core.h"
+#include "../Schedule I Mixer Sim/path_table.h"
+#include "../Schedule I Mixer Sim/path_table_file.h"
+#include "../Schedule I Mixer Sim/mapped_path_table.h"
+#include "../Schedule I Mixer Sim/path_query_index.h"
+#include "../Schedule I Mixer Sim/path_table_cache.h"
+#include "../Schedule I Mixer Sim/mix_session.h"
+#include "../Schedule I Mixer Sim/path_step_mixer.h"
 
 // PropertyTransition struct for animations
 struct PropertyTransition {
@@ -34,16 +47,20 @@ struct Button {
     std::string id;
     bool isHovered;
     bool isActive;
+    bool isExcluded;
     sf::Color defaultColor;
     sf::Color hoverColor;
     sf::Color activeColor;
+    sf::Color excludedColor;
 
     Button() :
         isHovered(false),
         isActive(false),
+        isExcluded(false),
         defaultColor(sf::Color(60, 60, 80)),
         hoverColor(sf::Color(80, 80, 120)),
-        activeColor(sf::Color(100, 180, 100)) {}
+        activeColor(sf::Color(100, 180, 100)),
+        excludedColor(sf::Color(170, 60, 60)) {}
 
     bool contains(const sf::Vector2f& point) const {
         return shape.getGlobalBounds().contains(point);
@@ -53,6 +70,9 @@ struct Button {
         if (isActive) {
             shape.setFillColor(activeColor);
         }
+        else if (isExcluded) {
+            shape.setFillColor(excludedColor);
+        }
         else if (isHovered) {
             shape.setFillColor(hoverColor);
         }
@@ -62,10 +82,699 @@ struct Button {
     }
 };
 
-// Structure for a property on the product
-struct ProductProperty {
-    Property* property;
-    std::vector<std::string> ingredients;
+// Summed stats of a property set
+struct PreviewStats {
+    float addictiveness = 0.0f;
+    float baseValue = 0.0f;
+    float multiplier = 1.0f;
+    int valueChange = 0;
+
+    static PreviewStats of(const std::vector<Property*>& props) {
+        PreviewStats stats;
+        for (auto* prop : props) {
+            stats.addictiveness += prop->addictiveness;
+            stats.baseValue += prop->addBaseValueMultiple;
+            stats.multiplier *= prop->valueMultiplier;
+            stats.valueChange += prop->valueChange;
+        }
+        return stats;
+    }
+
+    // Final value over the product's base value, leaving out the flat value change
+    float valueMultiple() const {
+        return (1.0f + baseValue) * multiplier;
+    }
+};
+
+// How one current property moves in the previewed mix (map coordinates)
+struct PreviewMove {
+    Property* property = nullptr;
+    Vector2 from;
+    Vector2 to;
+    bool willTransform = false;     // Not part of the result
+    Property* target = nullptr;     // Property at the end point, if any
+};
+
+// Everything the mix preview draws, computed once per previewed ingredient
+struct PreviewModel {
+    std::vector<Property*> resultProps;
+    std::vector<bool> resultIsNew;
+    std::vector<MixerMapEffect*> newEffects;    // Map spots of the new properties
+    std::vector<PreviewMove> moves;
+    PreviewStats current;
+    PreviewStats result;
+};
+
+// UI labels kept between frames. A fresh sf::Text makes SFML lay its glyphs out again
+// on every draw; a cached one only does so when its string, size or style changes.
+// Labels are looked up by key, and ones not drawn during a frame are dropped by endFrame().
+class TextCache {
+public:
+    void setFont(const sf::Font& newFont) {
+        font = &newFont;
+    }
+
+    // The label for key, showing string at the given size and style
+    sf::Text& get(const std::string& key, const std::string& string, unsigned int size,
+        sf::Uint32 style = sf::Text::Regular) {
+        Entry& entry = entries[key];
+        if (!entry.text.getFont()) {
+            entry.text.setFont(*font);
+            entry.text.setString(string);
+            entry.string = string;
+        }
+        else if (entry.string != string) {
+            entry.text.setString(string);
+            entry.string = string;
+        }
+        entry.text.setCharacterSize(size);
+        entry.text.setStyle(style);
+        entry.used = true;
+        return entry.text;
+    }
+
+    void endFrame() {
+        for (auto it = entries.begin(); it != entries.end();) {
+            if (!it->second.used) {
+                it = entries.erase(it);
+            }
+            else {
+                it->second.used = false;
+                ++it;
+            }
+        }
+    }
+
+private:
+    struct Entry {
+        sf::Text text;
+        std::string string;
+        bool used = false;
+    };
+
+    const sf::Font* font = nullptr;
+    std::unordered_map<std::string, Entry> entries;
+};
+
+// Parts of a frame timed by FrameProfiler
+enum ProfilePhase {
+    PHASE_EVENTS,
+    PHASE_POLLING,          // Table loads, path searches and rankings finishing
+    PHASE_TRANSITIONS,
+    PHASE_MAP,
+    PHASE_STATS_PANEL,
+    PHASE_INGREDIENTS_PANEL,
+    PHASE_LOOKAHEAD_PANEL,
+    PHASE_PRODUCTS_PANEL,
+    PHASE_PROPERTY_PANEL,
+    PHASE_PATH_PANEL,
+    PHASE_BUTTONS,
+    PHASE_PREVIEW,
+    PHASE_OVERLAYS,         // Help, tooltip, loading indicator and this profiler
+    PHASE_DISPLAY,
+    PHASE_COUNT
+};
+
+static const char* const PROFILE_PHASE_NAMES[PHASE_COUNT] = {
+    "events", "polling", "transitions", "map", "stats panel", "ingredients panel",
+    "lookahead panel", "products panel", "property panel", "path panel", "buttons",
+    "preview", "overlays", "display"
+};
+
+// CPU time per phase of every presented frame, and how long input waited to be seen.
+// Latency runs from when an event is taken from the queue (SFML keeps no OS
+// timestamps) to the end of the display() that first shows its effect.
+class FrameProfiler {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Frame {
+        uint64_t index = 0;
+        double startMs = 0.0;               // Since the profiler was created
+        float phaseMs[PHASE_COUNT] = {};
+        float totalMs = 0.0f;
+        float latencyMs = -1.0f;            // -1: no input shown in this frame
+    };
+
+    static constexpr size_t WINDOW = 240;               // Frames the overlay looks at
+    static constexpr size_t MAX_FRAMES = 500000;        // Oldest frames dropped beyond this
+
+    // Times a phase until it goes out of scope
+    class Scope {
+    public:
+        Scope(FrameProfiler& profiler, ProfilePhase phase) : profiler(profiler), phase(phase), start(Clock::now()) {}
+        ~Scope() { profiler.current.phaseMs[phase] += millisecondsSince(start); }
+    private:
+        FrameProfiler& profiler;
+        ProfilePhase phase;
+        Clock::time_point start;
+    };
+
+    FrameProfiler() : created(Clock::now()) {}
+
+    void beginFrame() {
+        current = Frame();
+        current.index = nextIndex;
+        frameStart = Clock::now();
+        current.startMs = std::chrono::duration<double, std::milli>(frameStart - created).count();
+    }
+
+    // Input that changed something; the next presented frame shows it
+    void inputArrived() {
+        if (!inputWaiting) {
+            inputWaiting = true;
+            inputTime = Clock::now();
+        }
+    }
+
+    // Call once the frame is presented
+    void endFrame() {
+        current.totalMs = millisecondsSince(frameStart);
+        if (inputWaiting) {
+            current.latencyMs = millisecondsSince(inputTime);
+            inputWaiting = false;
+        }
+        frames.push_back(current);
+        if (frames.size() > MAX_FRAMES) {
+            frames.pop_front();
+        }
+        nextIndex++;
+    }
+
+    // The last frames, up to WINDOW of them, oldest first
+    std::vector<const Frame*> recent() const {
+        std::vector<const Frame*> window;
+        size_t first = frames.size() > WINDOW ? frames.size() - WINDOW : 0;
+        for (size_t i = first; i < frames.size(); i++) {
+            window.push_back(&frames[i]);
+        }
+        return window;
+    }
+
+    // Percentile (0-100) of frame time, or of latency, over the recent frames
+    float framePercentile(float percent) const {
+        std::vector<float> values;
+        for (const Frame* frame : recent()) {
+            values.push_back(frame->totalMs);
+        }
+        return percentile(values, percent);
+    }
+
+    float latencyPercentile(float percent) const {
+        std::vector<float> values;
+        for (const Frame* frame : recent()) {
+            if (frame->latencyMs >= 0.0f) {
+                values.push_back(frame->latencyMs);
+            }
+        }
+        return percentile(values, percent);
+    }
+
+    // Every frame kept, one CSV row each, times in milliseconds
+    bool writeCsv(const std::string& filename) const {
+        std::ofstream file(filename);
+        if (!file) {
+            std::cerr << "Error: Could not write " << filename << std::endl;
+            return false;
+        }
+
+        file << "frame,start";
+        for (const char* name : PROFILE_PHASE_NAMES) {
+            file << "," << name;
+        }
+        file << ",total,latency\n";
+
+        file << std::fixed << std::setprecision(3);
+        for (const Frame& frame : frames) {
+            file << frame.index << "," << frame.startMs;
+            for (float ms : frame.phaseMs) {
+                file << "," << ms;
+            }
+            file << "," << frame.totalMs << ",";
+            if (frame.latencyMs >= 0.0f) {
+                file << frame.latencyMs;
+            }
+            file << "\n";
+        }
+        return static_cast<bool>(file);
+    }
+
+    size_t frameCount() const {
+        return frames.size();
+    }
+
+private:
+    Clock::time_point created;
+    Clock::time_point frameStart;
+    Clock::time_point inputTime;
+    bool inputWaiting = false;
+    uint64_t nextIndex = 0;
+    Frame current;
+    std::deque<Frame> frames;
+
+    static float millisecondsSince(Clock::time_point start) {
+        return std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+    }
+
+    static float percentile(std::vector<float>& values, float percent) {
+        if (values.empty()) {
+            return 0.0f;
+        }
+        size_t rank = std::min(values.size() - 1, static_cast<size_t>(percent / 100.0f * values.size()));
+        std::nth_element(values.begin(), values.begin() + rank, values.end());
+        return values[rank];
+    }
+};
+
+// Which effect owns each point of a mixer map, rasterised once per map. The map then
+// draws as one textured quad and hit tests are a texel lookup, however many effects
+// the map has. Texel (x, y) samples the map point ((x + 0.5) / scale - radius,
+// radius - (y + 0.5) / scale), so the texture is upright on screen.
+class ReactionField {
+public:
+    bool isBuiltFor(const MixerMap* map) const {
+        return map != nullptr && map == builtFor;
+    }
+
+    // Rasterise map at scale texels per map unit, colouring effects by property tier
+    void build(const MixerMap* map, float texelsPerUnit, const std::map<int, sf::Color>& tierColors) {
+        builtFor = map;
+        scale = texelsPerUnit;
+        radius = map->mapRadius;
+        size = static_cast<int>(std::ceil(2.0f * radius * scale));
+
+        std::unordered_map<const MixerMapEffect*, int16_t> indices;
+        colors.clear();
+        for (size_t i = 0; i < map->effects.size(); i++) {
+            indices[map->effects[i]] = static_cast<int16_t>(i);
+            auto it = tierColors.find(map->effects[i]->property->tier);
+            colors.push_back(it != tierColors.end() ? it->second : sf::Color::White);
+        }
+
+        // The rule mixing uses (MixerMap::getEffectAtPoint), once per texel
+        owners.assign(size_t(size) * size, OUTSIDE);
+        for (int y = 0; y < size; y++) {
+            for (int x = 0; x < size; x++) {
+                Vector2 point((x + 0.5f) / scale - radius, radius - (y + 0.5f) / scale);
+                if (point.Magnitude() > radius) {
+                    continue;
+                }
+                MixerMapEffect* effect = map->getEffectAtPoint(point);
+                owners[size_t(y) * size + x] = effect ? indices[effect] : NONE;
+            }
+        }
+
+        shifted.clear();
+        fillTexture(base, 0, 0);
+    }
+
+    // Effect at a map point, nullptr outside the map or any effect
+    MixerMapEffect* effectAt(const Vector2& point) const {
+        if (!builtFor) {
+            return nullptr;
+        }
+        int x = static_cast<int>(std::floor((point.x + radius) * scale));
+        int y = static_cast<int>(std::floor((radius - point.y) * scale));
+        int16_t owner = ownerAt(x, y);
+        return owner >= 0 ? builtFor->effects[owner] : nullptr;
+    }
+
+    const sf::Texture& texture() const {
+        return base;
+    }
+
+    // Where each map point lands when moved by offset (an ingredient's mix vector):
+    // texel p shows the effect owning p + offset. Made once per offset, from the raster.
+    const sf::Texture& shiftedTexture(const Vector2& offset) {
+        std::pair<int, int> texels(static_cast<int>(std::lround(offset.x * scale)),
+            static_cast<int>(std::lround(-offset.y * scale)));
+        auto it = shifted.find(texels);
+        if (it == shifted.end()) {
+            it = shifted.emplace(texels, sf::Texture()).first;
+            fillTexture(it->second, texels.first, texels.second);
+        }
+        return it->second;
+    }
+
+private:
+    static constexpr int16_t OUTSIDE = -2;  // Beyond the map radius
+    static constexpr int16_t NONE = -1;     // In the map but no effect
+
+    const MixerMap* builtFor = nullptr;
+    float scale = 1.0f;
+    float radius = 0.0f;
+    int size = 0;
+    std::vector<int16_t> owners;    // Effect index per texel, row by row
+    std::vector<sf::Color> colors;  // Per effect
+    sf::Texture base;
+    std::map<std::pair<int, int>, sf::Texture> shifted;
+
+    int16_t ownerAt(int x, int y) const {
+        if (x < 0 || y < 0 || x >= size || y >= size) {
+            return OUTSIDE;
+        }
+        return owners[size_t(y) * size + x];
+    }
+
+    // Texels inside the map show the effect at (x + dx, y + dy): faint inside an
+    // effect, solid within two texels of its edge
+    void fillTexture(sf::Texture& texture, int dx, int dy) const {
+        static const int edgeOffsets[8][2] = { {1, 0}, {-1, 0}, {0, 1}, {0, -1}, {2, 0}, {-2, 0}, {0, 2}, {0, -2} };
+
+        std::vector<sf::Uint8> pixels(size_t(size) * size * 4, 0);
+        for (int y = 0; y < size; y++) {
+            for (int x = 0; x < size; x++) {
+                int16_t owner = ownerAt(x + dx, y + dy);
+                if (ownerAt(x, y) == OUTSIDE || owner < 0) {
+                    continue;
+                }
+
+                bool edge = false;
+                for (const auto& step : edgeOffsets) {
+                    if (ownerAt(x + dx + step[0], y + dy + step[1]) != owner) {
+                        edge = true;
+                        break;
+                    }
+                }
+
+                sf::Uint8* pixel = &pixels[(size_t(y) * size + x) * 4];
+                const sf::Color& color = colors[owner];
+                pixel[0] = color.r;
+                pixel[1] = color.g;
+                pixel[2] = color.b;
+                pixel[3] = edge ? 255 : 100;
+            }
+        }
+
+        texture.create(size, size);
+        texture.update(pixels.data());
+    }
+};
+
+// Runs path searches off the UI thread. Only the newest search matters: submitting one
+// replaces any search still waiting, and a finished search is only handed back if no
+// newer one was submitted meanwhile, so stale results never reach the UI.
+class PathSearchWorker {
+public:
+    struct Result {
+        uint64_t generation = 0;
+        std::shared_ptr<IndexedPathTable> table;    // Keeps the entries in result alive
+        PathQueryResult result;
+        bool final = true;      // False if a partial table could not settle the answer
+    };
+
+    PathSearchWorker() : thread([this]() { work(); }) {}
+
+    ~PathSearchWorker() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_one();
+        thread.join();
+    }
+
+    // Queue a best-path search; returns its generation
+    uint64_t submit(std::shared_ptr<IndexedPathTable> table, const PathScanFilter& filter) {
+        uint64_t generation;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            generation = ++latest;
+            pending = { generation, table, filter };
+            hasPending = true;
+            hasResult = false;
+        }
+        wake.notify_one();
+        return generation;
+    }
+
+    // Drop the waiting search and ignore the running one
+    void cancel() {
+        std::lock_guard<std::mutex> lock(mutex);
+        latest++;
+        hasPending = false;
+        hasResult = false;
+    }
+
+    // The result of the newest search, once it has finished
+    bool takeResult(Result& result) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!hasResult) {
+            return false;
+        }
+        result = std::move(finished);
+        hasResult = false;
+        return true;
+    }
+
+private:
+    struct Search {
+        uint64_t generation = 0;
+        std::shared_ptr<IndexedPathTable> table;
+        PathScanFilter filter;
+    };
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+    uint64_t latest = 0;
+    bool hasPending = false;
+    Search pending;
+    bool hasResult = false;
+    Result finished;
+    std::thread thread;     // Last, so it starts after everything above exists
+
+    void work() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            wake.wait(lock, [this]() { return stopping || hasPending; });
+            if (stopping) {
+                return;
+            }
+            Search search = std::move(pending);
+            hasPending = false;
+
+            lock.unlock();
+            // Best match: fewest ingredients, then highest bonus
+            PathQueryResult result = search.table->best(search.filter, 1);
+            bool final = search.table->isFinal(search.filter, 1, result);
+            lock.lock();
+
+            if (search.generation == latest) {
+                finished = { search.generation, search.table, std::move(result), final };
+                hasResult = true;
+            }
+        }
+    }
+};
+
+// Ranks the ingredients by the best value reachable when mixing them next, followed
+// by up to STEPS - 1 more ingredients. Runs off the UI thread and, like
+// PathSearchWorker, only hands back the newest ranking. The best continuation of
+// every property list seen is remembered across rankings, so after a mix most of the
+// next ranking is already known.
+class LookaheadWorker {
+public:
+    static constexpr int STEPS = 4;
+
+    struct Ranked {
+        size_t ingredient = 0;          // Index into the submitted ingredients
+        float value = 0.0f;             // Best value multiple reachable
+        std::vector<size_t> then;       // Ingredients after it that reach that value
+    };
+
+    struct Result {
+        uint64_t generation = 0;
+        float current = 0.0f;           // Value multiple without mixing anything
+        std::vector<Ranked> ranking;    // Best first
+    };
+
+    LookaheadWorker() : thread([this]() { work(); }) {}
+
+    ~LookaheadWorker() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_one();
+        thread.join();
+    }
+
+    // Queue a ranking of ingredients (the property each one adds) from start
+    uint64_t submit(const std::vector<Property*>& start, const std::vector<Property*>& ingredients) {
+        uint64_t generation;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            generation = ++latest;
+            pending = { generation, start, ingredients };
+            hasPending = true;
+            hasResult = false;
+        }
+        wake.notify_one();
+        return generation;
+    }
+
+    // The newest ranking, once it has finished
+    bool takeResult(Result& result) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!hasResult) {
+            return false;
+        }
+        result = std::move(finished);
+        hasResult = false;
+        return true;
+    }
+
+private:
+    struct Request {
+        uint64_t generation = 0;
+        std::vector<Property*> start;
+        std::vector<Property*> ingredients;
+    };
+
+    // Best value reachable from a property list, and the ingredient to mix next for it
+    struct Best {
+        float value = 0.0f;
+        int next = -1;      // -1: stopping here is best
+    };
+
+    // Memoised lists beyond this are dropped rather than grown further
+    static constexpr size_t MAX_MEMO_ENTRIES = 1000000;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+    uint64_t latest = 0;
+    bool hasPending = false;
+    Request pending;
+    bool hasResult = false;
+    Result finished;
+
+    // Worker thread only
+    std::vector<Property*> ingredients;
+    std::unordered_map<Property*, char> propertyCodes;
+    std::unordered_map<std::string, Best> memo[STEPS];
+
+    std::thread thread;     // Last, so it starts after everything above exists
+
+    void work() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            wake.wait(lock, [this]() { return stopping || hasPending; });
+            if (stopping) {
+                return;
+            }
+            Request request = std::move(pending);
+            hasPending = false;
+
+            lock.unlock();
+            Result result;
+            bool complete = rank(request, result);
+            lock.lock();
+
+            if (complete && request.generation == latest) {
+                finished = std::move(result);
+                hasResult = true;
+            }
+        }
+    }
+
+    bool superseded(uint64_t generation) {
+        std::lock_guard<std::mutex> lock(mutex);
+        return generation != latest || stopping;
+    }
+
+    bool rank(const Request& request, Result& result) {
+        // What is remembered is only valid for the ingredients it was found with
+        if (request.ingredients != ingredients) {
+            ingredients = request.ingredients;
+            clearMemo();
+        }
+        size_t memoEntries = 0;
+        for (const auto& steps : memo) {
+            memoEntries += steps.size();
+        }
+        if (memoEntries > MAX_MEMO_ENTRIES) {
+            clearMemo();
+        }
+
+        result.generation = request.generation;
+        result.current = PreviewStats::of(request.start).valueMultiple();
+        for (size_t i = 0; i < ingredients.size(); i++) {
+            // Give up early once a newer ranking is wanted; what was found stays memoised
+            if (superseded(request.generation)) {
+                return false;
+            }
+
+            std::vector<Property*> props = PropertyMixCalculator::mixProperties(
+                request.start, ingredients[i], DrugType::Marijuana);
+            Ranked ranked;
+            ranked.ingredient = i;
+            ranked.value = best(props, STEPS - 1).value;
+
+            // Follow the remembered choices to the list with that value
+            for (int steps = STEPS - 1; steps > 0; steps--) {
+                int next = memo[steps][listKey(props)].next;
+                if (next < 0) {
+                    break;
+                }
+                ranked.then.push_back(static_cast<size_t>(next));
+                props = PropertyMixCalculator::mixProperties(props, ingredients[next], DrugType::Marijuana);
+            }
+            result.ranking.push_back(std::move(ranked));
+        }
+
+        // Highest value first, then the shorter way there
+        std::stable_sort(result.ranking.begin(), result.ranking.end(),
+            [](const Ranked& a, const Ranked& b) {
+                if (a.value != b.value) {
+                    return a.value > b.value;
+                }
+                return a.then.size() < b.then.size();
+            });
+        return true;
+    }
+
+    Best best(const std::vector<Property*>& props, int steps) {
+        std::string key = listKey(props);
+        auto found = memo[steps].find(key);
+        if (found != memo[steps].end()) {
+            return found->second;
+        }
+
+        Best result;
+        result.value = PreviewStats::of(props).valueMultiple();
+        if (steps > 0) {
+            for (size_t j = 0; j < ingredients.size(); j++) {
+                std::vector<Property*> mixed = PropertyMixCalculator::mixProperties(
+                    props, ingredients[j], DrugType::Marijuana);
+                float value = best(mixed, steps - 1).value;
+                if (value > result.value) {
+                    result.value = value;
+                    result.next = static_cast<int>(j);
+                }
+            }
+        }
+        memo[steps][key] = result;
+        return result;
+    }
+
+    // Properties in order, one code each, handed out in the order properties are first
+    // seen. Mixing depends on the order, so the same set in another order is another key.
+    std::string listKey(const std::vector<Property*>& props) {
+        std::string key;
+        key.reserve(props.size());
+        for (auto* prop : props) {
+            key += propertyCodes.emplace(prop, static_cast<char>(propertyCodes.size())).first->second;
+        }
+        return key;
+    }
+
+    void clearMemo() {
+        for (auto& steps : memo) {
+            steps.clear();
+        }
+    }
 };
 
 class VisualPropertyMixer {
@@ -78,20 +787,24 @@ public:
         , showMixingLines(true)
         , showTooltips(true)
         , mode(Mode::Normal)
-        , previewNewProperty(nullptr)
-        , selectedIngredientIndex(-1)
         , windowWidth(1600)     // Increased window size
         , windowHeight(900)     // Increased window size
     {}
 
     ~VisualPropertyMixer() {
+        // Loader threads use the mappings and the table cache
+        if (tableLoadFuture.valid()) {
+            tableLoadFuture.wait();
+        }
+        if (prefetchFuture.valid()) {
+            prefetchFuture.wait();
+        }
         if (window) {
             window->close();
             delete window;
         }
     }
     std::vector<Button> productButtons;
-    std::string selectedProduct;
     int hoveredIngredientIndex = -1;
 
     enum class Mode {
@@ -114,44 +827,47 @@ public:
         panel.setPosition(panelX, panelY);
         window->draw(panel);
 
+        // Reading first, then indexing; each is half of the bar
+        const PathTableLoadProgress& progress = *tableLoadProgress;
+        uint64_t bytesRead = progress.bytesRead, bytesTotal = progress.bytesTotal;
+        uint64_t rowsIndexed = progress.rowsIndexed, rowsTotal = progress.rowsTotal;
+        float fraction = 0.0f;
+        std::stringstream status;
+        status << std::fixed << std::setprecision(1);
+        if (rowsTotal == 0) {
+            status << "Reading " << loadingTableProduct << ": " << bytesRead / 1048576.0 << " / "
+                << bytesTotal / 1048576.0 << " MB";
+            fraction = bytesTotal ? 0.5f * bytesRead / bytesTotal : 0.0f;
+        }
+        else {
+            status << "Indexing " << loadingTableProduct << ": " << rowsIndexed << " / " << rowsTotal << " rows";
+            fraction = 0.5f + 0.5f * rowsIndexed / rowsTotal;
+        }
+
         // Create loading text
-        sf::Text loadingText;
-        loadingText.setFont(font);
-        loadingText.setString("Loading data for " + loadingTableProduct + "...");
-        loadingText.setCharacterSize(16);
+        sf::Text& loadingText = texts.get("loading", status.str(), 14);
         loadingText.setFillColor(sf::Color::White);
 
         // Center the text in the panel
         sf::FloatRect textBounds = loadingText.getLocalBounds();
         loadingText.setPosition(
             panelX + (panelWidth - textBounds.width) / 2.0f,
-            panelY + (panelHeight - textBounds.height) / 2.0f - 5.0f
+            panelY + 4.0f
         );
 
         window->draw(loadingText);
 
-        // Add a small animated indicator (three dots that pulse)
-        float dotRadius = 4.0f;
-        float dotSpacing = 12.0f;
-        float dotsWidth = 3 * dotRadius * 2 + 2 * dotSpacing;
-        float dotsX = panelX + (panelWidth - dotsWidth) / 2.0f;
-        float dotsY = panelY + panelHeight - 12.0f;
-
-        // Use system time to animate
-        float currentTime = static_cast<float>(clock.getElapsedTime().asSeconds() * 3);
-
-        for (int i = 0; i < 3; i++) {
-            float pulse = 0.7f + 0.3f * std::sin(currentTime - i * 0.5f);
-
-            sf::CircleShape dot(dotRadius * pulse);
-            dot.setFillColor(sf::Color(200, 200, 255, 200 + 55 * pulse));
-            dot.setPosition(
-                dotsX + i * (dotRadius * 2 + dotSpacing) - dotRadius * pulse,
-                dotsY - dotRadius * pulse
-            );
-
-            window->draw(dot);
-        }
+        // Progress bar along the bottom of the panel
+        float barWidth = panelWidth - 20.0f;
+        sf::RectangleShape barBg(sf::Vector2f(barWidth, 6.0f));
+        barBg.setFillColor(sf::Color(60, 60, 80));
+        barBg.setPosition(panelX + 10.0f, panelY + panelHeight - 12.0f);
+        window->draw(barBg);
+
+        sf::RectangleShape barFill(sf::Vector2f(barWidth * std::min(fraction, 1.0f), 6.0f));
+        barFill.setFillColor(sf::Color(200, 200, 255, 220));
+        barFill.setPosition(panelX + 10.0f, panelY + panelHeight - 12.0f);
+        window->draw(barFill);
     }
 
 
@@ -175,7 +891,7 @@ public:
         const float scaleFactor = 80.0f; // Same scale as used elsewhere
 
         // Draw the mix direction as a vector for each active property
-        for (const auto& propWithOrigin : currentProperties) {
+        for (const auto& propWithOrigin : session.properties()) {
             Property* currentProp = propWithOrigin.property;
             MixerMapEffect* effect = mixerMap->getEffect(currentProp);
 
@@ -217,7 +933,7 @@ public:
                 window->draw(arrowHead, 4, sf::Lines);
 
                 // Find what property, if any, would be at the end position
-                MixerMapEffect* resultEffect = mixerMap->getEffectAtPoint(endVector);
+                MixerMapEffect* resultEffect = reactionField.effectAt(endVector);
                 if (resultEffect) {
                     // Draw a small circle to indicate the target property
                     sf::CircleShape targetCircle(5.0f);
@@ -226,10 +942,8 @@ public:
                     window->draw(targetCircle);
 
                     // Draw a small label with the target property name
-                    sf::Text targetLabel;
-                    targetLabel.setFont(font);
-                    targetLabel.setString(resultEffect->property->name);
-                    targetLabel.setCharacterSize(12);
+                    sf::Text& targetLabel = texts.get("mix.target." + resultEffect->property->id,
+                        resultEffect->property->name, 12);
                     targetLabel.setFillColor(sf::Color::White);
                     targetLabel.setOutlineColor(sf::Color::Black);
                     targetLabel.setOutlineThickness(1.0f);
@@ -240,10 +954,7 @@ public:
         }
 
         // Draw a note about the preview
-        sf::Text previewNote;
-        previewNote.setFont(font);
-        previewNote.setString("Preview: " + ingredientId + " effect on properties");
-        previewNote.setCharacterSize(14);
+        sf::Text& previewNote = texts.get("mix.preview", "Preview: " + ingredientId + " effect on properties", 14);
         previewNote.setFillColor(sf::Color::Yellow);
         previewNote.setOutlineColor(sf::Color::Black);
         previewNote.setOutlineThickness(1.0f);
@@ -303,33 +1014,21 @@ public:
     }
     // Method to handle product button click
     void handleProductButtonClick(const std::string& productName) {
-        // Clear current properties
-        currentProperties.clear();
-        ingredientHistory.clear();
+        // Start over from the product's own properties
+        cancelPreview();
+        session.selectProduct(productName);
         activeTransitions.clear();
+        showSelectedProduct();
+        refreshLookahead();
+    }
 
-        selectedProduct = productName;
-
-        // Set the starting properties for this product
-        auto productIt = products.find(productName);
-        if (productIt != products.end()) {
-            DrugProduct* product = productIt->second;
-
-            // Add each property to currentProperties
-            for (Property* prop : product->properties) {
-                ProductProperty propWithOrigin;
-                propWithOrigin.property = prop;
-                propWithOrigin.ingredients.push_back(productName); // The product is the source
-                currentProperties.push_back(propWithOrigin);
-            }
-        }
-
-        // Start loading the path table in background
-        loadPathTableAsync(productName);
+    // Switch to the session's product path table, loading it in the background unless
+    // cached, and highlight its button
+    void showSelectedProduct() {
+        selectPathTable(session.product());
 
-        // Highlight the selected product button
         for (auto& button : productButtons) {
-            button.isActive = (button.id == productName);
+            button.isActive = (button.id == session.product());
             button.updateColor();
         }
     }
@@ -357,6 +1056,8 @@ public:
                 }
             }
 
+            texts.setFont(font);
+
             // Initialize product manager and get mixer map
             ProductManager& productManager = ProductManager::getInstance();
             mixerMap = productManager.getMixerMap(DrugType::Marijuana);
@@ -369,10 +1070,11 @@ public:
 
             // Load path table
             std::string pathFile = "paths_none.dat"; // Use a default file
-            loadPathTableAsync("none");
+            selectPathTable("none");
 
-            // Create ingredient buttons
+            // Create ingredient buttons, and rank them for an empty mix
             createIngredientButtons();
+            refreshLookahead();
 
             // Create action buttons
             createActionButtons();
@@ -395,33 +1097,46 @@ public:
         }
 
         while (window->isOpen()) {
-            // Update time
-            float deltaTime = clock.restart().asSeconds();
-
-            // Handle events
-            handleEvents();
-
-
-            // Check if async table loading has completed
-            if (isLoadingTable && tableLoadFuture.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
-                // Get the loaded table
-                {
-                    std::lock_guard<std::mutex> lock(tableMutex);
-                    pathTable = tableLoadFuture.get();
+            // Handle events. With nothing changed and nothing moving, sleep until input
+            // arrives instead of drawing identical frames.
+            bool idle = !needsRedraw && !isAnimating();
+            sf::Event first;
+            // Time asleep is not part of the frame, handling what woke us is
+            bool woken = idle && waitForEvent(first, sf::milliseconds(IDLE_WAIT_MS));
+            profiler.beginFrame();
+            {
+                FrameProfiler::Scope timing(profiler, PHASE_EVENTS);
+                if (woken && handleEvent(first)) {
+                    profiler.inputArrived();
+                    needsRedraw = true;
                 }
-
-                // Reset loading state
-                isLoadingTable = false;
-
-                // Find paths if we have desired properties
-                if (!desiredProperties.empty()) {
-                    findPathForProperties();
+                if (handleEvents()) {
+                    needsRedraw = true;
                 }
             }
 
+            // Update time; time spent asleep does not advance animations
+            float deltaTime = clock.restart().asSeconds();
+            if (idle) {
+                deltaTime = 0.0f;
+            }
+
+            // Pick up work finished in the background
+            {
+                FrameProfiler::Scope timing(profiler, PHASE_POLLING);
+                pollBackgroundWork();
+            }
 
             // Update transitions
-            updateTransitions(deltaTime);
+            {
+                FrameProfiler::Scope timing(profiler, PHASE_TRANSITIONS);
+                updateTransitions(deltaTime);
+            }
+
+            if (!needsRedraw && !isAnimating()) {
+                continue;
+            }
+            needsRedraw = false;
 
             // Clear the window with a darker background for better contrast
             window->clear(sf::Color(20, 20, 30));
@@ -430,39 +1145,86 @@ public:
             drawInterface();
 
 
-            // Draw loading indicator if loading
-            if (isLoadingTable) {
-                drawLoadingIndicator();
+            // Draw loading indicator if loading, and the frame timings if shown
+            {
+                FrameProfiler::Scope timing(profiler, PHASE_OVERLAYS);
+                if (isLoadingTable && loadingTableFile == selectedTableFile) {
+                    drawLoadingIndicator();
+                }
+                if (showProfiler) {
+                    drawProfilerOverlay();
+                }
             }
 
             // Display the window
-            window->display();
+            {
+                FrameProfiler::Scope timing(profiler, PHASE_DISPLAY);
+                window->display();
+            }
+            profiler.endFrame();
+            texts.endFrame();
         }
     }
 
-    // Add these to the VisualPropertyMixer class
+    // Finished table loads, partial tables, path searches and rankings
+    void pollBackgroundWork() {
+        // Check if async table loading has completed
+        if (isLoadingTable && tableLoadFuture.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+            // Get the loaded table, unless another one was selected meanwhile
+            std::shared_ptr<IndexedPathTable> loaded = tableLoadFuture.get();
+            bool wanted = loadingTableFile == selectedTableFile;
+            if (wanted) {
+                std::lock_guard<std::mutex> lock(tableMutex);
+                pathTable = loaded;
+            }
 
-// Compact representation of ingredients and properties (matching the path generator)
-    using IngredientSet = uint16_t;
-    using PropertySet = uint64_t;
+            // Reset loading state
+            isLoadingTable = false;
+            needsRedraw = true;
+            {
+                std::lock_guard<std::mutex> lock(partialTableMutex);
+                partialTable.reset();
+            }
 
-    // Compact path entry structure
-    struct CompactPathEntry {
-        std::vector<uint8_t> ingredientSequence;  // Sequence of ingredient indices
-        float baseValueBonus;
-        float addictiveness;
-        float valueMultiplier;
+            // Find paths if we have desired properties
+            if (wanted && !desiredProperties.empty()) {
+                findPathForProperties();
+            }
+            prefetchNextTable();
+        }
 
-        // Constructor for convenience
-        CompactPathEntry() : baseValueBonus(0), addictiveness(0), valueMultiplier(1.0f) {}
-    };
+        // Pick up a partial table, then a finished path search
+        if (isLoadingTable) {
+            pollPartialTable();
+        }
+        pollPathSearch();
+        pollLookahead();
+    }
+
+    // Add these to the VisualPropertyMixer class
+
+// Compact representation of ingredients (path tables come from path_table.h, shared with the path generator)
+    using IngredientSet = uint16_t;
 
-    // Main lookup table: property bitset -> paths
-    using PropertyPathTable = std::unordered_map<PropertySet, std::vector<CompactPathEntry>>;
     bool isLoadingTable = false;
     std::string loadingTableProduct;
+    std::string loadingTableFile;
     std::mutex tableMutex;
-    std::future<PropertyPathTable> tableLoadFuture;
+    std::future<std::shared_ptr<IndexedPathTable>> tableLoadFuture;
+    std::shared_ptr<PathTableLoadProgress> tableLoadProgress = std::make_shared<PathTableLoadProgress>();
+
+    // Latest partial table published by the running load
+    std::mutex partialTableMutex;
+    std::shared_ptr<IndexedPathTable> partialTable;
+    std::string partialTableFile;
+
+    // Tables loaded earlier, so switching back to a product is instant. Only heap
+    // memory counts against the budget; mapped files live in the page cache.
+    static constexpr size_t TABLE_CACHE_BYTES = size_t(1) << 30;
+    PathTableCache tableCache{ TABLE_CACHE_BYTES };
+    std::string selectedTableFile;      // File of the table the UI wants
+    std::mutex tableLoadMutex;          // One load or prefetch at a time
+    std::future<void> prefetchFuture;
 
     // Mapping tables for bit conversion
     std::unordered_map<std::string, uint16_t> ingredientBitMapping;
@@ -470,14 +1232,24 @@ public:
     std::vector<std::string> ingredientByBitPosition;
     std::vector<std::string> propertyByBitPosition;
 
-    // Path lookup table
-    PropertyPathTable pathTable;
+    // Path lookup table (mapped from disk when possible) and its query index
+    std::shared_ptr<IndexedPathTable> pathTable = std::make_shared<IndexedPathTable>();
 
     // Currently selected desired properties
     std::vector<Property*> desiredProperties;
 
-    // Currently suggested path
+    // Properties the suggested path must never show, at any step (right click)
+    std::vector<Property*> avoidedProperties;
+
+    // Currently suggested path, and the search that will replace it
     std::vector<std::string> suggestedPath;
+    PathSearchWorker pathSearch;
+    bool pathSearchPending = false;
+
+    // Ingredients ranked by what they lead to, and the ranking that will replace it
+    LookaheadWorker lookahead;
+    bool lookaheadPending = false;
+    LookaheadWorker::Result lookaheadRanking;
 
     // UI elements for property selection
     std::vector<Button> propertyButtons;
@@ -502,14 +1274,8 @@ public:
         }
     }
 
-    void loadPathTableAsync(const std::string& productName) {
-        // Set loading state
-        isLoadingTable = true;
-        loadingTableProduct = productName;
-
-        // Start async task
-        tableLoadFuture = std::async(std::launch::async, [this, productName]() {
-            PropertyPathTable result;
+    // Table file for a product, falling back to the general table
+    std::string pathTableFileFor(const std::string& productName) const {
         std::string pathFile;
 
         if (productName.empty()) {
@@ -521,73 +1287,163 @@ public:
 
         // Try to load the specified file
         std::ifstream testFile(pathFile);
-        if (testFile.good()) {
-            testFile.close();
-            result = this->loadBinaryPathTable(pathFile);
-        }
-        else {
+        if (!testFile.good()) {
             // If product-specific file doesn't exist, fall back to general table
             std::cout << "No specific path table found for " << productName << ". Using default." << std::endl;
-            result = this->loadBinaryPathTable("paths_none.dat");
+            pathFile = "paths_none.dat";
         }
-
-        return result;
-            });
+        return pathFile;
     }
 
-    // Load path table from binary format
-    PropertyPathTable loadBinaryPathTable(const std::string& filename) {
-        // No global state modifications here to ensure thread safety
-        PropertyPathTable table;
-        std::ifstream file(filename, std::ios::binary);
+    // Use the product's table straight away if it is cached and unchanged on disk,
+    // otherwise load it in the background
+    void selectPathTable(const std::string& productName) {
+        std::string pathFile = pathTableFileFor(productName);
+        selectedTableFile = pathFile;
+        tableCache.pin(pathFile);
 
-        if (!file) {
-            std::cerr << "Error opening file for reading: " << filename << std::endl;
-            return table;
+        PathTableFileStamp stamp;
+        std::shared_ptr<IndexedPathTable> cached;
+        if (readPathTableFileStamp(pathFile, stamp)) {
+            cached = tableCache.find(pathFile, stamp);
+        }
+        if (!cached) {
+            loadPathTableAsync(productName, pathFile);
+            return;
         }
 
-        // Read table size
-        uint32_t tableSize;
-        file.read(reinterpret_cast<char*>(&tableSize), sizeof(tableSize));
+        {
+            std::lock_guard<std::mutex> lock(tableMutex);
+            pathTable = cached;
+        }
+        needsRedraw = true;
+        if (!desiredProperties.empty()) {
+            findPathForProperties();
+        }
+        prefetchNextTable();
+    }
 
-        // Read each entry
-        for (uint32_t i = 0; i < tableSize; i++) {
-            // Read property bitset
-            PropertySet propBits;
-            file.read(reinterpret_cast<char*>(&propBits), sizeof(propBits));
+    void loadPathTableAsync(const std::string& productName, const std::string& pathFile) {
+        // Set loading state
+        isLoadingTable = true;
+        loadingTableProduct = productName;
+        loadingTableFile = pathFile;
+        tableLoadProgress = std::make_shared<PathTableLoadProgress>();
+
+        // Start async task; partial tables are handed over as indexing progresses
+        std::shared_ptr<PathTableLoadProgress> progress = tableLoadProgress;
+        tableLoadFuture = std::async(std::launch::async, [this, pathFile, progress]() {
+            return this->loadCachedPathTable(pathFile, progress.get(), [this, pathFile](std::shared_ptr<IndexedPathTable> partial) {
+                std::lock_guard<std::mutex> lock(partialTableMutex);
+                partialTable = partial;
+                partialTableFile = pathFile;
+            });
+        });
+    }
 
-            // Read number of entries
-            uint8_t entryCount;
-            file.read(reinterpret_cast<char*>(&entryCount), sizeof(entryCount));
+    // Use the newest partial table of the load in progress, if it is for the selected product
+    void pollPartialTable() {
+        std::shared_ptr<IndexedPathTable> partial;
+        {
+            std::lock_guard<std::mutex> lock(partialTableMutex);
+            if (!partialTable) {
+                return;
+            }
+            if (partialTableFile == selectedTableFile) {
+                partial = partialTable;
+            }
+            partialTable.reset();
+        }
+        if (!partial) {
+            return;
+        }
 
-            // Read each path entry
-            std::vector<CompactPathEntry> entries;
-            for (uint8_t j = 0; j < entryCount; j++) {
-                CompactPathEntry entry;
+        {
+            std::lock_guard<std::mutex> lock(tableMutex);
+            pathTable = partial;
+        }
+        needsRedraw = true;
+        if (!desiredProperties.empty()) {
+            findPathForProperties();
+        }
+    }
 
-                // Read sequence length
-                uint8_t seqLength;
-                file.read(reinterpret_cast<char*>(&seqLength), sizeof(seqLength));
+    // Load a table through the cache; runs on loader threads
+    std::shared_ptr<IndexedPathTable> loadCachedPathTable(const std::string& pathFile,
+        PathTableLoadProgress* progress = nullptr,
+        const std::function<void(std::shared_ptr<IndexedPathTable>)>& publish = nullptr) {
+        // A prefetch of the same file may be under way; wait for it and reuse its table
+        std::lock_guard<std::mutex> lock(tableLoadMutex);
+
+        PathTableFileStamp stamp;
+        bool stamped = readPathTableFileStamp(pathFile, stamp);
+        if (stamped) {
+            auto cached = tableCache.find(pathFile, stamp);
+            if (cached) {
+                return cached;
+            }
+        }
 
-                // Read ingredient sequence
-                entry.ingredientSequence.resize(seqLength);
-                for (uint8_t k = 0; k < seqLength; k++) {
-                    file.read(reinterpret_cast<char*>(&entry.ingredientSequence[k]), sizeof(uint8_t));
-                }
+        std::shared_ptr<IndexedPathTable> result = loadBinaryPathTable(pathFile, progress, publish);
+        if (stamped && !result->table.empty()) {
+            tableCache.insert(pathFile, stamp, result);
+        }
+        return result;
+    }
+
+    // Warm the cache with the table of the next product in the list while idle,
+    // if it fits without evicting anything
+    void prefetchNextTable() {
+        if (productButtons.empty() || isLoadingTable ||
+            (prefetchFuture.valid() && prefetchFuture.wait_for(std::chrono::seconds(0)) != std::future_status::ready)) {
+            return;
+        }
 
-                // Read stats
-                file.read(reinterpret_cast<char*>(&entry.baseValueBonus), sizeof(entry.baseValueBonus));
-                file.read(reinterpret_cast<char*>(&entry.addictiveness), sizeof(entry.addictiveness));
-                file.read(reinterpret_cast<char*>(&entry.valueMultiplier), sizeof(entry.valueMultiplier));
+        size_t current = 0;
+        for (size_t i = 0; i < productButtons.size(); i++) {
+            if (productButtons[i].id == session.product()) {
+                current = i;
+            }
+        }
 
-                entries.push_back(entry);
+        for (size_t step = 1; step < productButtons.size(); step++) {
+            std::string pathFile = "paths_" + productButtons[(current + step) % productButtons.size()].id + ".dat";
+            PathTableFileStamp stamp;
+            if (!readPathTableFileStamp(pathFile, stamp) || tableCache.contains(pathFile)) {
+                continue;
+            }
+            if (!tableCache.hasRoomFor(static_cast<size_t>(stamp.size))) {
+                return;
             }
 
-            table[propBits] = entries;
+            prefetchFuture = std::async(std::launch::async, [this, pathFile]() {
+                this->loadCachedPathTable(pathFile);
+            });
+            return;
         }
+    }
 
-        file.close();
-        std::cout << "Loaded " << table.size() << " property combinations" << std::endl;
+    // Open path table and index it; v2 files are mapped and queried in place, v1 files are read
+    std::shared_ptr<IndexedPathTable> loadBinaryPathTable(const std::string& filename,
+        PathTableLoadProgress* progress = nullptr,
+        const std::function<void(std::shared_ptr<IndexedPathTable>)>& publish = nullptr) {
+        // No global state modifications here to ensure thread safety
+        PathTableDictionary dictionary;
+        dictionary.propertyIds = propertyByBitPosition;
+        dictionary.ingredientNames = ingredientByBitPosition;
+
+        auto table = std::make_shared<IndexedPathTable>();
+        PathTableFileInfo info;
+        table->table.open(filename, dictionary, &info, progress);
+        indexPathTableProgressively(table, publish, progress);
+        std::cout << "Loaded " << table->table.size() << " property combinations"
+            << (table->table.isMapped() ? " (mapped)" : "") << std::endl;
+
+        // Precomputed answers written by Table Generation --answers, if they match this table
+        std::string answersFile = filename.substr(0, filename.rfind(".dat")) + ".answers";
+        if (table->attachAnswers(answersFile, info.dataChecksum)) {
+            std::cout << "Using answer cache " << answersFile << std::endl;
+        }
         return table;
     }
     // Convert properties to bitset
@@ -619,7 +1475,7 @@ public:
     }
 
     // Convert ingredient bits to names
-    std::vector<std::string> sequenceToIngredientNames(const std::vector<uint8_t>& sequence) {
+    std::vector<std::string> sequenceToIngredientNames(const IngredientSequence& sequence) {
         std::vector<std::string> names;
 
         for (uint8_t idx : sequence) {
@@ -702,54 +1558,114 @@ public:
             propertyButtons[index].isActive = false;
         }
         else {
-            // Add to selection
+            // Add to selection, which also lifts an exclusion
             desiredProperties.push_back(prop);
             propertyButtons[index].isActive = true;
+            avoidedProperties.erase(std::remove(avoidedProperties.begin(), avoidedProperties.end(), prop),
+                avoidedProperties.end());
+            propertyButtons[index].isExcluded = false;
         }
 
         // Update path suggestion
         findPathForProperties();
     }
 
+    // Right click toggles "never through this property"
+    void handlePropertyButtonRightClick(int index) {
+        Property* prop = getPropertyByNameOrId(propertyButtons[index].id);
+
+        auto it = std::find(avoidedProperties.begin(), avoidedProperties.end(), prop);
+        if (it != avoidedProperties.end()) {
+            avoidedProperties.erase(it);
+            propertyButtons[index].isExcluded = false;
+        }
+        else {
+            avoidedProperties.push_back(prop);
+            propertyButtons[index].isExcluded = true;
+            desiredProperties.erase(std::remove(desiredProperties.begin(), desiredProperties.end(), prop),
+                desiredProperties.end());
+            propertyButtons[index].isActive = false;
+        }
+
+        findPathForProperties();
+    }
+
     // Find path for selected properties
+    // The result arrives later through pollPathSearch; until then the panel shows the
+    // search as pending
     void findPathForProperties() {
         // Clear current suggestion
         suggestedPath.clear();
 
         if (desiredProperties.empty()) {
+            pathSearch.cancel();
+            pathSearchPending = false;
             return;
         }
 
-        // Convert desired properties to bitset
-        PropertySet desiredBits = propertiesToBitset(desiredProperties);
+        // Desired properties, and the ones to stay clear of along the way
+        PathScanFilter filter;
+        filter.include = propertiesToBitset(desiredProperties);
+        filter.neverThrough = propertiesToBitset(avoidedProperties);
+        if (filter.neverThrough != 0) {
+            // A copy of the mappings, as the search runs on the worker thread
+            std::vector<Property*> start;
+            auto productIt = products.find(session.product());
+            if (productIt != products.end()) {
+                start = productIt->second->properties;
+            }
+            filter.stepProperties = PathStepMixer(start, ingredientByBitPosition, ingredientPropertyMapping, propertyBitMapping);
+        }
 
-        // Find matching paths
-        std::vector<std::pair<PropertySet, CompactPathEntry>> matches;
+        pathSearch.submit(pathTable, filter);
+        pathSearchPending = true;
+    }
 
-        for (const auto& [propBits, entries] : pathTable) {
-            // Check if all desired bits are present
-            if ((propBits & desiredBits) == desiredBits) {
-                // Add the first entry for this property set
-                if (!entries.empty()) {
-                    matches.emplace_back(propBits, entries[0]);
-                }
-            }
+    // Swap in the suggestion once the worker has found it
+    void pollPathSearch() {
+        PathSearchWorker::Result found;
+        if (!pathSearchPending || !pathSearch.takeResult(found)) {
+            return;
         }
 
-        // Sort by ingredient count (fewer = better)
-        std::sort(matches.begin(), matches.end(),
-            [this](const auto& a, const auto& b) {
-                if (a.second.ingredientSequence.size() == b.second.ingredientSequence.size()) {
-                    return a.second.baseValueBonus > b.second.baseValueBonus;
-                }
-        return a.second.ingredientSequence.size() < b.second.ingredientSequence.size();
-            });
+        if (!found.final) {
+            // Only part of the table is indexed yet; the search runs again on the next one
+            return;
+        }
 
-        // Get the best match
-        if (!matches.empty()) {
+        pathSearchPending = false;
+        needsRedraw = true;
+        if (!found.result.paths.empty()) {
             // Convert ingredient sequence to names
-            suggestedPath = sequenceToIngredientNames(matches[0].second.ingredientSequence);
+            suggestedPath = sequenceToIngredientNames(found.result.paths[0].entry->ingredientSequence);
+        }
+    }
+
+    // Rank the ingredients again for the current properties. Called whenever they change;
+    // the ranking arrives later through pollLookahead.
+    void refreshLookahead() {
+        std::vector<Property*> start = session.propertyList();
+
+        // In ingredient button order, so rankings index ingredientButtons
+        std::vector<Property*> ingredients;
+        for (const auto& button : ingredientButtons) {
+            ingredients.push_back(getPropertyByNameOrId(ingredientPropertyMapping[button.id]));
+        }
+        if (std::find(ingredients.begin(), ingredients.end(), nullptr) != ingredients.end()) {
+            return;
+        }
+
+        lookahead.submit(start, ingredients);
+        lookaheadPending = true;
+    }
+
+    void pollLookahead() {
+        if (!lookaheadPending || !lookahead.takeResult(lookaheadRanking)) {
+            return;
         }
+
+        lookaheadPending = false;
+        needsRedraw = true;
     }
 
     void loadPathTableForProduct(const std::string& productName) {
@@ -786,15 +1702,6 @@ public:
         panel.setPosition(10.0f, 420.0f);
         //window->draw(panel);
 
-        // Draw title
-        sf::Text titleText;
-        titleText.setFont(font);
-        titleText.setString("Select Desired Properties");
-        titleText.setCharacterSize(18);
-        titleText.setFillColor(sf::Color::White);
-        titleText.setPosition(15.0f, 425.0f);
-        //window->draw(titleText);
-
         // Draw property buttons
         for (auto& button : propertyButtons) {
             button.updateColor();
@@ -803,10 +1710,7 @@ public:
         }
 
         // Draw selected properties count
-        sf::Text selectedText;
-        selectedText.setFont(font);
-        selectedText.setString("Selected: " + std::to_string(desiredProperties.size()));
-        selectedText.setCharacterSize(14);
+        sf::Text& selectedText = texts.get("desired.count", "Selected: " + std::to_string(desiredProperties.size()), 14);
         selectedText.setFillColor(sf::Color::Yellow);
         selectedText.setPosition(400.f, 140.f);
         window->draw(selectedText);
@@ -814,7 +1718,7 @@ public:
 
     // Draw path suggestion panel
     void drawPathSuggestionPanel() {
-        if (desiredProperties.empty() || suggestedPath.empty()) {
+        if (desiredProperties.empty() || (suggestedPath.empty() && !pathSearchPending)) {
             return;
         }
 
@@ -832,53 +1736,49 @@ public:
         panel.setPosition(startX, startY);
         window->draw(panel);
 
-        // Draw title
-        sf::Text titleText;
-        titleText.setFont(font);
-        titleText.setString("Property Finder");
-        titleText.setCharacterSize(16);
-        titleText.setFillColor(sf::Color::White);
-        titleText.setPosition(startX + 10.0f, startY + 0);
-        //window->draw(titleText);
-
         // Draw desired properties
-        sf::Text desiredText;
-        desiredText.setFont(font);
-        desiredText.setString("Desired Properties");
-        desiredText.setCharacterSize(14);
+        sf::Text& desiredText = texts.get("path.desired", "Desired Properties", 14);
         desiredText.setFillColor(sf::Color::Yellow);
         desiredText.setPosition(startX + 10.0f, startY + 10.f);
         window->draw(desiredText);
 
         float y = startY + 28.f;
         for (auto* prop : desiredProperties) {
-            sf::Text propText;
-            propText.setFont(font);
-            propText.setString("- " + prop->name);
-            propText.setCharacterSize(12);
+            sf::Text& propText = texts.get("path.want." + prop->id, "- " + prop->name, 12);
             propText.setFillColor(tierColors[prop->tier]);
             propText.setPosition(startX + 20.0f, y);
             window->draw(propText);
 
             y += 16.0f;
         }
+        for (auto* prop : avoidedProperties) {
+            sf::Text& propText = texts.get("path.never." + prop->id, "- never " + prop->name, 12);
+            propText.setFillColor(sf::Color(220, 90, 90));
+            propText.setPosition(startX + 20.0f, y);
+            window->draw(propText);
+
+            y += 16.0f;
+        }
         y = startY;
         // Draw suggested ingredients
-        sf::Text ingredientsText;
-        ingredientsText.setFont(font);
-        ingredientsText.setString("Suggested Path");
-        ingredientsText.setCharacterSize(14);
+        sf::Text& ingredientsText = texts.get("path.title", "Suggested Path", 14);
         ingredientsText.setFillColor(sf::Color::Yellow);
         ingredientsText.setPosition(startX + 150.f, y + 10.0f);
         window->draw(ingredientsText);
 
         y += 30.0f;
+        if (pathSearchPending) {
+            sf::Text& searchingText = texts.get("path.searching", "Searching...", 12);
+            searchingText.setFillColor(sf::Color(180, 180, 180));
+            searchingText.setPosition(startX + 155.f, y);
+            window->draw(searchingText);
+            return;
+        }
+
         int m = 1;
         for (const auto& ing : suggestedPath) {
-            sf::Text ingText;
-            ingText.setFont(font);
-            ingText.setString(std::to_string(m++) + ". " + ing);
-            ingText.setCharacterSize(12);
+            std::string step = std::to_string(m++);
+            sf::Text& ingText = texts.get("path.step." + step, step + ". " + ing, 12);
             ingText.setFillColor(sf::Color::White);
             ingText.setPosition(startX + 155.f, y);
             window->draw(ingText);
@@ -898,10 +1798,7 @@ public:
         applyButton.shape.setOutlineColor(sf::Color(100, 100, 150));
         applyButton.shape.setOutlineThickness(1.0f);
 
-        sf::Text applyText;
-        applyText.setFont(font);
-        applyText.setString("Apply Path");
-        applyText.setCharacterSize(14);
+        sf::Text& applyText = texts.get("path.apply", "Apply Path", 14);
         applyText.setFillColor(sf::Color::White);
         applyText.setPosition(
             applyButton.shape.getPosition().x +
@@ -921,6 +1818,30 @@ private:
     sf::Clock clock;
     MixerMap* mixerMap;
 
+    // Labels drawn by the draw functions, reused across frames
+    TextCache texts;
+
+    // Redraw scheduling: frames are only drawn when something changed or is animating.
+    // While idle the loop checks for input every IDLE_POLL_MS and re-evaluates at
+    // least every IDLE_WAIT_MS.
+    static constexpr int IDLE_WAIT_MS = 250;
+    static constexpr int IDLE_POLL_MS = 10;
+    bool needsRedraw = true;
+
+    // Where each frame's time goes (F3), saved to PROFILE_FILE with F4
+    static constexpr const char* PROFILE_FILE = "frame_timings.csv";
+    FrameProfiler profiler;
+    bool showProfiler = false;
+
+    // Which effect owns each map point, drawn as the map's effects and used for hit tests
+    ReactionField reactionField;
+
+    // Map boundary and grid, and circles for the active/hovered effects, as triangle
+    // lists; and the active/hovered state of each effect they were built for
+    sf::VertexArray mapShapes{ sf::Triangles };
+    sf::VertexArray mapHighlights{ sf::Triangles };
+    std::vector<uint8_t> mapShapeState;
+
     // Window dimensions
     int windowWidth;
     int windowHeight;
@@ -928,15 +1849,11 @@ private:
     // Application mode
     Mode mode;
 
-    // Selected ingredient for preview
-    Property* previewNewProperty;
-    int selectedIngredientIndex;
-
-    // Current product properties
-    std::vector<ProductProperty> currentProperties;
-
-    // Ingredient history
-    std::vector<std::string> ingredientHistory;
+    // The product, its properties, mixed ingredients and the previewed one, with undo;
+    // and what mixing the previewed ingredient would do
+    MixSession session;
+    PreviewModel previewModel;
+    static constexpr const char* SESSION_FILE = "mix_session.txt";
 
     // Visualization options
     bool showTransitions;
@@ -988,24 +1905,7 @@ private:
 
     // Initialize ingredient mapping
     void initializeIngredientMapping() {
-        ingredientPropertyMapping = {
-            {"Cuke", "energizing"},
-            {"Donut", "caloriedense"},
-            {"Flu Medicine", "sedating"},
-            {"Gasoline", "toxic"},
-            {"Energy Drink", "athletic"},
-            {"Mouth Wash", "balding"},
-            {"Banana", "gingeritis"},
-            {"Chili", "spicy"},
-            {"Motor Oil", "slippery"},
-            {"Iodine", "jennerising"},
-            {"Paracetamol", "sneaky"},
-            {"Viagra", "tropicthunder"},
-            {"Horse Semen", "giraffying"},
-            {"Mega Bean", "foggy"},
-            {"Addy", "thoughtprovoking"},
-            {"Battery", "brighteyed"}
-        };
+        ingredientPropertyMapping = mixIngredientProperties();
 
         // Create reverse mapping
         for (const auto& pair : ingredientPropertyMapping) {
@@ -1160,24 +2060,78 @@ private:
     }
 
     // Handle window events
-    void handleEvents() {
+    // Handle pending events; returns true if any of them changed what is on screen
+    bool handleEvents() {
+        bool changed = false;
         sf::Event event;
         while (window->pollEvent(event)) {
-            if (event.type == sf::Event::Closed) {
-                window->close();
+            if (handleEvent(event)) {
+                profiler.inputArrived();
+                changed = true;
+            }
+        }
+        return changed;
+    }
+
+    bool handleEvent(const sf::Event& event) {
+        if (event.type == sf::Event::MouseMoved) {
+            HoverState before = hoverState();
+            handleMouseMove(event.mouseMove.x, event.mouseMove.y);
+
+            // Pointer motion only needs a frame when it changes what is highlighted,
+            // or drags the tooltip along
+            return hoverState() != before || (hoveredProperty && showTooltips);
+        }
+
+        if (event.type == sf::Event::Closed) {
+            window->close();
+        }
+        else if (event.type == sf::Event::KeyPressed) {
+            handleKeyPress(event.key.code);
+        }
+        else if (event.type == sf::Event::MouseButtonPressed) {
+            if (event.mouseButton.button == sf::Mouse::Left) {
+                handleMouseClick(event.mouseButton.x, event.mouseButton.y);
             }
-            else if (event.type == sf::Event::KeyPressed) {
-                handleKeyPress(event.key.code);
+            else if (event.mouseButton.button == sf::Mouse::Right) {
+                handleMouseRightClick(event.mouseButton.x, event.mouseButton.y);
             }
-            else if (event.type == sf::Event::MouseMoved) {
-                handleMouseMove(event.mouseMove.x, event.mouseMove.y);
+        }
+        return true;
+    }
+
+    // Sleep until an event arrives or timeout passes, and take that event without
+    // handling it. SFML's waitEvent cannot time out, and work finishing in the
+    // background (table loads) must still be noticed.
+    bool waitForEvent(sf::Event& event, sf::Time timeout) {
+        sf::Clock waited;
+        while (waited.getElapsedTime().asMilliseconds() < timeout.asMilliseconds()) {
+            if (window->pollEvent(event)) {
+                return true;
             }
-            else if (event.type == sf::Event::MouseButtonPressed) {
-                if (event.mouseButton.button == sf::Mouse::Left) {
-                    handleMouseClick(event.mouseButton.x, event.mouseButton.y);
+            sf::sleep(sf::milliseconds(IDLE_POLL_MS));
+        }
+        return false;
+    }
+
+    // Anything on screen that changes without input
+    bool isAnimating() const {
+        return !activeTransitions.empty() || isLoadingTable || pathSearchPending || lookaheadPending;
+    }
+
+    // What the pointer currently highlights
+    using HoverState = std::tuple<Property*, int, bool, const Button*>;
+
+    HoverState hoverState() const {
+        const Button* hoveredButton = nullptr;
+        for (const auto* buttons : { &actionButtons, &productButtons, &propertyButtons }) {
+            for (const auto& button : *buttons) {
+                if (button.isHovered) {
+                    hoveredButton = &button;
                 }
             }
         }
+        return std::make_tuple(hoveredProperty, hoveredIngredientIndex, hoveredApplyPath, hoveredButton);
     }
 
     // Handle keyboard input
@@ -1189,8 +2143,26 @@ private:
         else if (key == sf::Keyboard::L) {
             showMixingLines = !showMixingLines;
         }
-        else if (key == sf::Keyboard::I) {
-            showTooltips = !showTooltips;
+        else if (key == sf::Keyboard::I) {
+            showTooltips = !showTooltips;
+        }
+        // Undo, and saving the session for Session Replay
+        else if (key == sf::Keyboard::U) {
+            undoLastChange();
+        }
+        else if (key == sf::Keyboard::F5) {
+            if (session.saveScript(SESSION_FILE)) {
+                std::cout << "Saved " << session.actions().size() << " session actions to " << SESSION_FILE << std::endl;
+            }
+        }
+        // Frame timings
+        else if (key == sf::Keyboard::F3) {
+            showProfiler = !showProfiler;
+        }
+        else if (key == sf::Keyboard::F4) {
+            if (profiler.writeCsv(PROFILE_FILE)) {
+                std::cout << "Saved " << profiler.frameCount() << " frame timings to " << PROFILE_FILE << std::endl;
+            }
         }
         // Adjust animation speed
         else if (key == sf::Keyboard::Add || key == sf::Keyboard::Equal) {
@@ -1321,96 +2293,29 @@ private:
             return;
         }
 
-        // Clear current properties
-        currentProperties.clear();
-        ingredientHistory.clear();
+        // Start over from the product and mix the whole path
         activeTransitions.clear();
-
-        // Get initial properties from product if selected
-        if (!selectedProduct.empty()) {
-            auto productIt = products.find(selectedProduct);
-            if (productIt != products.end()) {
-                DrugProduct* product = productIt->second;
-
-                // Add each property to currentProperties
-                for (Property* prop : product->properties) {
-                    ProductProperty propWithOrigin;
-                    propWithOrigin.property = prop;
-                    propWithOrigin.ingredients.push_back(selectedProduct);
-                    currentProperties.push_back(propWithOrigin);
-                }
-            }
+        std::vector<MixStep> steps;
+        session.applyPath(suggestedPath, &steps);
+        for (const auto& step : steps) {
+            findTransitions(step.before, step.after, step.added);
         }
+        refreshLookahead();
+    }
 
-        // Apply each ingredient in the path
-        for (const auto& ingredientName : suggestedPath) {
-            // Add to ingredient history
-            ingredientHistory.push_back(ingredientName);
-
-            // Get the property for this ingredient
-            std::string propertyId = ingredientPropertyMapping[ingredientName];
-            Property* newProperty = getPropertyByNameOrId(propertyId);
-
-            if (newProperty) {
-                // Extract just the properties without origin info for mixing
-                std::vector<Property*> currentProps;
-                for (const auto& propWithOrigin : currentProperties) {
-                    currentProps.push_back(propWithOrigin.property);
-                }
-
-                // Store pre-mixing properties to track transitions
-                std::vector<Property*> beforeProperties = currentProps;
-
-                // Mix the properties
-                std::vector<Property*> result = PropertyMixCalculator::mixProperties(
-                    currentProps, newProperty, DrugType::Marijuana);
-
-                // Create new properties with origin information
-                std::vector<ProductProperty> newProperties;
-
-                // For each property in the result, determine its origin
-                for (Property* resultProp : result) {
-                    ProductProperty newProp;
-                    newProp.property = resultProp;
-
-                    // Check if this property was in the previous set
-                    bool wasInPrevious = false;
-                    for (const auto& prevProp : currentProperties) {
-                        if (prevProp.property == resultProp) {
-                            // This property was in the previous set, copy its ingredient list
-                            newProp.ingredients = prevProp.ingredients;
-                            wasInPrevious = true;
-                            break;
-                        }
-                    }
-
-                    // If it's the new property we just added
-                    if (!wasInPrevious && resultProp == newProperty) {
-                        // This is just the ingredient we added
-                        newProp.ingredients.push_back(ingredientName);
-                    }
-                    // If it's a new property created by mixing
-                    else if (!wasInPrevious) {
-                        // This is a result of mixing, so list all ingredients
-                        for (const auto& prevIngredient : ingredientHistory) {
-                            if (std::find(newProp.ingredients.begin(),
-                                newProp.ingredients.end(),
-                                prevIngredient) == newProp.ingredients.end()) {
-                                newProp.ingredients.push_back(prevIngredient);
-                            }
-                        }
-                    }
-
-                    newProperties.push_back(newProp);
-                }
-
-                // Find property transitions for animation
-                findTransitions(beforeProperties, result, newProperty);
+    // Step back to before the last product change, reset or mix
+    void undoLastChange() {
+        std::string product = session.product();
+        cancelPreview();
+        if (!session.undo()) {
+            return;
+        }
 
-                // Update current properties
-                currentProperties = newProperties;
-            }
+        activeTransitions.clear();
+        if (session.product() != product) {
+            showSelectedProduct();
         }
+        refreshLookahead();
     }
 
 
@@ -1425,18 +2330,25 @@ private:
         const float centerY = windowHeight / 2.0f;
         const float scaleFactor = 80.0f; // Increased scale factor for larger map
 
-        for (auto* effect : mixerMap->effects) {
-            float screenX = centerX + effect->position.x * scaleFactor;
-            float screenY = centerY - effect->position.y * scaleFactor; // Y is inverted in SFML
+        // Back to map coordinates, then a texel lookup
+        Vector2 point((mousePos.x - centerX) / scaleFactor, (centerY - mousePos.y) / scaleFactor); // Y is inverted in SFML
+        MixerMapEffect* effect = reactionField.effectAt(point);
+        if (effect) {
+            hoveredProperty = effect->property;
+        }
+    }
 
-            float distance = std::sqrt(
-                std::pow(mousePos.x - screenX, 2) +
-                std::pow(mousePos.y - screenY, 2)
-            );
+    // Right click on a property button excludes it from the suggested path
+    void handleMouseRightClick(int x, int y) {
+        sf::Vector2f mousePos(static_cast<float>(x), static_cast<float>(y));
+        if (mode != Mode::Normal) {
+            return;
+        }
 
-            if (distance <= effect->radius * scaleFactor) {
-                hoveredProperty = effect->property;
-                break;
+        for (size_t i = 0; i < propertyButtons.size(); i++) {
+            if (propertyButtons[i].contains(mousePos)) {
+                handlePropertyButtonRightClick(i);
+                return;
             }
         }
     }
@@ -1516,16 +2428,11 @@ private:
 
     // Handle ingredient button click
     void handleIngredientClick(int index) {
-        // Get the property for this ingredient
+        // Set up preview mode
         std::string ingredientName = ingredientButtons[index].id;
-        std::string propertyId = ingredientPropertyMapping[ingredientName];
-        Property* newProperty = getPropertyByNameOrId(propertyId);
-
-        if (newProperty) {
-            // Set up preview mode
-            previewNewProperty = newProperty;
-            selectedIngredientIndex = index;
+        if (session.preview(ingredientName)) {
             mode = Mode::PreviewMix;
+            rebuildPreviewModel();
 
             // Highlight the selected button
             for (auto& button : ingredientButtons) {
@@ -1539,10 +2446,10 @@ private:
     void handleActionButtonClick(const std::string& buttonId) {
         if (buttonId == "reset") {
             // Reset all properties
-            currentProperties.clear();
-            ingredientHistory.clear();
+            session.reset();
             // Clear any active transitions
             activeTransitions.clear();
+            refreshLookahead();
         }
         else if (buttonId == "help") {
             // Show help screen
@@ -1560,7 +2467,8 @@ private:
 
     // Cancel preview mode
     void cancelPreview() {
-        previewNewProperty = nullptr;
+        session.cancelPreview();
+        previewModel = PreviewModel();
         mode = Mode::Normal;
 
         // Reset button highlights
@@ -1571,113 +2479,14 @@ private:
     }
 
     // Confirm mixing the previewed ingredient
-    // Update the confirmMix method in VisualPropertyMixer
     void confirmMix() {
-        if (!previewNewProperty) {
-            cancelPreview();
-            return;
-        }
-
-        // Get the ingredient name
-        std::string ingredientName = ingredientButtons[selectedIngredientIndex].id;
-
-        // Add to ingredient history
-        ingredientHistory.push_back(ingredientName);
-
-        // Extract just the properties without origin info for mixing
-        std::vector<Property*> currentProps;
-        for (const auto& propWithOrigin : currentProperties) {
-            currentProps.push_back(propWithOrigin.property);
-        }
-
-        // Store pre-mixing properties to track transitions
-        std::vector<Property*> beforeProperties = currentProps;
-
-        // Mix the properties with the updated calculator
-        std::vector<Property*> result = PropertyMixCalculator::mixProperties(
-            currentProps, previewNewProperty, DrugType::Marijuana);
-
-        // Create new properties with origin information
-        std::vector<ProductProperty> newProperties;
-
-        // For each property in the result, determine its origin
-        for (Property* resultProp : result) {
-            ProductProperty newProp;
-            newProp.property = resultProp;
-
-            // Check if this property was in the previous set
-            bool wasInPrevious = false;
-            for (const auto& prevProp : currentProperties) {
-                if (prevProp.property == resultProp) { // Direct pointer comparison
-                    // This property was in the previous set, copy its ingredient list
-                    newProp.ingredients = prevProp.ingredients;
-                    wasInPrevious = true;
-                    break;
-                }
-            }
-
-            // If it's the new property we just added
-            if (!wasInPrevious && resultProp == previewNewProperty) { // Direct pointer comparison
-                // This is just the ingredient we added
-                newProp.ingredients.push_back(ingredientName);
-            }
-            // If it's a new property created by mixing
-            else if (!wasInPrevious) {
-                // This is a result of mixing, so list all ingredients
-                for (const auto& prevIngredient : ingredientHistory) {
-                    if (std::find(newProp.ingredients.begin(),
-                        newProp.ingredients.end(),
-                        prevIngredient) == newProp.ingredients.end()) {
-                        newProp.ingredients.push_back(prevIngredient);
-                    }
-                }
-            }
-
-            newProperties.push_back(newProp);
-        }
-
-        // Find property transitions for animation
-        // For each property that was there before
-        for (auto* beforeProp : beforeProperties) {
-            // Check if it still exists in the result
-            bool stillExists = false;
-            for (auto* afterProp : result) {
-                if (beforeProp == afterProp) { // Direct pointer comparison
-                    stillExists = true;
-                    break;
-                }
-            }
-
-            // If not found in result, it was transformed
-            if (!stillExists) {
-                // Find the effect for this property
-                MixerMapEffect* beforeEffect = mixerMap->getEffect(beforeProp);
-                if (beforeEffect) {
-                    // Calculate where it moved to
-                    Vector2 movePos = beforeEffect->position +
-                        (previewNewProperty->mixDirection * previewNewProperty->mixMagnitude);
-
-                    // Find the effect at that position
-                    MixerMapEffect* afterEffect = mixerMap->getEffectAtPoint(movePos);
-                    if (afterEffect) {
-                        // Add a transition animation
-                        PropertyTransition transition;
-                        transition.startPosition = beforeEffect->position;
-                        transition.endPosition = afterEffect->position;
-                        transition.sourceProperty = beforeProp;
-                        transition.resultProperty = afterEffect->property;
-                        transition.animationTime = 0.0f;
-                        transition.totalAnimationTime = 1.5f;
-
-                        activeTransitions.push_back(transition);
-                    }
-                }
-            }
+        MixStep step;
+        if (session.confirmPreview(&step)) {
+            // Animate the properties that transformed
+            findTransitions(step.before, step.after, step.added);
+            refreshLookahead();
         }
 
-        // Update current properties
-        currentProperties = newProperties;
-
         // Exit preview mode
         cancelPreview();
     }
@@ -1688,7 +2497,8 @@ private:
             transition.animationTime += deltaTime * animationSpeed;
         }
 
-        // Remove completed transitions
+        // Remove completed transitions, drawing one more frame without them
+        size_t before = activeTransitions.size();
         activeTransitions.erase(
             std::remove_if(activeTransitions.begin(), activeTransitions.end(),
                 [](const PropertyTransition& t) {
@@ -1697,21 +2507,24 @@ private:
             ),
             activeTransitions.end()
                     );
+        if (activeTransitions.size() != before) {
+            needsRedraw = true;
+        }
     }
 
     // Draw the interface
     void drawInterface() {
-        // Draw the mixer map
-        drawMixerMap();
-
-        // Draw transition animations
-        if (showTransitions) {
-            drawTransitions();
-        }
-
-        // Draw mixing lines showing connections between properties
-        if (showMixingLines) {
-            drawMixingLines();
+        // Draw the mixer map, transition animations and mixing lines showing
+        // connections between properties
+        {
+            FrameProfiler::Scope timing(profiler, PHASE_MAP);
+            drawMixerMap();
+            if (showTransitions) {
+                drawTransitions();
+            }
+            if (showMixingLines) {
+                drawMixingLines();
+            }
         }
 
         //// Draw vector preview when hovering over ingredients
@@ -1720,27 +2533,52 @@ private:
         //}
 
         // Draw the stats panel
-        drawStatsPanel();
+        {
+            FrameProfiler::Scope timing(profiler, PHASE_STATS_PANEL);
+            drawStatsPanel();
+        }
 
-        // Draw ingredients panel
-        drawIngredientsPanel();
+        // Draw ingredients panel, and their ranking by what they lead to
+        {
+            FrameProfiler::Scope timing(profiler, PHASE_INGREDIENTS_PANEL);
+            drawIngredientsPanel();
+        }
+        {
+            FrameProfiler::Scope timing(profiler, PHASE_LOOKAHEAD_PANEL);
+            drawLookaheadPanel();
+        }
         // Draw products panel
-        drawProductsPanel();
+        {
+            FrameProfiler::Scope timing(profiler, PHASE_PRODUCTS_PANEL);
+            drawProductsPanel();
+        }
 
         // Draw property selection panel (new)
-        drawPropertySelectionPanel();
+        {
+            FrameProfiler::Scope timing(profiler, PHASE_PROPERTY_PANEL);
+            drawPropertySelectionPanel();
+        }
 
         // Draw path suggestion panel (new)
-        drawPathSuggestionPanel();
+        {
+            FrameProfiler::Scope timing(profiler, PHASE_PATH_PANEL);
+            drawPathSuggestionPanel();
+        }
 
         // Draw action buttons
-        drawActionButtons();
+        {
+            FrameProfiler::Scope timing(profiler, PHASE_BUTTONS);
+            drawActionButtons();
+        }
 
         // Draw preview if in preview mode
-        if (mode == Mode::PreviewMix && previewNewProperty) {
+        if (mode == Mode::PreviewMix && session.previewProperty()) {
+            FrameProfiler::Scope timing(profiler, PHASE_PREVIEW);
             drawPreview();
         }
 
+        FrameProfiler::Scope timing(profiler, PHASE_OVERLAYS);
+
         // Draw help screen if in help mode
         if (mode == Mode::Help) {
             drawHelpScreen();
@@ -1753,6 +2591,90 @@ private:
         }
     }
 
+    // Frame timings: a histogram of the recent frames per phase, frame time
+    // percentiles and input latency (F3 shows it, F4 saves every frame to a file)
+    void drawProfilerOverlay() {
+        const float startX = 370.0f;
+        const float startY = 10.0f;
+        const float panelWidth = 430.0f;
+        const float rowHeight = 20.0f;
+        const float graphX = startX + 120.0f;
+        const float graphWidth = 200.0f;
+        const float panelHeight = 40.0f + rowHeight * PHASE_COUNT + 70.0f;
+
+        sf::RectangleShape panel(sf::Vector2f(panelWidth, panelHeight));
+        panel.setFillColor(sf::Color(10, 10, 20, 230));
+        panel.setOutlineColor(sf::Color(100, 100, 150));
+        panel.setOutlineThickness(1.0f);
+        panel.setPosition(startX, startY);
+        window->draw(panel);
+
+        std::vector<const FrameProfiler::Frame*> recent = profiler.recent();
+        sf::Text& titleText = texts.get("profiler.title",
+            "Frame Timings (last " + std::to_string(recent.size()) + " frames, ms)", 14, sf::Text::Bold);
+        titleText.setFillColor(sf::Color::White);
+        titleText.setPosition(startX + 10.0f, startY + 8.0f);
+        window->draw(titleText);
+
+        // One bar per frame, scaled to the slowest frame of that phase
+        sf::VertexArray bars(sf::Triangles);
+        const float barWidth = graphWidth / FrameProfiler::WINDOW;
+        float y = startY + 34.0f;
+        for (int phase = 0; phase < PHASE_COUNT; phase++) {
+            float sum = 0.0f;
+            float peak = 0.0f;
+            for (const auto* frame : recent) {
+                sum += frame->phaseMs[phase];
+                peak = std::max(peak, frame->phaseMs[phase]);
+            }
+            float mean = recent.empty() ? 0.0f : sum / recent.size();
+
+            for (size_t i = 0; i < recent.size(); i++) {
+                float height = peak > 0.0f ? (rowHeight - 4.0f) * recent[i]->phaseMs[phase] / peak : 0.0f;
+                appendRectangle(bars, sf::Vector2f(graphX + i * barWidth, y + rowHeight - 2.0f - height),
+                    sf::Vector2f(std::max(barWidth, 1.0f), height), sf::Color(100, 180, 255));
+            }
+
+            sf::Text& nameText = texts.get(std::string("profiler.name.") + PROFILE_PHASE_NAMES[phase],
+                PROFILE_PHASE_NAMES[phase], 12);
+            nameText.setFillColor(sf::Color(200, 200, 200));
+            nameText.setPosition(startX + 10.0f, y + 2.0f);
+            window->draw(nameText);
+
+            std::stringstream stats;
+            stats << std::fixed << std::setprecision(2) << mean << " / " << peak;
+            sf::Text& statsText = texts.get(std::string("profiler.stats.") + PROFILE_PHASE_NAMES[phase], stats.str(), 12);
+            statsText.setFillColor(sf::Color::White);
+            statsText.setPosition(graphX + graphWidth + 10.0f, y + 2.0f);
+            window->draw(statsText);
+
+            y += rowHeight;
+        }
+        window->draw(bars);
+
+        std::stringstream frameLine;
+        frameLine << std::fixed << std::setprecision(2) << "Frame p50 " << profiler.framePercentile(50.0f)
+            << "  p95 " << profiler.framePercentile(95.0f) << "  p99 " << profiler.framePercentile(99.0f);
+        sf::Text& frameText = texts.get("profiler.frame", frameLine.str(), 12);
+        frameText.setFillColor(sf::Color::Yellow);
+        frameText.setPosition(startX + 10.0f, y + 6.0f);
+        window->draw(frameText);
+
+        std::stringstream latencyLine;
+        latencyLine << std::fixed << std::setprecision(2) << "Input to present p50 " << profiler.latencyPercentile(50.0f)
+            << "  p95 " << profiler.latencyPercentile(95.0f);
+        sf::Text& latencyText = texts.get("profiler.latency", latencyLine.str(), 12);
+        latencyText.setFillColor(sf::Color::Yellow);
+        latencyText.setPosition(startX + 10.0f, y + 24.0f);
+        window->draw(latencyText);
+
+        sf::Text& hintText = texts.get("profiler.hint",
+            "F4: save " + std::to_string(profiler.frameCount()) + " frames to " + PROFILE_FILE, 12);
+        hintText.setFillColor(sf::Color(150, 150, 150));
+        hintText.setPosition(startX + 10.0f, y + 42.0f);
+        window->draw(hintText);
+    }
+
     // Draw the mixer map with all effects
     void drawMixerMap() {
         if (!mixerMap) return;
@@ -1761,118 +2683,162 @@ private:
         const float centerY = windowHeight / 2.0f;
         const float scaleFactor = 80.0f; // Increased scale factor for larger map
 
-        // Draw the map boundary circle
-        sf::CircleShape mapBoundary(mixerMap->mapRadius * scaleFactor);
-        mapBoundary.setFillColor(sf::Color(30, 30, 50, 100));
-        mapBoundary.setOutlineColor(sf::Color(100, 100, 200));
-        mapBoundary.setOutlineThickness(2.0f);
-        mapBoundary.setPosition(centerX - mapBoundary.getRadius(), centerY - mapBoundary.getRadius());
-        window->draw(mapBoundary);
+        // Which effects are on the product and which one is hovered; the circles only
+        // need building again when that changes
+        std::vector<uint8_t> shapeState(mixerMap->effects.size(), 0);
+        for (size_t i = 0; i < mixerMap->effects.size(); i++) {
+            Property* property = mixerMap->effects[i]->property;
+            for (const auto& prop : session.properties()) {
+                if (prop.property->id == property->id) {
+                    shapeState[i] |= 1;
+                    break;
+                }
+            }
+            if (property == hoveredProperty) {
+                shapeState[i] |= 2;
+            }
+        }
+
+        if (!reactionField.isBuiltFor(mixerMap)) {
+            reactionField.build(mixerMap, scaleFactor, tierColors);
+            mapShapes.clear();
+        }
+        if (mapShapes.getVertexCount() == 0 || shapeState != mapShapeState) {
+            mapShapeState = shapeState;
+            rebuildMapShapes();
+        }
+
+        // Grid, then every effect as one quad, then the highlighted effects. While
+        // previewing a mix, the effects are shown where each point would land instead.
+        window->draw(mapShapes);
+        Vector2 previewVector;
+        bool previewing = mode == Mode::PreviewMix && session.previewProperty();
+        if (previewing) {
+            previewVector = session.previewProperty()->mixDirection * session.previewProperty()->mixMagnitude;
+        }
+        sf::Sprite field(previewing ? reactionField.shiftedTexture(previewVector) : reactionField.texture());
+        field.setPosition(centerX - mixerMap->mapRadius * scaleFactor, centerY - mixerMap->mapRadius * scaleFactor);
+        window->draw(field);
+        window->draw(mapHighlights);
+
+        // Draw the property names with better contrast
+        for (size_t i = 0; i < mixerMap->effects.size(); i++) {
+            MixerMapEffect* effect = mixerMap->effects[i];
+            bool isActive = (shapeState[i] & 1) != 0;
+            float screenX = centerX + effect->position.x * scaleFactor;
+            float screenY = centerY - effect->position.y * scaleFactor; // Y is inverted in SFML
+
+            sf::Text& propertyText = texts.get("map." + effect->property->id,
+                effect->property->name + "\n    Tier" + std::to_string(effect->property->tier), 14,
+                isActive ? sf::Text::Bold : sf::Text::Regular);
+            propertyText.setFillColor(isActive ? sf::Color::White : sf::Color(220, 220, 220));
+            // Add black outline for better readability
+            propertyText.setOutlineColor(sf::Color::Black);
+            propertyText.setOutlineThickness(1.0f);
+            propertyText.setPosition(screenX - propertyText.getLocalBounds().width / 2.0f,
+                screenY - propertyText.getLocalBounds().height / 2.0f);
+            window->draw(propertyText);
+        }
+    }
+
+    // Build the map boundary, grid and axes into mapShapes, and circles for the active
+    // and hovered effects (see mapShapeState) into mapHighlights. The effects
+    // themselves come from reactionField.
+    void rebuildMapShapes() {
+        const float centerX = windowWidth / 2.0f;
+        const float centerY = windowHeight / 2.0f;
+        const float scaleFactor = 80.0f;
+        const sf::Vector2f center(centerX, centerY);
+        const float mapRadius = mixerMap->mapRadius * scaleFactor;
 
-        // Draw grid lines
+        mapShapes.clear();
+        mapHighlights.clear();
+
+        // Map boundary and grid circles
+        appendCircle(mapShapes, center, mapRadius, sf::Color(30, 30, 50, 100), sf::Color(100, 100, 200), 2.0f);
         for (int i = 1; i <= (int)mixerMap->mapRadius; i++) {
-            sf::CircleShape gridCircle(i * scaleFactor);
-            gridCircle.setFillColor(sf::Color::Transparent);
-            gridCircle.setOutlineColor(sf::Color(70, 70, 120, 100));
-            gridCircle.setOutlineThickness(1.0f);
-            gridCircle.setPosition(centerX - gridCircle.getRadius(), centerY - gridCircle.getRadius());
-            window->draw(gridCircle);
-        }
-
-        // Draw coordinate axes
-        sf::Vertex xAxis[] = {
-            sf::Vertex(sf::Vector2f(centerX - mapBoundary.getRadius(), centerY), sf::Color(120, 120, 200, 150)),
-            sf::Vertex(sf::Vector2f(centerX + mapBoundary.getRadius(), centerY), sf::Color(120, 120, 200, 150))
-        };
-        sf::Vertex yAxis[] = {
-            sf::Vertex(sf::Vector2f(centerX, centerY - mapBoundary.getRadius()), sf::Color(120, 120, 200, 150)),
-            sf::Vertex(sf::Vector2f(centerX, centerY + mapBoundary.getRadius()), sf::Color(120, 120, 200, 150))
-        };
-        window->draw(xAxis, 2, sf::Lines);
-        window->draw(yAxis, 2, sf::Lines);
-                // Draw the effects (circles)
-                for (auto* effect : mixerMap->effects) {
-                    // Calculate screen position
-                    float screenX = centerX + effect->position.x * scaleFactor;
-                    float screenY = centerY - effect->position.y * scaleFactor; // Y is inverted in SFML
-
-                    // Store property position for other visualizations
-                    propertyPositions[effect->property->id] = Vector2(screenX, screenY);
-
-                    // Draw the effect circle
-                    sf::CircleShape effectCircle(effect->radius * scaleFactor);
-
-                    // Get color based on property tier
-                    sf::Color effectColor = tierColors[effect->property->tier];
-
-                    // Make hovering effect brighter
-                    if (effect->property == hoveredProperty) {
-                        effectColor = sf::Color(
-                            std::min(effectColor.r + 50, 255),
-                            std::min(effectColor.g + 50, 255),
-                            std::min(effectColor.b + 50, 255)
-                        );
-                    }
+            appendCircle(mapShapes, center, i * scaleFactor, sf::Color::Transparent, sf::Color(70, 70, 120, 100), 1.0f);
+        }
 
-                    // Check if this property is in our current properties
-                    bool isActive = false;
-                    for (const auto& prop : currentProperties) {
-                        if (prop.property->id == effect->property->id) {
-                            isActive = true;
-                            break;
-                        }
-                    }
+        // Coordinate axes
+        sf::Color axisColor(120, 120, 200, 150);
+        appendRectangle(mapShapes, sf::Vector2f(centerX - mapRadius, centerY - 0.5f), sf::Vector2f(mapRadius * 2, 1.0f), axisColor);
+        appendRectangle(mapShapes, sf::Vector2f(centerX - 0.5f, centerY - mapRadius), sf::Vector2f(1.0f, mapRadius * 2), axisColor);
 
-                    // Make active properties more visible
-                    if (isActive) {
-                        effectCircle.setFillColor(sf::Color(effectColor.r, effectColor.g, effectColor.b, 200)); // Less transparent
-                        effectCircle.setOutlineColor(sf::Color::White);
-                        effectCircle.setOutlineThickness(3.0f);
-                    }
-                    else {
-                        effectCircle.setFillColor(sf::Color(effectColor.r, effectColor.g, effectColor.b, 100)); // More transparent
-                        effectCircle.setOutlineColor(effectColor);
-                        effectCircle.setOutlineThickness(2.0f);
-                    }
+        // The effects
+        for (size_t i = 0; i < mixerMap->effects.size(); i++) {
+            MixerMapEffect* effect = mixerMap->effects[i];
+            float screenX = centerX + effect->position.x * scaleFactor;
+            float screenY = centerY - effect->position.y * scaleFactor; // Y is inverted in SFML
 
-                    effectCircle.setPosition(screenX - effectCircle.getRadius(), screenY - effectCircle.getRadius());
-                    window->draw(effectCircle);
-
-                    // Draw the property name with better contrast
-                    sf::Text propertyText;
-                    propertyText.setFont(font);
-                    propertyText.setString(effect->property->name + "\n    Tier" + std::to_string(effect->property->tier));
-                    propertyText.setCharacterSize(14);  // Increased font size
-                    if (isActive) {
-                        propertyText.setFillColor(sf::Color::White);
-                        propertyText.setStyle(sf::Text::Bold);
-                        
-                    }
-                    else {
-                        propertyText.setFillColor(sf::Color(220, 220, 220));
-                    }
-                    // Add black outline for better readability
-                    propertyText.setOutlineColor(sf::Color::Black);
-                    propertyText.setOutlineThickness(1.0f);
-                    propertyText.setPosition(screenX - propertyText.getLocalBounds().width / 2.0f,
-                        screenY - propertyText.getLocalBounds().height / 2.0f);
-                    window->draw(propertyText);
-
-                    //// Draw the tier number with small circle
-                    //sf::CircleShape tierCircle(12.0f);  // Slightly larger
-                    //tierCircle.setFillColor(effectColor);
-                    //tierCircle.setPosition(screenX - 12.0f, screenY - effectCircle.getRadius() - 30.0f);
-                    //window->draw(tierCircle);
-
-                    //sf::Text tierText;
-                    //tierText.setFont(font);
-                    //tierText.setString(std::to_string(effect->property->tier));
-                    //tierText.setCharacterSize(14);  // Increased font size
-                    //tierText.setFillColor(sf::Color::White);
-                    //tierText.setPosition(screenX - 5.0f, screenY - effectCircle.getRadius() - 30.0f);
-                    //window->draw(tierText);
-                }
+            // Store property position for other visualizations
+            propertyPositions[effect->property->id] = Vector2(screenX, screenY);
+
+            // Get color based on property tier
+            sf::Color effectColor = tierColors[effect->property->tier];
+
+            // Make hovering effect brighter
+            if (mapShapeState[i] & 2) {
+                effectColor = sf::Color(
+                    std::min(effectColor.r + 50, 255),
+                    std::min(effectColor.g + 50, 255),
+                    std::min(effectColor.b + 50, 255)
+                );
+            }
+
+            // Make active properties more visible; the field already draws the rest
+            float radius = effect->radius * scaleFactor;
+            if (mapShapeState[i] & 1) {
+                appendCircle(mapHighlights, sf::Vector2f(screenX, screenY), radius,
+                    sf::Color(effectColor.r, effectColor.g, effectColor.b, 140), sf::Color::White, 3.0f);
+            }
+            else if (mapShapeState[i] & 2) {
+                appendCircle(mapHighlights, sf::Vector2f(screenX, screenY), radius,
+                    sf::Color(effectColor.r, effectColor.g, effectColor.b, 60), effectColor, 2.0f);
+            }
         }
+    }
+
+    // Triangles for a circle as sf::CircleShape draws it, with the outline outside the radius
+    static void appendCircle(sf::VertexArray& vertices, sf::Vector2f center, float radius,
+        sf::Color fillColor, sf::Color outlineColor, float outlineThickness) {
+        const int pointCount = 30; // sf::CircleShape default
+        const float step = 2.0f * 3.141592654f / pointCount;
+
+        for (int i = 0; i < pointCount; i++) {
+            sf::Vector2f from(std::cos(i * step), std::sin(i * step));
+            sf::Vector2f to(std::cos((i + 1) * step), std::sin((i + 1) * step));
+
+            if (fillColor.a > 0) {
+                vertices.append(sf::Vertex(center, fillColor));
+                vertices.append(sf::Vertex(center + from * radius, fillColor));
+                vertices.append(sf::Vertex(center + to * radius, fillColor));
+            }
+            if (outlineThickness > 0.0f) {
+                sf::Vector2f innerFrom = center + from * radius;
+                sf::Vector2f innerTo = center + to * radius;
+                sf::Vector2f outerFrom = center + from * (radius + outlineThickness);
+                sf::Vector2f outerTo = center + to * (radius + outlineThickness);
+                vertices.append(sf::Vertex(innerFrom, outlineColor));
+                vertices.append(sf::Vertex(outerFrom, outlineColor));
+                vertices.append(sf::Vertex(outerTo, outlineColor));
+                vertices.append(sf::Vertex(innerFrom, outlineColor));
+                vertices.append(sf::Vertex(outerTo, outlineColor));
+                vertices.append(sf::Vertex(innerTo, outlineColor));
+            }
+        }
+    }
+
+    static void appendRectangle(sf::VertexArray& vertices, sf::Vector2f position, sf::Vector2f size, sf::Color color) {
+        sf::Vector2f topRight(position.x + size.x, position.y);
+        sf::Vector2f bottomLeft(position.x, position.y + size.y);
+        vertices.append(sf::Vertex(position, color));
+        vertices.append(sf::Vertex(topRight, color));
+        vertices.append(sf::Vertex(position + size, color));
+        vertices.append(sf::Vertex(position, color));
+        vertices.append(sf::Vertex(position + size, color));
+        vertices.append(sf::Vertex(bottomLeft, color));
+    }
 
         // Draw property transitions (animations)
         void drawTransitions() {
@@ -1880,7 +2846,9 @@ private:
             const float centerY = windowHeight / 2.0f;
             const float scaleFactor = 80.0f;
 
-            for (const auto& transition : activeTransitions) {
+            for (size_t i = 0; i < activeTransitions.size(); i++) {
+                const auto& transition = activeTransitions[i];
+
                 // Calculate interpolated position
                 float t = std::min(transition.animationTime / transition.totalAnimationTime, 1.0f);
                 float easeT = easeInOutCubic(t); // Apply easing function
@@ -1921,10 +2889,8 @@ private:
                 window->draw(transitionCircle);
 
                 // Draw property name above the circle with better contrast
-                sf::Text propText;
-                propText.setFont(font);
-                propText.setString(transition.sourceProperty->name + " → " + transition.resultProperty->name);
-                propText.setCharacterSize(14);  // Increased font size
+                sf::Text& propText = texts.get("transition." + std::to_string(i),
+                    transition.sourceProperty->name + " → " + transition.resultProperty->name, 14);
                 propText.setFillColor(sf::Color::White);
                 propText.setOutlineColor(sf::Color::Black);
                 propText.setOutlineThickness(1.0f);
@@ -1936,14 +2902,14 @@ private:
 
         // Draw lines showing mixing connections between properties
         void drawMixingLines() {
-            if (currentProperties.size() <= 1) return;
+            if (session.properties().size() <= 1) return;
 
             // For each pair of properties, draw a connection line
-            for (size_t i = 0; i < currentProperties.size(); i++) {
-                for (size_t j = i + 1; j < currentProperties.size(); j++) {
+            for (size_t i = 0; i < session.properties().size(); i++) {
+                for (size_t j = i + 1; j < session.properties().size(); j++) {
                     // Get positions from our stored map
-                    auto posIt1 = propertyPositions.find(currentProperties[i].property->id);
-                    auto posIt2 = propertyPositions.find(currentProperties[j].property->id);
+                    auto posIt1 = propertyPositions.find(session.properties()[i].property->id);
+                    auto posIt2 = propertyPositions.find(session.properties()[j].property->id);
 
                     if (posIt1 != propertyPositions.end() && posIt2 != propertyPositions.end()) {
                         // Draw white line with dashed effect for better visibility
@@ -1985,18 +2951,13 @@ private:
             window->draw(tooltip);
 
             // Add property details to tooltip
-            sf::Text nameText;
-            nameText.setFont(font);
-            nameText.setString(property->name + " (Tier " + std::to_string(property->tier) + ")");
-            nameText.setCharacterSize(16);  // Increased font size
-            nameText.setStyle(sf::Text::Bold);
+            sf::Text& nameText = texts.get("tooltip.name",
+                property->name + " (Tier " + std::to_string(property->tier) + ")", 16, sf::Text::Bold);
             nameText.setFillColor(tierColors[property->tier]);
             nameText.setPosition(tooltipX + 15, tooltipY + 15);
             window->draw(nameText);
 
             // Property stats
-            sf::Text statsText;
-            statsText.setFont(font);
             std::stringstream ss;
             ss << std::fixed << std::setprecision(2);
             ss << "ID: " << property->id << "\n"
@@ -2007,8 +2968,7 @@ private:
                 << property->mixDirection.y << ")\n"
                 << "Mix Magnitude: " << property->mixMagnitude;
 
-            statsText.setString(ss.str());
-            statsText.setCharacterSize(14);  // Increased font size
+            sf::Text& statsText = texts.get("tooltip.stats", ss.str(), 14);
             statsText.setFillColor(sf::Color::White);
             statsText.setPosition(tooltipX + 15, tooltipY + 45);
             window->draw(statsText);
@@ -2016,11 +2976,7 @@ private:
             // Check if this is an ingredient
             auto it = propertyToIngredientMap.find(property->id);
             if (it != propertyToIngredientMap.end()) {
-                sf::Text ingredientText;
-                ingredientText.setFont(font);
-                ingredientText.setString("Ingredient: " + it->second);
-                ingredientText.setCharacterSize(14);  // Increased font size
-                ingredientText.setStyle(sf::Text::Bold);
+                sf::Text& ingredientText = texts.get("tooltip.ingredient", "Ingredient: " + it->second, 14, sf::Text::Bold);
                 ingredientText.setFillColor(sf::Color(200, 200, 100));
                 ingredientText.setPosition(tooltipX + 15, tooltipY + 145);
                 window->draw(ingredientText);
@@ -2043,12 +2999,8 @@ private:
             window->draw(panel);
 
             // Title
-            sf::Text titleText;
-            titleText.setFont(font);
-            titleText.setString("Select Product");
-            titleText.setCharacterSize(20);
+            sf::Text& titleText = texts.get("products.title", "Select Product", 20, sf::Text::Bold);
             titleText.setFillColor(sf::Color::White);
-            titleText.setStyle(sf::Text::Bold);
             titleText.setPosition(startX + 15.0f, startY + 15.0f);
             window->draw(titleText);
 
@@ -2059,15 +3011,11 @@ private:
             }
 
             // Display selected product info if one is selected
-            if (!selectedProduct.empty()) {
+            if (!session.product().empty()) {
                 float infoY = startY + 60.0f + productButtons.size() * 40.0f;
 
-                sf::Text selectedText;
-                selectedText.setFont(font);
-                selectedText.setString("Selected: " + selectedProduct);
-                selectedText.setCharacterSize(16);
+                sf::Text& selectedText = texts.get("products.selected", "Selected: " + session.product(), 16, sf::Text::Bold);
                 selectedText.setFillColor(sf::Color(100, 200, 100));
-                selectedText.setStyle(sf::Text::Bold);
                 selectedText.setPosition(startX + 15.0f, infoY);
                 window->draw(selectedText);
             }
@@ -2077,7 +3025,7 @@ private:
         // Draw the stats panel
         void drawStatsPanel() {
             const float panelWidth = 350.0f;  // Larger panel
-            const float panelHeight = 400.0f + 20.f * currentProperties.size();  // Larger panel
+            const float panelHeight = 400.0f + 20.f * session.properties().size();  // Larger panel
             const float startX = 10.0f;
             const float startY = 10.0f;
             const float lineHeight = 30.0f;  // Increased line height
@@ -2092,29 +3040,23 @@ private:
             window->draw(panel);
 
             // Title
-            sf::Text titleText;
-            titleText.setFont(font);
-            titleText.setString("Property Stats");
-            titleText.setCharacterSize(20);  // Increased font size
+            sf::Text& titleText = texts.get("stats.title", "Property Stats", 20, sf::Text::Bold);
             titleText.setFillColor(sf::Color::White);
-            titleText.setStyle(sf::Text::Bold);
             titleText.setPosition(startX + padding, startY + padding);
             window->draw(titleText);
 
             // If no properties, show message
-            if (currentProperties.empty()) {
-                sf::Text noPropsText;
-                noPropsText.setFont(font);
-
-                if (selectedProduct.empty()) {
-                    noPropsText.setString("No properties yet.\nSelect a product to begin.");
+            if (session.properties().empty()) {
+                std::string message;
+                if (session.product().empty()) {
+                    message = "No properties yet.\nSelect a product to begin.";
                 }
                 else {
-                    noPropsText.setString("Selected product: " + selectedProduct +
-                        "\nNo properties added yet.\nSelect an ingredient to add.");
+                    message = "Selected product: " + session.product() +
+                        "\nNo properties added yet.\nSelect an ingredient to add.";
                 }
 
-                noPropsText.setCharacterSize(16);
+                sf::Text& noPropsText = texts.get("stats.empty", message, 16);
                 noPropsText.setFillColor(sf::Color(180, 180, 180));
                 noPropsText.setPosition(startX + padding, startY + padding + lineHeight * 2);
                 window->draw(noPropsText);
@@ -2127,7 +3069,7 @@ private:
             float totalValueMultiplier = 1.0f;
             int totalValueChange = 0;
 
-            for (const auto& prop : currentProperties) {
+            for (const auto& prop : session.properties()) {
                 totalAddictiveness += prop.property->addictiveness;
                 totalBaseValueMultiple += prop.property->addBaseValueMultiple;
                 totalValueMultiplier *= prop.property->valueMultiplier;
@@ -2135,12 +3077,8 @@ private:
             }
 
             // Draw current properties heading
-            sf::Text propsTitle;
-            propsTitle.setFont(font);
-            propsTitle.setString("Current Properties:");
-            propsTitle.setCharacterSize(16);  // Increased font size
+            sf::Text& propsTitle = texts.get("stats.properties", "Current Properties:", 16, sf::Text::Bold);
             propsTitle.setFillColor(sf::Color::White);
-            propsTitle.setStyle(sf::Text::Bold);
             propsTitle.setPosition(startX + padding, startY + padding + lineHeight * 1.5f);
             window->draw(propsTitle);
 
@@ -2149,13 +3087,11 @@ private:
             int maxToShow = 10; // Limit properties shown to fit in panel
             int shown = 0;
 
-            for (size_t i = 0; i < currentProperties.size() && shown < maxToShow; i++) {
-                Property* prop = currentProperties[i].property;
+            for (size_t i = 0; i < session.properties().size() && shown < maxToShow; i++) {
+                Property* prop = session.properties()[i].property;
 
-                sf::Text propText;
-                propText.setFont(font);
-                propText.setString(std::to_string(i + 1) + ". " + prop->name + " (Tier " + std::to_string(prop->tier) + ")");
-                propText.setCharacterSize(16);  // Increased font size
+                sf::Text& propText = texts.get("stats.property." + std::to_string(i),
+                    std::to_string(i + 1) + ". " + prop->name + " (Tier " + std::to_string(prop->tier) + ")", 16);
                 propText.setFillColor(tierColors[prop->tier]);
                 propText.setPosition(startX + padding * 2, y);
                 window->draw(propText);
@@ -2165,11 +3101,9 @@ private:
             }
 
             // If there are more properties than we can show
-            if (currentProperties.size() > maxToShow) {
-                sf::Text moreText;
-                moreText.setFont(font);
-                moreText.setString("... and " + std::to_string(currentProperties.size() - maxToShow) + " more");
-                moreText.setCharacterSize(14);
+            if (session.properties().size() > maxToShow) {
+                sf::Text& moreText = texts.get("stats.more",
+                    "... and " + std::to_string(session.properties().size() - maxToShow) + " more", 14);
                 moreText.setFillColor(sf::Color(150, 150, 150));
                 moreText.setPosition(startX + padding * 2, y);
                 window->draw(moreText);
@@ -2179,12 +3113,8 @@ private:
             y += lineHeight / 2;
 
             // Draw stats title
-            sf::Text statsTitle;
-            statsTitle.setFont(font);
-            statsTitle.setString("Cumulative Stats:");
-            statsTitle.setCharacterSize(16);  // Increased font size
+            sf::Text& statsTitle = texts.get("stats.cumulative", "Cumulative Stats:", 16, sf::Text::Bold);
             statsTitle.setFillColor(sf::Color::White);
-            statsTitle.setStyle(sf::Text::Bold);
             statsTitle.setPosition(startX + padding, y);
             window->draw(statsTitle);
 
@@ -2198,20 +3128,14 @@ private:
             y += lineHeight;
 
             // Value multiplier text
-            sf::Text multText;
-            multText.setFont(font);
-            multText.setString("Value Multiplier: " + std::to_string(totalValueMultiplier));
-            multText.setCharacterSize(16);  // Increased font size
+            sf::Text& multText = texts.get("stats.multiplier", "Value Multiplier: " + std::to_string(totalValueMultiplier), 16);
             multText.setFillColor(sf::Color::White);
             multText.setPosition(startX + padding, y);
             window->draw(multText);
             y += lineHeight;
 
             // Value change text
-            sf::Text changeText;
-            changeText.setFont(font);
-            changeText.setString("Value Change: " + std::to_string(totalValueChange));
-            changeText.setCharacterSize(16);  // Increased font size
+            sf::Text& changeText = texts.get("stats.change", "Value Change: " + std::to_string(totalValueChange), 16);
             changeText.setFillColor(sf::Color::White);
             changeText.setPosition(startX + padding, y);
             window->draw(changeText);
@@ -2231,10 +3155,7 @@ private:
             formula << "Final Value = Base Value * (1 + " << totalBaseValueMultiple << ") * "
                 << totalValueMultiplier << " + " << totalValueChange;
 
-            sf::Text formulaText;
-            formulaText.setFont(font);
-            formulaText.setString(formula.str());
-            formulaText.setCharacterSize(14);  // Increased font size
+            sf::Text& formulaText = texts.get("stats.formula", formula.str(), 14);
             formulaText.setFillColor(sf::Color::Yellow);
             formulaText.setPosition(startX + padding * 2, y + padding);
             window->draw(formulaText);
@@ -2256,12 +3177,8 @@ private:
             window->draw(panel);
 
             // Title
-            sf::Text titleText;
-            titleText.setFont(font);
-            titleText.setString("Ingredients");
-            titleText.setCharacterSize(20);  // Increased font size
+            sf::Text& titleText = texts.get("ingredients.title", "Ingredients", 20, sf::Text::Bold);
             titleText.setFillColor(sf::Color::White);
-            titleText.setStyle(sf::Text::Bold);
             titleText.setPosition(startX + 15.0f, startY + 15.0f);
             window->draw(titleText);
 
@@ -2273,7 +3190,7 @@ private:
             }
 
             // Draw ingredient history BELOW the ingredient buttons, not overlapping
-            if (!ingredientHistory.empty()) {
+            if (!session.history().empty()) {
                 // Calculate position below the last ingredient button
                 float historyStartY = ingredientButtons.back().shape.getPosition().y +
                     ingredientButtons.back().shape.getSize().y + 30.0f;
@@ -2285,12 +3202,8 @@ private:
                 //window->draw(separator);
 
                 // History title
-                sf::Text historyTitle;
-                historyTitle.setFont(font);
-                historyTitle.setString("Ingredient History:");
-                historyTitle.setCharacterSize(16);  // Increased font size
+                sf::Text& historyTitle = texts.get("history.title", "Ingredient History:", 16, sf::Text::Bold);
                 historyTitle.setFillColor(sf::Color::White);
-                historyTitle.setStyle(sf::Text::Bold);
                 historyTitle.setPosition(startX + 15.0f, historyStartY);
                 window->draw(historyTitle);
 
@@ -2298,13 +3211,11 @@ private:
                 float y = historyStartY + 30.0f;
                 int maxToShow = 20;
 
-                for (int i = ingredientHistory.size() - 1;
-                    i >= 0 && i >= (int)ingredientHistory.size() - maxToShow;
+                for (int i = session.history().size() - 1;
+                    i >= 0 && i >= (int)session.history().size() - maxToShow;
                     i--) {
-                    sf::Text historyText;
-                    historyText.setFont(font);
-                    historyText.setString(std::to_string(i + 1) + ". " + ingredientHistory[i]);
-                    historyText.setCharacterSize(14);
+                    sf::Text& historyText = texts.get("history." + std::to_string(i),
+                        std::to_string(i + 1) + ". " + session.history()[i], 14);
                     historyText.setFillColor(sf::Color(180, 180, 180));
                     historyText.setPosition(startX + 25.0f, y);
                     window->draw(historyText);
@@ -2314,6 +3225,79 @@ private:
             }
         }
 
+        // Draw the ingredients ranked by the best value reachable within a few mixes
+        void drawLookaheadPanel() {
+            const float panelWidth = 210.0f;
+            const float rowHeight = 18.0f;
+            const float startX = windowWidth - 160.0f - 10.0f - panelWidth - 10.0f;
+            const float startY = 10.0f;
+            const float panelHeight = 60.0f + rowHeight * (ingredientButtons.size() + LookaheadWorker::STEPS);
+
+            sf::RectangleShape panel(sf::Vector2f(panelWidth, panelHeight));
+            panel.setFillColor(sf::Color(20, 20, 30, 200));
+            panel.setOutlineColor(sf::Color(100, 100, 150));
+            panel.setOutlineThickness(1.0f);
+            panel.setPosition(startX, startY);
+            window->draw(panel);
+
+            sf::Text& titleText = texts.get("lookahead.title",
+                "Best Next (" + std::to_string(LookaheadWorker::STEPS) + " mixes)", 16, sf::Text::Bold);
+            titleText.setFillColor(sf::Color::White);
+            titleText.setPosition(startX + 10.0f, startY + 10.0f);
+            window->draw(titleText);
+
+            std::stringstream current;
+            current << std::fixed << std::setprecision(2) << "Now: x" << lookaheadRanking.current;
+            if (lookaheadPending) {
+                current << "  (updating...)";
+            }
+            sf::Text& currentText = texts.get("lookahead.current", current.str(), 12);
+            currentText.setFillColor(sf::Color(180, 180, 180));
+            currentText.setPosition(startX + 10.0f, startY + 32.0f);
+            window->draw(currentText);
+
+            float y = startY + 52.0f;
+            const LookaheadWorker::Ranked* hoveredRank = nullptr;
+            for (size_t i = 0; i < lookaheadRanking.ranking.size(); i++) {
+                const auto& ranked = lookaheadRanking.ranking[i];
+                if (ranked.ingredient >= ingredientButtons.size()) {
+                    continue;
+                }
+                bool hovered = static_cast<int>(ranked.ingredient) == hoveredIngredientIndex;
+                if (hovered) {
+                    hoveredRank = &ranked;
+                    sf::RectangleShape highlight(sf::Vector2f(panelWidth - 10.0f, rowHeight));
+                    highlight.setFillColor(sf::Color(60, 60, 100));
+                    highlight.setPosition(startX + 5.0f, y - 1.0f);
+                    window->draw(highlight);
+                }
+
+                std::stringstream row;
+                row << std::fixed << std::setprecision(2) << (i + 1) << ". "
+                    << ingredientButtons[ranked.ingredient].id << "  x" << ranked.value;
+                sf::Text& rowText = texts.get("lookahead.row." + std::to_string(i), row.str(), 12);
+                rowText.setFillColor(ranked.value > lookaheadRanking.current ? sf::Color(100, 200, 100) : sf::Color(180, 180, 180));
+                rowText.setPosition(startX + 10.0f, y);
+                window->draw(rowText);
+
+                y += rowHeight;
+            }
+
+            // How the hovered ingredient gets to its value, one mix per line
+            if (hoveredRank) {
+                std::string then = hoveredRank->then.empty() ? "Then: stop" : "Then:";
+                for (size_t next : hoveredRank->then) {
+                    if (next < ingredientButtons.size()) {
+                        then += "\n  " + ingredientButtons[next].id;
+                    }
+                }
+                sf::Text& thenText = texts.get("lookahead.then", then, 12);
+                thenText.setFillColor(sf::Color::Yellow);
+                thenText.setPosition(startX + 10.0f, y + 2.0f);
+                window->draw(thenText);
+            }
+        }
+
         // Draw action buttons
         void drawActionButtons() {
             for (auto& button : actionButtons) {
@@ -2330,7 +3314,7 @@ private:
 
         // Draw preview information when mixing
         void drawPreview() {
-            if (!previewNewProperty) return;
+            if (!session.previewProperty()) return;
 
             const float startX = windowWidth / 2.0f + 350.0f;
             const float startY = 10.0f;
@@ -2338,12 +3322,9 @@ private:
             const float panelHeight = 350.0f;
 
             // Title
-            sf::Text titleText;
-            titleText.setFont(font);
-            titleText.setString("Preview Mix: " + ingredientButtons[selectedIngredientIndex].id);
-            titleText.setCharacterSize(18);
+            sf::Text& titleText = texts.get("preview.title",
+                "Preview Mix: " + session.previewIngredient(), 18, sf::Text::Bold);
             titleText.setFillColor(sf::Color::White);
-            titleText.setStyle(sf::Text::Bold);
             titleText.setPosition(startX + 15.0f, startY + 15.0f);
             window->draw(titleText);
 
@@ -2351,220 +3332,148 @@ private:
             const float centerX = windowWidth / 2.0f;
             const float centerY = windowHeight / 2.0f;
             const float scaleFactor = 80.0f; // Same scale as used elsewhere
+            const PreviewModel& model = previewModel;
 
-            // Extract current properties for mixing calculation
-            std::vector<Property*> currentProps;
-            for (const auto& prop : currentProperties) {
-                currentProps.push_back(prop.property);
-            }
-
-            // Calculate result properties to identify new properties that will be added
-            std::vector<Property*> resultProps = PropertyMixCalculator::mixProperties(
-                currentProps, previewNewProperty, DrugType::Marijuana);
-
-            // Identify new properties that will be added (not in current properties)
-            std::vector<Property*> newProps;
-            for (Property* resultProp : resultProps) {
-                bool exists = false;
-                for (Property* currentProp : currentProps) {
-                    if (currentProp == resultProp) {
-                        exists = true;
-                        break;
+            // Draw the mix direction vectors for each active property
+            for (const auto& move : model.moves) {
+                // Current property position
+                float startX = centerX + move.from.x * scaleFactor;
+                float startY = centerY - move.from.y * scaleFactor; // Y is inverted in SFML
+
+                // Where it would move to
+                float endX = centerX + move.to.x * scaleFactor;
+                float endY = centerY - move.to.y * scaleFactor; // Y is inverted in SFML
+
+                // Set line color based on whether transformation will occur
+                sf::Color startColor = move.willTransform ? sf::Color(50, 200, 50, 200) : sf::Color(80, 200, 255, 200);
+                sf::Color endColor = move.willTransform ? sf::Color(220, 220, 0, 200) : sf::Color(120, 220, 255, 200);
+
+                // Draw thicker vector lines with multiple offsets
+                // First draw black outline for contrast
+                for (int i = -2; i <= 2; i++) {
+                    for (int j = -2; j <= 2; j++) {
+                        if (std::abs(i) <= 1 && std::abs(j) <= 1) continue; // Skip inner positions (reserved for colored line)
+
+                        sf::Vertex outlineLine[] = {
+                            sf::Vertex(sf::Vector2f(startX + i, startY + j), sf::Color(0, 0, 0, 150)),
+                            sf::Vertex(sf::Vector2f(endX + i, endY + j), sf::Color(0, 0, 0, 150))
+                        };
+                        window->draw(outlineLine, 2, sf::Lines);
                     }
                 }
 
-                // If this is the new property being added directly and it's not already in currentProps
-                if (resultProp == previewNewProperty && !exists) {
-                    newProps.push_back(resultProp);
-                }
-                // If it's a property that emerged from mixing and isn't already in currentProps
-                else if (resultProp != previewNewProperty && !exists) {
-                    newProps.push_back(resultProp);
-                }
-            }
-
-            // Draw the mix direction vectors for each active property
-            for (const auto& propWithOrigin : currentProperties) {
-                Property* currentProp = propWithOrigin.property;
-                MixerMapEffect* effect = mixerMap->getEffect(currentProp);
-
-                if (effect) {
-                    // Current property position
-                    float startX = centerX + effect->position.x * scaleFactor;
-                    float startY = centerY - effect->position.y * scaleFactor; // Y is inverted in SFML
-
-                    // Calculate where it would move to
-                    Vector2 endVector = effect->position +
-                        (previewNewProperty->mixDirection * previewNewProperty->mixMagnitude);
-
-                    float endX = centerX + endVector.x * scaleFactor;
-                    float endY = centerY - endVector.y * scaleFactor; // Y is inverted in SFML
-
-                    // Check if this property will be transformed
-                    bool willTransform = true;
-                    for (Property* resultProp : resultProps) {
-                        if (resultProp == currentProp) {
-                            willTransform = false;
-                            break;
-                        }
+                // Then draw the colored line with gradient
+                for (int i = -1; i <= 1; i++) {
+                    for (int j = -1; j <= 1; j++) {
+                        sf::Vertex thickLine[] = {
+                            sf::Vertex(sf::Vector2f(startX + i, startY + j), startColor),
+                            sf::Vertex(sf::Vector2f(endX + i, endY + j), endColor)
+                        };
+                        window->draw(thickLine, 2, sf::Lines);
                     }
+                }
 
-                    // Set line color based on whether transformation will occur
-                    sf::Color startColor = willTransform ? sf::Color(50, 200, 50, 200) : sf::Color(80, 200, 255, 200);
-                    sf::Color endColor = willTransform ? sf::Color(220, 220, 0, 200) : sf::Color(120, 220, 255, 200);
-
-                    // Draw thicker vector lines with multiple offsets
-// First draw black outline for contrast
-                    for (int i = -2; i <= 2; i++) {
-                        for (int j = -2; j <= 2; j++) {
-                            if (std::abs(i) <= 1 && std::abs(j) <= 1) continue; // Skip inner positions (reserved for colored line)
-
-                            sf::Vertex outlineLine[] = {
-                                sf::Vertex(sf::Vector2f(startX + i, startY + j), sf::Color(0, 0, 0, 150)),
-                                sf::Vertex(sf::Vector2f(endX + i, endY + j), sf::Color(0, 0, 0, 150))
-                            };
-                            window->draw(outlineLine, 2, sf::Lines);
-                        }
-                    }
+                // Draw an arrow head
+                float angle = std::atan2(startY - endY, endX - startX); // Note: y coords are inverted
+                float arrowSize = 10.0f;
 
-                    // Then draw the colored line with gradient
-                    for (int i = -1; i <= 1; i++) {
-                        for (int j = -1; j <= 1; j++) {
-                            sf::Vertex thickLine[] = {
-                                sf::Vertex(sf::Vector2f(startX + i, startY + j), startColor),
-                                sf::Vertex(sf::Vector2f(endX + i, endY + j), endColor)
-                            };
-                            window->draw(thickLine, 2, sf::Lines);
-                        }
+                for (int i = -1; i <= 1; i++) {
+                    for (int j = -1; j <= 1; j++) {
+                        sf::Vertex arrowHead[] = {
+                            sf::Vertex(sf::Vector2f(endX + i, endY + j), endColor),
+                            sf::Vertex(sf::Vector2f(
+                                endX - arrowSize * std::cos(angle - 0.5f) + i,
+                                endY + arrowSize * std::sin(angle - 0.5f) + j),  // Y inverted
+                                endColor),
+                            sf::Vertex(sf::Vector2f(endX + i, endY + j), endColor),
+                            sf::Vertex(sf::Vector2f(
+                                endX - arrowSize * std::cos(angle + 0.5f) + i,
+                                endY + arrowSize * std::sin(angle + 0.5f) + j),  // Y inverted
+                                endColor)
+                        };
+                        window->draw(arrowHead, 4, sf::Lines);
                     }
+                }
 
-                    // Draw an arrow head
-                    float angle = std::atan2(startY - endY, endX - startX); // Note: y coords are inverted
-                    float arrowSize = 10.0f;
-
-                    for (int i = -1; i <= 1; i++) {
-                        for (int j = -1; j <= 1; j++) {
-                            sf::Vertex arrowHead[] = {
-                                sf::Vertex(sf::Vector2f(endX + i, endY + j), endColor),
-                                sf::Vertex(sf::Vector2f(
-                                    endX - arrowSize * std::cos(angle - 0.5f) + i,
-                                    endY + arrowSize * std::sin(angle - 0.5f) + j),  // Y inverted
-                                    endColor),
-                                sf::Vertex(sf::Vector2f(endX + i, endY + j), endColor),
-                                sf::Vertex(sf::Vector2f(
-                                    endX - arrowSize * std::cos(angle + 0.5f) + i,
-                                    endY + arrowSize * std::sin(angle + 0.5f) + j),  // Y inverted
-                                    endColor)
-                            };
-                            window->draw(arrowHead, 4, sf::Lines);
-                        }
-                    }
+                // Mark the property, if any, at the end position
+                if (move.target) {
+                    // Draw a small circle to indicate the target property
+                    sf::CircleShape targetCircle(5.0f);
+                    targetCircle.setFillColor(endColor);
+                    targetCircle.setOutlineColor(sf::Color::Black);
+                    targetCircle.setOutlineThickness(1.0f);
+                    targetCircle.setPosition(endX - 5.0f, endY - 5.0f); // Center the circle
+                    window->draw(targetCircle);
 
-                    // Find what property, if any, would be at the end position
-                    MixerMapEffect* resultEffect = mixerMap->getEffectAtPoint(endVector);
-                    if (resultEffect) {
-                        // Draw a small circle to indicate the target property
-                        sf::CircleShape targetCircle(5.0f);
-                        targetCircle.setFillColor(endColor);
-                        targetCircle.setOutlineColor(sf::Color::Black);
-                        targetCircle.setOutlineThickness(1.0f);
-                        targetCircle.setPosition(endX - 5.0f, endY - 5.0f); // Center the circle
-                        window->draw(targetCircle);
-
-                        // Only show target property name if it's different from the current one
-                        if (resultEffect->property != currentProp) {
-                            // Draw a small label with the target property name
-                            sf::Text targetLabel;
-                            targetLabel.setFont(font);
-                            targetLabel.setString("→ " + resultEffect->property->name);
-                            targetLabel.setCharacterSize(12);
-                            targetLabel.setFillColor(sf::Color::White);
-                            targetLabel.setOutlineColor(sf::Color::Black);
-                            targetLabel.setOutlineThickness(1.0f);
-                            targetLabel.setPosition(endX + 8.0f, endY - 6.0f);
-                            window->draw(targetLabel);
-                        }
+                    // Only show target property name if it's different from the current one
+                    if (move.target != move.property) {
+                        // Draw a small label with the target property name
+                        sf::Text& targetLabel = texts.get("preview.target." + move.property->id, "→ " + move.target->name, 12);
+                        targetLabel.setFillColor(sf::Color::White);
+                        targetLabel.setOutlineColor(sf::Color::Black);
+                        targetLabel.setOutlineThickness(1.0f);
+                        targetLabel.setPosition(endX + 8.0f, endY - 6.0f);
+                        window->draw(targetLabel);
                     }
                 }
             }
 
             // Draw new properties that will be added (not from transformations)
-            for (Property* newProp : newProps) {
-                MixerMapEffect* effect = mixerMap->getEffect(newProp);
-                if (effect) {
-                    float x = centerX + effect->position.x * scaleFactor;
-                    float y = centerY - effect->position.y * scaleFactor; // Y is inverted in SFML
-
-                    // Draw a pulsing circle to highlight new properties
-                    float pulseScale = 1.0f + 0.2f * sin(clock.getElapsedTime().asSeconds() * 4.0f);
-                    float radius = effect->radius * scaleFactor * pulseScale;
-
-                    // Draw outer glow
-                    sf::CircleShape newPropGlow(radius * 1.2f);
-                    newPropGlow.setFillColor(sf::Color(100, 255, 100, 50)); // Green glow
-                    newPropGlow.setPosition(x - newPropGlow.getRadius(), y - newPropGlow.getRadius());
-                    window->draw(newPropGlow);
-
-                    // Draw the new property circle
-                    sf::CircleShape newPropCircle(radius);
-                    sf::Color propColor = tierColors[newProp->tier];
-                    newPropCircle.setFillColor(sf::Color(propColor.r, propColor.g, propColor.b, 180));
-                    newPropCircle.setOutlineColor(sf::Color(100, 255, 100)); // Green outline
-                    newPropCircle.setOutlineThickness(2.0f);
-                    newPropCircle.setPosition(x - newPropCircle.getRadius(), y - newPropCircle.getRadius());
-                    window->draw(newPropCircle);
-
-                    // Draw "NEW" text above the property
-                    sf::Text newText;
-                    newText.setFont(font);
-                    newText.setString("NEW");
-                    newText.setCharacterSize(14);
-                    newText.setFillColor(sf::Color::White);
-                    newText.setOutlineColor(sf::Color::Black);
-                    newText.setOutlineThickness(1.0f);
-                    newText.setStyle(sf::Text::Bold);
-                    newText.setPosition(
-                        x - newText.getLocalBounds().width / 2.0f,
-                        y - radius - 20.0f
-                    );
-                    window->draw(newText);
-                }
+            for (MixerMapEffect* effect : model.newEffects) {
+                Property* newProp = effect->property;
+                float x = centerX + effect->position.x * scaleFactor;
+                float y = centerY - effect->position.y * scaleFactor; // Y is inverted in SFML
+
+                // Draw a pulsing circle to highlight new properties
+                float pulseScale = 1.0f + 0.2f * sin(clock.getElapsedTime().asSeconds() * 4.0f);
+                float radius = effect->radius * scaleFactor * pulseScale;
+
+                // Draw outer glow
+                sf::CircleShape newPropGlow(radius * 1.2f);
+                newPropGlow.setFillColor(sf::Color(100, 255, 100, 50)); // Green glow
+                newPropGlow.setPosition(x - newPropGlow.getRadius(), y - newPropGlow.getRadius());
+                window->draw(newPropGlow);
+
+                // Draw the new property circle
+                sf::CircleShape newPropCircle(radius);
+                sf::Color propColor = tierColors[newProp->tier];
+                newPropCircle.setFillColor(sf::Color(propColor.r, propColor.g, propColor.b, 180));
+                newPropCircle.setOutlineColor(sf::Color(100, 255, 100)); // Green outline
+                newPropCircle.setOutlineThickness(2.0f);
+                newPropCircle.setPosition(x - newPropCircle.getRadius(), y - newPropCircle.getRadius());
+                window->draw(newPropCircle);
+
+                // Draw "NEW" text above the property
+                sf::Text& newText = texts.get("preview.new." + newProp->id, "NEW", 14, sf::Text::Bold);
+                newText.setFillColor(sf::Color::White);
+                newText.setOutlineColor(sf::Color::Black);
+                newText.setOutlineThickness(1.0f);
+                newText.setPosition(
+                    x - newText.getLocalBounds().width / 2.0f,
+                    y - radius - 20.0f
+                );
+                window->draw(newText);
             }
 
             // Draw result properties
-            sf::Text resultTitle;
-            resultTitle.setFont(font);
-            resultTitle.setString("Result Properties:");
-            resultTitle.setCharacterSize(16);
+            sf::Text& resultTitle = texts.get("preview.result", "Result Properties:", 16, sf::Text::Bold);
             resultTitle.setFillColor(sf::Color::White);
-            resultTitle.setStyle(sf::Text::Bold);
             resultTitle.setPosition(startX + 15.0f, startY + 50.0f);
             window->draw(resultTitle);
 
             // Draw result properties
             float y = startY + 80.0f;
-            for (size_t i = 0; i < resultProps.size(); i++) {
-                Property* prop = resultProps[i];
-
-                // Check if this is a new property (not in current properties)
-                bool isNew = true;
-                for (const auto& currentProp : currentProps) {
-                    if (currentProp == prop) {  // Use pointer comparison
-                        isNew = false;
-                        break;
-                    }
-                }
+            for (size_t i = 0; i < model.resultProps.size(); i++) {
+                Property* prop = model.resultProps[i];
 
                 // Draw with appropriate highlighting
-                sf::Text propText;
-                propText.setFont(font);
-                propText.setString(std::to_string(i + 1) + ". " + prop->name + " (Tier " + std::to_string(prop->tier) + ")");
-                propText.setCharacterSize(16);
+                sf::Text& propText = texts.get("preview.result." + std::to_string(i),
+                    std::to_string(i + 1) + ". " + prop->name + " (Tier " + std::to_string(prop->tier) + ")", 16,
+                    model.resultIsNew[i] ? sf::Text::Bold : sf::Text::Regular);
 
-                if (isNew) {
+                if (model.resultIsNew[i]) {
                     // New property - highlight green
                     propText.setFillColor(sf::Color(100, 255, 100));
-                    propText.setStyle(sf::Text::Bold);
                 }
                 else {
                     // Existing property
@@ -2577,83 +3486,93 @@ private:
                 y += 30.0f;
             }
 
-            // Rest of the preview panel code (stats changes, etc.) remains the same
-            // Calculate and show stats changes
-            float currentAddictiveness = 0.0f;
-            float currentBaseValue = 0.0f;
-            float currentMultiplier = 1.0f;
-            int currentValueChange = 0;
-
-            float newAddictiveness = 0.0f;
-            float newBaseValue = 0.0f;
-            float newMultiplier = 1.0f;
-            int newValueChange = 0;
-
-            // Current stats
-            for (auto* prop : currentProps) {
-                currentAddictiveness += prop->addictiveness;
-                currentBaseValue += prop->addBaseValueMultiple;
-                currentMultiplier *= prop->valueMultiplier;
-                currentValueChange += prop->valueChange;
-            }
-
-            // New stats
-            for (auto* prop : resultProps) {
-                newAddictiveness += prop->addictiveness;
-                newBaseValue += prop->addBaseValueMultiple;
-                newMultiplier *= prop->valueMultiplier;
-                newValueChange += prop->valueChange;
-            }
-
             y += 10.0f;
 
             // Draw stats comparison
-            sf::Text statsTitle;
-            statsTitle.setFont(font);
-            statsTitle.setString("Stats Changes:");
-            statsTitle.setCharacterSize(16);
+            sf::Text& statsTitle = texts.get("preview.stats", "Stats Changes:", 16, sf::Text::Bold);
             statsTitle.setFillColor(sf::Color::White);
-            statsTitle.setStyle(sf::Text::Bold);
             statsTitle.setPosition(startX + 15.0f, y);
             window->draw(statsTitle);
 
             y += 30.0f;
 
             // Addictiveness change
-            drawStatChange("Addictiveness", currentAddictiveness, newAddictiveness, startX + 25.0f, y);
+            drawStatChange("Addictiveness", model.current.addictiveness, model.result.addictiveness, startX + 25.0f, y);
             y += 30.0f;
 
             // Base value change
-            drawStatChange("Base Value Bonus", currentBaseValue, newBaseValue, startX + 25.0f, y);
+            drawStatChange("Base Value Bonus", model.current.baseValue, model.result.baseValue, startX + 25.0f, y);
             y += 30.0f;
 
             // Multiplier change
-            drawStatChange("Value Multiplier", currentMultiplier, newMultiplier, startX + 25.0f, y);
+            drawStatChange("Value Multiplier", model.current.multiplier, model.result.multiplier, startX + 25.0f, y);
             y += 30.0f;
 
             // Value change
-            drawStatChange("Value Change", (float)currentValueChange, (float)newValueChange, startX + 25.0f, y);
+            drawStatChange("Value Change", (float)model.current.valueChange, (float)model.result.valueChange, startX + 25.0f, y);
 
             // Instructions
-            sf::Text instructionsText;
-            instructionsText.setFont(font);
-            instructionsText.setString("'Confirm Mix' to apply \n'Cancel' to go back");
-            instructionsText.setCharacterSize(12);
+            sf::Text& instructionsText = texts.get("preview.instructions", "'Confirm Mix' to apply \n'Cancel' to go back", 12);
             instructionsText.setFillColor(sf::Color(180, 180, 180));
             instructionsText.setPosition(startX + 15.0f, y + 40.0f);
             window->draw(instructionsText);
         }
 
+        // Work out everything drawPreview shows for mixing the previewed ingredient into
+        // the current properties. Only called when either of them changes.
+        void rebuildPreviewModel() {
+            PreviewModel model;
+            if (!session.previewProperty()) {
+                previewModel = model;
+                return;
+            }
+
+            std::vector<Property*> currentProps = session.propertyList();
+
+            model.resultProps = PropertyMixCalculator::mixProperties(
+                currentProps, session.previewProperty(), DrugType::Marijuana);
+
+            // Result properties not present before are new
+            for (Property* resultProp : model.resultProps) {
+                bool isNew = std::find(currentProps.begin(), currentProps.end(), resultProp) == currentProps.end();
+                model.resultIsNew.push_back(isNew);
+                MixerMapEffect* effect = isNew ? mixerMap->getEffect(resultProp) : nullptr;
+                if (effect) {
+                    model.newEffects.push_back(effect);
+                }
+            }
+
+            // Where each current property would move, and what it would land on
+            Vector2 mixVector = session.previewProperty()->mixDirection * session.previewProperty()->mixMagnitude;
+            for (Property* currentProp : currentProps) {
+                MixerMapEffect* effect = mixerMap->getEffect(currentProp);
+                if (!effect) {
+                    continue;
+                }
+
+                PreviewMove move;
+                move.property = currentProp;
+                move.from = effect->position;
+                move.to = effect->position + mixVector;
+                move.willTransform = std::find(model.resultProps.begin(), model.resultProps.end(), currentProp) ==
+                    model.resultProps.end();
+                MixerMapEffect* resultEffect = mixerMap->getEffectAtPoint(move.to);
+                move.target = resultEffect ? resultEffect->property : nullptr;
+                model.moves.push_back(move);
+            }
+
+            model.current = PreviewStats::of(currentProps);
+            model.result = PreviewStats::of(model.resultProps);
+            previewModel = model;
+        }
+
         // Draw a stat change with arrow indicator
         void drawStatChange(const std::string& label, float currentValue, float newValue, float x, float y) {
             std::stringstream ss;
             ss << std::fixed << std::setprecision(2);
             ss << label << ": " << currentValue << " -> " << newValue;
 
-            sf::Text statText;
-            statText.setFont(font);
-            statText.setString(ss.str());
-            statText.setCharacterSize(16);  // Increased font size
+            sf::Text& statText = texts.get("preview.change." + label, ss.str(), 16);
 
             // Color based on change
             if (newValue > currentValue) {
@@ -2679,7 +3598,7 @@ private:
 
             // Help panel
             const float panelWidth = 700.0f;  // Larger panel
-            const float panelHeight = 600.0f;  // Larger panel
+            const float panelHeight = 800.0f;  // Larger panel
             const float startX = (windowWidth - panelWidth) / 2.0f;
             const float startY = (windowHeight - panelHeight) / 2.0f;
 
@@ -2691,12 +3610,8 @@ private:
             window->draw(panel);
 
             // Title
-            sf::Text titleText;
-            titleText.setFont(font);
-            titleText.setString("Property Mixer - Help");
-            titleText.setCharacterSize(28);  // Increased font size
+            sf::Text& titleText = texts.get("help.title", "Property Mixer - Help", 28, sf::Text::Bold);
             titleText.setFillColor(sf::Color::White);
-            titleText.setStyle(sf::Text::Bold);
             titleText.setPosition(startX + 25.0f, startY + 25.0f);
             window->draw(titleText);
 
@@ -2712,6 +3627,9 @@ private:
                 "* Press 'I' to toggle tooltips when hovering over properties",
                 "* Press '+' or '-' to adjust animation speed",
                 "* Press 'ESC' to exit preview or help mode",
+                "* Press 'U' to undo the last mix, reset or product change",
+                "* Press 'F3' to show frame timings, 'F4' to save them to frame_timings.csv",
+                "* Press 'F5' to save the session to mix_session.txt for Session Replay",
                 "",
                 "How it works:",
                 "* The large circular map shows all possible properties",
@@ -2734,15 +3652,14 @@ private:
             };
 
             float y = startY + 80.0f;
-            for (const auto& line : helpLines) {
-                sf::Text helpText;
-                helpText.setFont(font);
-                helpText.setString(line);
-                helpText.setCharacterSize(16);  // Increased font size
+            for (size_t i = 0; i < helpLines.size(); i++) {
+                const std::string& line = helpLines[i];
+                bool heading = line.empty() || line.find(":") != std::string::npos;
+                sf::Text& helpText = texts.get("help." + std::to_string(i), line, 16,
+                    heading ? sf::Text::Bold : sf::Text::Regular);
 
-                if (line.empty() || line.find(":") != std::string::npos) {
+                if (heading) {
                     helpText.setFillColor(sf::Color(200, 200, 100));
-                    helpText.setStyle(sf::Text::Bold);
                 }
                 else {
                     helpText.setFillColor(sf::Color::White);
@@ -2775,24 +3692,17 @@ private:
             window->draw(barFill);
 
             // Draw label
-            sf::Text labelText;
-            labelText.setFont(font);
-
             std::stringstream ss;
             ss << std::fixed << std::setprecision(2);
             ss << label << ": " << value;
 
-            labelText.setString(ss.str());
-            labelText.setCharacterSize(14);  // Increased font size
+            sf::Text& labelText = texts.get("bar." + label, ss.str(), 14);
             labelText.setFillColor(sf::Color::White);
             labelText.setPosition(x, y - labelText.getLocalBounds().height - 5);
             window->draw(labelText);
 
             // Draw the value as text inside the bar for better visibility
-            sf::Text valueText;
-            valueText.setFont(font);
-            valueText.setString(ss.str().substr(label.length() + 2));  // Just the value
-            valueText.setCharacterSize(14);
+            sf::Text& valueText = texts.get("bar.value." + label, ss.str().substr(label.length() + 2), 14);  // Just the value
             valueText.setFillColor(sf::Color::White);
             valueText.setPosition(x + 5, y + (height - 14) / 2);
             window->draw(valueText);